@@ -0,0 +1,89 @@
+# Decide the board sizes for which slide/branch.hpp instantiates the fixed size PlayBoard<H, W>.
+# Every other size from 2x2 to 16x16 is solved by the generic PlayBoard<Flexible> path,
+# which runs the same algorithms with the size held at runtime (slower, hitode roughly 2x).
+#
+#   BRANCH_SIZES       : FAST for the frequent sizes and the small ones the exact solvers
+#                        handle (default), ALL for every size (very slow build),
+#                        or a list of HxW (e.g. "4x4;8x8;16x16")
+#   BRANCH_PROFILE     : profile written by run_slide --profile; if set, the BRANCH_PROFILE_TOP
+#                        most frequent sizes in it are used instead of BRANCH_SIZES
+#   BRANCH_PROFILE_TOP : number of sizes taken from BRANCH_PROFILE
+#
+# slide_branch_sizes(<var>) sets <var> to the comma separated pairs "H,W,H,W,..." for SLIDE_BRANCH_SIZES.
+
+function(slide_branch_sizes OUT)
+  set(sizes)
+
+  if(BRANCH_PROFILE)
+    if(NOT EXISTS "${BRANCH_PROFILE}")
+      message(FATAL_ERROR "BRANCH_PROFILE not found: ${BRANCH_PROFILE}")
+    endif()
+
+    # count records per size (each line starts with "height width")
+    file(STRINGS "${BRANCH_PROFILE}" lines REGEX "^[0-9]+ [0-9]+ ")
+    set(seen)
+    foreach(line ${lines})
+      string(REGEX REPLACE "^([0-9]+) ([0-9]+) .*$" "\\1x\\2" size "${line}")
+      if(NOT DEFINED count_${size})
+        set(count_${size} 0)
+        list(APPEND seen ${size})
+      endif()
+      math(EXPR count_${size} "${count_${size}} + 1")
+    endforeach()
+
+    # take the most frequent ones
+    foreach(i RANGE 1 ${BRANCH_PROFILE_TOP})
+      set(best)
+      set(bestCount 0)
+      foreach(size ${seen})
+        if(count_${size} GREATER bestCount)
+          set(best ${size})
+          set(bestCount ${count_${size}})
+        endif()
+      endforeach()
+      if(best)
+        list(APPEND sizes ${best})
+        list(REMOVE_ITEM seen ${best})
+      endif()
+    endforeach()
+  elseif(BRANCH_SIZES STREQUAL "FAST")
+    set(sizes 8x8 12x8 4x4 16x16 9x9 10x10 6x6 5x5 8x4 7x7 3x6 9x8 2x16 3x16 4x16 10x8 12x12)
+    # boards up to 16 cells, which exact and hitode solve
+    foreach(h RANGE 2 8)
+      foreach(w RANGE 2 8)
+        math(EXPR area "${h} * ${w}")
+        if(NOT area GREATER 16)
+          list(APPEND sizes ${h}x${w})
+        endif()
+      endforeach()
+    endforeach()
+  elseif(BRANCH_SIZES STREQUAL "ALL")
+    foreach(h RANGE 2 16)
+      foreach(w RANGE 2 16)
+        list(APPEND sizes ${h}x${w})
+      endforeach()
+    endforeach()
+  else()
+    set(sizes ${BRANCH_SIZES})
+  endif()
+
+  if(sizes)
+    list(REMOVE_DUPLICATES sizes)
+  endif()
+
+  set(pairs)
+  foreach(size ${sizes})
+    if(NOT size MATCHES "^([0-9]+)x([0-9]+)$")
+      message(FATAL_ERROR "Invalid board size in BRANCH_SIZES: ${size} (expected HxW)")
+    endif()
+    set(h ${CMAKE_MATCH_1})
+    set(w ${CMAKE_MATCH_2})
+    if(h LESS 2 OR h GREATER 16 OR w LESS 2 OR w GREATER 16)
+      message(FATAL_ERROR "Board size out of range (2x2 - 16x16): ${size}")
+    endif()
+    list(APPEND pairs "${h},${w}")
+  endforeach()
+
+  string(REPLACE ";" "," pairs "${pairs}")
+  set(${OUT} "${pairs}" PARENT_SCOPE)
+endfunction()
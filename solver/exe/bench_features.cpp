@@ -0,0 +1,169 @@
+// 盤面全体からの特徴量の作り直し (computeFeatureSums) と，各特徴量を 1 つずつ数える素朴な実装の比較
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include "slide/FeatureKernels.hpp"
+#include "slide/PlayBoard.hpp"
+#include "util/define.hpp"
+#include "util/Random.hpp"
+
+namespace
+{
+
+using namespace slide;
+using Clock = std::chrono::high_resolution_clock;
+
+double elapsed_ms(Clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+// 以下は各特徴量の元々の数え方 (答え合わせ用)
+
+int manhattan(const PlayBoard<Flexible>& board, int power)
+{
+    int sum = 0;
+    rep(i, board.height()) rep(j, board.width()){
+        if(Point(i, j) != board.selected){
+            const int l1 = (Point(i, j) - Point(board(i, j))).l1norm();
+            sum += power == 1 ? l1 : l1 * l1;
+        }
+    }
+    return sum;
+}
+
+int linearConflict(const PlayBoard<Flexible>& board)
+{
+    int sum = 0;
+    rep(i, board.height()) reps(j, 1, board.width()){
+        const Point dst_a(board(i, j));
+        if(board.selected == Point(i, j) || dst_a.y != i) continue;
+        rep(k, j){
+            const Point dst_b(board(i, k));
+            sum += dst_b.y == i && dst_a.x < dst_b.x && board.selected != Point(i, k);
+        }
+    }
+    rep(i, board.width()) reps(j, 1, board.height()){
+        const Point dst_a(board(j, i));
+        if(board.selected == Point(j, i) || dst_a.x != i) continue;
+        rep(k, j){
+            const Point dst_b(board(k, i));
+            sum += dst_b.x == i && dst_a.y < dst_b.y && board.selected != Point(k, i);
+        }
+    }
+    return sum;
+}
+
+void variance(const PlayBoard<Flexible>& board, int& squaredSum, int& sumY, int& sumX, int& count)
+{
+    squaredSum = sumY = sumX = count = 0;
+    rep(i, board.height()) rep(j, board.width()){
+        if(!board.isAligned(i, j) && board.selected != Point(i, j)){
+            squaredSum += i*i + j*j;
+            sumY += i;
+            sumX += j;
+            ++count;
+        }
+    }
+}
+
+bool parity(const PlayBoard<Flexible>& board)
+{
+    bool ret = false;
+    rep(i, board.area()) rep(j, i){
+        const Point p1(i/board.width(), i%board.width());
+        const Point p2(j/board.width(), j%board.width());
+        ret ^= board(p1) < board(p2);
+    }
+    return ret;
+}
+
+} // end of unnamed namespace
+
+int main(int argc, const char* const argv[])
+{
+    namespace po = boost::program_options;
+
+    int numBoards;
+    int repeat;
+
+    po::options_description opt("Allowed options");
+    opt.add_options()
+        ("help",                                                         "print this help message")
+        ("boards,b", po::value<int>(&numBoards)->default_value(1000),   "number of random boards per size")
+        ("repeat,r", po::value<int>(&repeat)->default_value(100),       "number of repetitions")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opt), vm);
+    po::notify(vm);
+
+    if(vm.count("help")){
+        std::cerr << opt << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << "kernel: " << featureKernelName() << std::endl;
+    std::cout << boost::format("%6s %14s %14s %8s") % "size" % "scalar[us]" % "kernel[us]" % "speedup" << std::endl;
+
+    const int sizes[][2] = {{4, 4}, {8, 8}, {11, 13}, {16, 16}};
+    for(const auto& size : sizes){
+        const int h = size[0], w = size[1];
+
+        std::vector<PlayBoard<Flexible>> boards;
+        rep(i, numBoards){
+            PlayBoard<Flexible> board(Board<Flexible>::randomState(h, w));
+            if(i % 2 == 1){
+                board.select(Point(util::Random::nextInt(0, h-1), util::Random::nextInt(0, w-1)));
+            }
+            boards.push_back(board);
+        }
+
+        // 答え合わせ
+        for(const PlayBoard<Flexible>& board : boards){
+            const FeatureSums sums = computeFeatureSums(board);
+            int squaredSum, sumY, sumX, count;
+            variance(board, squaredSum, sumY, sumX, count);
+
+            if(sums.manhattan != manhattan(board, 1) || sums.squaredManhattan != manhattan(board, 2) ||
+               sums.linearConflict != linearConflict(board) || sums.parity != parity(board) ||
+               sums.squaredSum != squaredSum || sums.sumY != sumY || sums.sumX != sumX || sums.count != count){
+                std::cerr << "mismatch on " << h << "x" << w << std::endl << board << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        int sink = 0;
+
+        const Clock::time_point scalarBegin = Clock::now();
+        rep(r, repeat) for(const PlayBoard<Flexible>& board : boards){
+            int squaredSum, sumY, sumX, count;
+            variance(board, squaredSum, sumY, sumX, count);
+            sink += manhattan(board, 1) + manhattan(board, 2) + linearConflict(board) + parity(board) + squaredSum + count;
+        }
+        const double scalarTime = elapsed_ms(scalarBegin);
+
+        const Clock::time_point kernelBegin = Clock::now();
+        rep(r, repeat) for(const PlayBoard<Flexible>& board : boards){
+            const FeatureSums sums = computeFeatureSums(board);
+            sink += sums.manhattan + sums.squaredManhattan + sums.linearConflict + sums.parity + sums.squaredSum + sums.count;
+        }
+        const double kernelTime = elapsed_ms(kernelBegin);
+
+        const double calls = double(repeat) * numBoards;
+        std::cout << boost::format("%3dx%-2d %14.3f %14.3f %8.2f") % h % w
+            % (scalarTime * 1000 / calls) % (kernelTime * 1000 / calls) % (scalarTime / kernelTime) << std::endl;
+
+        if(sink == 42){
+            std::cout << std::endl;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
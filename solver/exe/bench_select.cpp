@@ -0,0 +1,104 @@
+// util::parallel_select と tbb::parallel_sort によるビーム幅の絞り込みの比較
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include <tbb/parallel_sort.h>
+#include <tbb/task_scheduler_init.h>
+
+#include "util/define.hpp"
+#include "util/parallel_select.hpp"
+
+namespace
+{
+
+using Clock = std::chrono::high_resolution_clock;
+
+double elapsed_ms(Clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+} // end of unnamed namespace
+
+int main(int argc, const char* const argv[])
+{
+    namespace po = boost::program_options;
+
+    int numThreads;
+    int repeat;
+    int ratio;
+
+    po::options_description opt("Allowed options");
+    opt.add_options()
+        ("help",                                                              "print this help message")
+        ("threads,t", po::value<int>(&numThreads)->default_value(-1),        "number of threads")
+        ("repeat,r",  po::value<int>(&repeat)->default_value(10),            "number of repetitions")
+        ("ratio,c",   po::value<int>(&ratio)->default_value(4),              "number of candidates per beam width")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opt), vm);
+    po::notify(vm);
+
+    if(vm.count("help")){
+        std::cerr << opt << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    if(numThreads == -1){
+        numThreads = tbb::task_scheduler_init::default_num_threads();
+    }
+    tbb::task_scheduler_init init(numThreads);
+
+    std::mt19937 engine(0);
+    std::uniform_real_distribution<float> dist(0.0f, 10000.0f);
+
+    std::cout << boost::format("%8s %10s %12s %12s") % "width" % "candidates" % "sort[ms]" % "select[ms]" << std::endl;
+
+    for(int width = 1000; width <= 1000000; width *= 10){
+        const int n = width * ratio;
+
+        std::vector<std::pair<float, uint>> original(n);
+        rep(i, n){
+            original[i] = {dist(engine), uint(i)};
+        }
+
+        double sortTime = 0.0, selectTime = 0.0;
+        rep(r, repeat){
+            std::vector<std::pair<float, uint>> sorted = original;
+            const Clock::time_point sortBegin = Clock::now();
+            tbb::parallel_sort(sorted.begin(), sorted.end());
+            sorted.erase(sorted.begin() + width, sorted.end());
+            sortTime += elapsed_ms(sortBegin);
+
+            std::vector<std::pair<float, uint>> selected = original;
+            const Clock::time_point selectBegin = Clock::now();
+            util::parallel_select(selected, width);
+            selectTime += elapsed_ms(selectBegin);
+
+            // 同じ score の集合が選ばれているか確認
+            float maxSelected = 0.0f;
+            for(const std::pair<float, uint>& p : selected){
+                maxSelected = std::max(maxSelected, p.first);
+            }
+            if(selected.size() != width || maxSelected != sorted.back().first){
+                std::cerr << "wrong selection at width " << width << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::cout << boost::format("%8d %10d %12.3f %12.3f")
+            % width % n % (sortTime / repeat) % (selectTime / repeat) << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+// 選択セルの移動経路の探索について，Wavefront (行単位の BFS) と元々の std::queue の BFS の比較
+//
+// ランダムな fixed の盤面と始点・終点について，移動回数が一致することと Wavefront の経路が正しいことを確かめてから速さを測る．
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <queue>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include "slide/BitBoard.hpp"
+#include "slide/Wavefront.hpp"
+#include "util/define.hpp"
+#include "util/Random.hpp"
+
+namespace
+{
+
+using namespace slide;
+using Clock = std::chrono::high_resolution_clock;
+
+constexpr int arrayH = arraySize(Flexible);
+constexpr int arrayW = arraySize(Flexible);
+
+// 元々の FixBoard::searchMove
+bool queueSearch(const BitBoard<Flexible>& fixed, Point src, Point dst, char pre[arrayH][arrayW])
+{
+    rep(i, fixed.height()) rep(j, fixed.width()){
+        pre[i][j] = -1; // not reached yet
+    }
+
+    std::queue<Point> Q;
+    Q.push(src);
+    pre[src.y][src.x] = -2; // the start point
+
+    while(!Q.empty()){
+        const Point p = Q.front();
+        Q.pop();
+
+        if(p == dst){
+            return true;
+        }
+
+        rep(k, 4){
+            const Direction dir(k);
+            const Point n = p + Point::delta(dir);
+            if(!n.isIn(fixed.height(), fixed.width()) || fixed(n) || pre[n.y][n.x] != -1){
+                continue;
+            }
+
+            pre[n.y][n.x] = k;
+            Q.push(n);
+        }
+    }
+
+    return false;
+}
+
+// pre を dst から src まで辿った移動回数 (fixed のセルや盤面の外を通れば -1)
+int tracedLength(const BitBoard<Flexible>& fixed, Point src, Point dst, char pre[arrayH][arrayW])
+{
+    int ret = 0;
+    for(Point p = dst; p != src; ++ret){
+        if(!p.isIn(fixed.height(), fixed.width()) || fixed(p) || ret > fixed.height() * fixed.width()){
+            return -1;
+        }
+        p -= Point::delta(Direction(pre[p.y][p.x]));
+    }
+    return ret;
+}
+
+struct Query
+{
+    BitBoard<Flexible> fixed;
+    Point src, dst;
+};
+
+Point randomOpenPoint(const BitBoard<Flexible>& fixed)
+{
+    while(true){
+        const Point p(util::Random::nextInt(0, fixed.height()-1), util::Random::nextInt(0, fixed.width()-1));
+        if(!fixed(p)){
+            return p;
+        }
+    }
+}
+
+std::vector<Query> makeQueries(int h, int w, float density, int num)
+{
+    std::vector<Query> ret;
+    rep(n, num){
+        BitBoard<Flexible> fixed(h, w);
+        rep(i, h) rep(j, w){
+            if(util::Random::nextReal() < density){
+                fixed.set(i, j);
+            }
+        }
+        if(fixed.countZero() == 0){
+            fixed.reset(Point(0, 0));
+        }
+        const Point src = randomOpenPoint(fixed);
+        ret.push_back({fixed, src, randomOpenPoint(fixed)});
+    }
+    return ret;
+}
+
+} // end of unnamed namespace
+
+int main(int argc, const char* const argv[])
+{
+    namespace po = boost::program_options;
+
+    int numQueries;
+    int repeat;
+
+    po::options_description opt("Allowed options");
+    opt.add_options()
+        ("help",                                                         "print this help message")
+        ("queries,q", po::value<int>(&numQueries)->default_value(1000), "number of random queries per case")
+        ("repeat,r",  po::value<int>(&repeat)->default_value(100),      "number of repetitions")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opt), vm);
+    po::notify(vm);
+
+    if(vm.count("help")){
+        std::cerr << opt << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << boost::format("%6s %8s %12s %14s %8s") % "size" % "fixed" % "queue[ns]" % "wavefront[ns]" % "speedup" << std::endl;
+
+    const int sizes[][2] = {{4, 4}, {8, 8}, {16, 16}};
+    const float densities[] = {0.0f, 0.2f, 0.4f};
+
+    for(const auto& size : sizes) for(const float density : densities){
+        const int h = size[0], w = size[1];
+        const std::vector<Query> queries = makeQueries(h, w, density, numQueries);
+
+        // 答え合わせ
+        for(const Query& q : queries){
+            char pre[arrayH][arrayW], wavePre[arrayH][arrayW];
+            const int expected = queueSearch(q.fixed, q.src, q.dst, pre) ? tracedLength(q.fixed, q.src, q.dst, pre) : -1;
+
+            Wavefront<Flexible, Flexible> wave;
+            const int actual = wave.search(q.fixed, q.src, q.dst);
+            if(actual != -1){
+                wave.tracePath(q.dst, wavePre);
+            }
+
+            if(actual != expected || (actual != -1 && tracedLength(q.fixed, q.src, q.dst, wavePre) != actual)){
+                std::cerr << "mismatch on " << h << "x" << w << ": " << expected << " vs " << actual << std::endl << q.fixed << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        int sink = 0;
+
+        const Clock::time_point queueBegin = Clock::now();
+        rep(r, repeat) for(const Query& q : queries){
+            char pre[arrayH][arrayW];
+            sink += queueSearch(q.fixed, q.src, q.dst, pre) ? pre[q.dst.y][q.dst.x] : 0;
+        }
+        const double queueTime = std::chrono::duration<double, std::nano>(Clock::now() - queueBegin).count();
+
+        const Clock::time_point waveBegin = Clock::now();
+        rep(r, repeat) for(const Query& q : queries){
+            char pre[arrayH][arrayW];
+            Wavefront<Flexible, Flexible> wave;
+            if(wave.search(q.fixed, q.src, q.dst) != -1){
+                wave.tracePath(q.dst, pre);
+                sink += pre[q.dst.y][q.dst.x];
+            }
+        }
+        const double waveTime = std::chrono::duration<double, std::nano>(Clock::now() - waveBegin).count();
+
+        const double calls = double(repeat) * queries.size();
+        std::cout << boost::format("%3dx%-2d %8.1f %12.1f %14.1f %8.2f") % h % w % density
+            % (queueTime / calls) % (waveTime / calls) % (queueTime / waveTime) << std::endl;
+
+        if(sink == 42){
+            std::cout << std::endl;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
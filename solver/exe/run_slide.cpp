@@ -17,6 +17,10 @@
 #include "slide/DragonSolver.hpp"
 #include "slide/LizardSolver.hpp"
 #include "slide/L2Solver.hpp"
+#include "slide/PortfolioSolver.hpp"
+#include "slide/AutoSolver.hpp"
+#include "slide/PatternDatabase.hpp"
+#include "slide/SolverProfile.hpp"
 
 #include "util/Random.hpp"
 #include "util/StopWatch.hpp"
@@ -33,6 +37,15 @@ struct Config
     int practiceNo;
     bool verbose;
     bool outputAnswer;
+    double timeLimit;
+    int threads;
+    std::string portfolio;
+    std::string profile;
+    double exploration;
+    std::size_t exactTable;
+    std::string patternDatabase;
+    bool usePatternDatabase;
+    std::size_t hitodeMemory;
     std::unordered_set<std::string> solvers;
 };
 
@@ -53,6 +66,16 @@ Config parseCommand(int argc, const char* const argv[])
         ("solver,s",          po::value<std::vector<std::string>>(),                    "solver to be used")
         ("file,f",            po::value<std::string>(&config.file)->default_value(""),  "input file")
         ("practice_no,p",     po::value<int>(&config.practiceNo)->default_value(-1),    "No of practice problem")
+        ("time_limit,T",      po::value<double>(&config.timeLimit)->default_value(0.0), "time limit [sec] (0 means no limit)")
+        ("threads,j",         po::value<int>(&config.threads)->default_value(-1),       "number of threads (-1 means all of the cores)")
+        ("portfolio,P",       po::value<std::string>(&config.portfolio)->default_value("straight:0,kurage:1,dragon:1,lizard:1"),
+                                                                                        "solvers raced by the portfolio solver (name:share,...)")
+        ("profile",           po::value<std::string>(&config.profile)->default_value(""), "file to record results to (the auto solver also reads it and explores)")
+        ("exploration",       po::value<double>(&config.exploration)->default_value(0.1), "probability that the auto solver tries a random candidate while recording to --profile")
+        ("exact_table",       po::value<std::size_t>(&config.exactTable)->default_value(1024u), "size of the transposition table of the exact solver [MiB] (0 disables it)")
+        ("pdb_dir",           po::value<std::string>(&config.patternDatabase)->default_value(""), "directory to store the pattern databases in (empty keeps them in memory)")
+        ("no_pdb",                                                                      "do not use the pattern databases")
+        ("hitode_memory",     po::value<std::size_t>(&config.hitodeMemory)->default_value(0u), "memory budget of the hitode solver [MiB] (0 keeps everything in memory)")
         ("verbose,v",                                                                   "A lot printing")
         ("output_answer,o",                                                             "Output answer")
     ;
@@ -76,6 +99,7 @@ Config parseCommand(int argc, const char* const argv[])
 
     config.verbose      = vm.count("verbose");
     config.outputAnswer = vm.count("output_answer");
+    config.usePatternDatabase = !vm.count("no_pdb");
     return config;
 }
 
@@ -97,7 +121,7 @@ slide::Problem setProblem(const Config& config)
     }
 }
 
-void solve(slide::Solver&& solver, bool outputAnswer)
+void solve(slide::Solver&& solver, const std::string& name, const Config& config)
 {
     util::StopWatch sw;
 
@@ -110,14 +134,33 @@ void solve(slide::Solver&& solver, bool outputAnswer)
                   << ", cost = " << cost << ", time = " << sw.elapsed_ms() << "ms, "
                   << (solver.problem.check(answer) ? "solved correctly." : "failed to solve!") << std::endl;
 
-        if(outputAnswer){
+        if(config.outputAnswer){
             std::cout << answer << std::endl;
         }
     };
 
+    if(config.timeLimit > 0){
+        solver.setTimeLimit(config.timeLimit);
+    }
+    if(config.threads > 0){
+        solver.numThreads = config.threads;
+    }
+
     sw.start();
     solver.solve();
+    sw.stop();
     util::StopWatch::show();
+
+    // auto は自分で記録する
+    if(!config.profile.empty() && name != "auto" && solver.bestCost() != 1 << 29){
+        slide::SolverProfile::append(config.profile, {
+            slide::SolverProfile::Features::of(solver.problem),
+            slide::SolverProfile::Parameters::of(name, solver),
+            sw.elapsed_ms(),
+            solver.bestCost(),
+            !solver.isTimeUp()
+        });
+    }
 }
 
 int main(int argc, const char* const argv[])
@@ -126,55 +169,83 @@ int main(int argc, const char* const argv[])
     const slide::Problem problem = setProblem(config);
     std::cout << problem << std::endl;
 
+    slide::PatternDatabase::enabled = config.usePatternDatabase;
+    slide::PatternDatabase::directory = config.patternDatabase;
+
     if(config.solvers.empty() || config.solvers.count("straight")){
         std::cout << "straight : ";
-        solve(slide::StraightSolver(problem), config.outputAnswer);
+        solve(slide::StraightSolver(problem), "straight", config);
     }
 
     if(config.solvers.empty() || config.solvers.count("exact")){
         std::cout << "exact    : ";
-        solve(slide::ExactSolver(problem), config.outputAnswer);
+        slide::ExactSolver solver(problem);
+        solver.tableBytes = config.exactTable << 20;
+        solve(std::move(solver), "exact", config);
     }
 
     if(config.solvers.empty() || config.solvers.count("hitode")){
         std::cout << "hitode : ";
-        solve(slide::HitodeSolver(problem), config.outputAnswer);
+        slide::HitodeSolver solver(problem);
+        solver.memoryBudget = config.hitodeMemory << 20;
+        solve(std::move(solver), "hitode", config);
     }
 
     if(config.solvers.empty() || config.solvers.count("kurage")){
         std::cout << "kurage : ";
         slide::KurageSolver::verbose = config.verbose;
-        solve(slide::KurageSolver(problem), config.outputAnswer);
+        solve(slide::KurageSolver(problem), "kurage", config);
     }
 
     if(config.solvers.empty() || config.solvers.count("shark")){
         std::cout << "shark : ";
         slide::SharkSolver::verbose = config.verbose;
-        solve(slide::SharkSolver(problem), config.outputAnswer);
+        solve(slide::SharkSolver(problem), "shark", config);
     }
 
     if(config.solvers.empty() || config.solvers.count("dolphin")){
         std::cout << "dolphin : ";
         slide::DolphinSolver::verbose = config.verbose;
-        solve(slide::DolphinSolver(problem), config.outputAnswer);
+        solve(slide::DolphinSolver(problem), "dolphin", config);
     }
 
     if(config.solvers.empty() || config.solvers.count("dragon")){
         std::cout << "dragon : ";
         slide::DragonSolver::verbose = config.verbose;
-        solve(slide::DragonSolver(problem), config.outputAnswer);
+        solve(slide::DragonSolver(problem), "dragon", config);
     }
 
     if(config.solvers.empty() || config.solvers.count("lizard")){
         std::cout << "lizard : ";
         slide::LizardSolver::verbose = config.verbose;
-        solve(slide::LizardSolver(problem), config.outputAnswer);
+        solve(slide::LizardSolver(problem), "lizard", config);
     }
 
     if(config.solvers.empty() || config.solvers.count("L2")){
         std::cout << "L2 : ";
         slide::L2Solver::verbose = config.verbose;
-        solve(slide::L2Solver(problem), config.outputAnswer);
+        solve(slide::L2Solver(problem), "L2", config);
+    }
+
+    if(config.solvers.count("portfolio")){
+        std::cout << "portfolio : ";
+        slide::PortfolioSolver::verbose = config.verbose;
+        slide::PortfolioSolver solver(problem);
+        solver.entries = slide::PortfolioSolver::parseEntries(config.portfolio);
+        solve(std::move(solver), "portfolio", config);
+        std::cout << "winner = " << solver.winner << std::endl;
+    }
+
+    if(config.solvers.count("auto")){
+        std::cout << "auto : ";
+        slide::AutoSolver::verbose = config.verbose;
+        slide::AutoSolver solver(problem);
+        if(!config.profile.empty()){
+            solver.profilePath = config.profile;
+            solver.record = true;
+            solver.exploration = config.exploration;
+        }
+        solve(std::move(solver), "auto", config);
     }
 
     return EXIT_SUCCESS;
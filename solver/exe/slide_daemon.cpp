@@ -0,0 +1,256 @@
+// 常駐して問題を受け付け，解答を返し続けるソルバ
+// 問題は PostServer (--port) で受け取り，解答は ProblemServer (--answer_port) で接続中の全クライアントへ流す．
+// 解答のメッセージは 1 行目が問題番号 (受け付けた順に 0 から)，2 行目以降が解答．
+// 解答はより良いものが見つかる度に送り，1 問あたり --time_limit 秒で打ち切る．
+// 問題は --concurrency 問まで同時に解き，1 問毎に --threads の大きさの task_arena を使う．
+// TBB のスレッドと，スレッド毎の訪問済みテーブル (GrowableConcurrentHashTable::local) はプロセス内で使い回すので，起動の時間がかからない．
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include <boost/asio.hpp>
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+#include <tbb/task_scheduler_init.h>
+
+#include "network/PostServer.hpp"
+#include "network/ProblemServer.hpp"
+#include "slide/Answer.hpp"
+#include "slide/Problem.hpp"
+#include "slide/Solver.hpp"
+#include "util/define.hpp"
+
+namespace
+{
+
+struct Config
+{
+    int port;
+    int answerPort;
+    int numThreads;
+    int concurrency;
+    double timeLimit;
+    std::string solver;
+};
+
+Config parseCommand(int argc, const char* const argv[])
+{
+    namespace po = boost::program_options;
+
+    po::options_description opt("Allowed options");
+    Config config;
+
+    opt.add_options()
+        ("help",                                                                            "print this help message")
+        ("port,p",        po::value<int>(&config.port)->default_value(12345),              "port to receive problems")
+        ("answer_port,a", po::value<int>(&config.answerPort)->default_value(12346),        "port to send answers")
+        ("threads,t",     po::value<int>(&config.numThreads)->default_value(-1),           "number of threads per problem")
+        ("concurrency,c", po::value<int>(&config.concurrency)->default_value(4),           "number of problems solved at the same time")
+        ("time_limit,T",  po::value<double>(&config.timeLimit)->default_value(MAX_SUBMITTION_TIME), "time limit per problem [sec] (0 means no limit)")
+        ("solver,s",      po::value<std::string>(&config.solver)->default_value("dragon"), "solver to be used")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opt), vm);
+    po::notify(vm);
+
+    if(vm.count("help")){
+        std::cerr << opt << std::endl;
+        std::exit(EXIT_SUCCESS);
+    }
+
+    return config;
+}
+
+// 受け付けた問題を，同時に --concurrency 問まで解く
+// 1 問に 1 つの task_arena を割り当てるので，ある問題の並列区間が他の問題のスレッドを奪い合うことはない
+// (複数のソルバを同時に走らせるなら --solver portfolio)
+class Daemon
+{
+private:
+    const Config& config;
+    network::ProblemServer& answerServer;
+
+    std::deque<std::pair<int, slide::Problem>> queue;
+    std::mutex mutex;
+    std::condition_variable condition;
+    int numAccepted = 0;
+    int numRunning = 0;
+    bool closed = false;
+
+    // 解いている問題の交換・選択コスト
+    // CostFeature のコストはプロセスで共有なので，コストの違う問題は同時に解かない
+    int runningSwappingCost = 0;
+    int runningSelectionCost = 0;
+
+public:
+    Daemon(const Config& config, network::ProblemServer& answerServer)
+        : config(config), answerServer(answerServer) {}
+
+    // 通信用のスレッドから呼ばれる
+    void push(slide::Problem problem)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::cerr << "[slide_daemon] accept problem " << numAccepted << std::endl;
+        queue.emplace_back(numAccepted++, std::move(problem));
+        condition.notify_all();
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        condition.notify_all();
+    }
+
+    void run()
+    {
+        // スケジューラを起動したままにしておく
+        // ワーカーは問題毎に numThreads 個 (このスレッドはタスクを積むだけで，どの問題も解かない)
+        const int numThreads = config.numThreads == -1 ? tbb::task_scheduler_init::default_num_threads() : config.numThreads;
+        const int concurrency = std::max(1, config.concurrency);
+        tbb::task_scheduler_init init(numThreads * concurrency + 1);
+
+        // 問題毎のタスクを走らせる arena (問題の並列区間は，その中で作る問題毎の arena で実行する)
+        tbb::task_arena arena(concurrency, 0);
+        tbb::task_group group;
+
+        while(true){
+            std::shared_ptr<std::pair<int, slide::Problem>> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this, concurrency]{ return (closed && queue.empty()) || (!queue.empty() && canStart(queue.front().second, concurrency)); });
+                if(queue.empty()){
+                    break;
+                }
+                task = std::make_shared<std::pair<int, slide::Problem>>(std::move(queue.front()));
+                queue.pop_front();
+
+                ++numRunning;
+                runningSwappingCost = task->second.swappingCost;
+                runningSelectionCost = task->second.selectionCost;
+            }
+
+            arena.execute([this, &group, task, numThreads]{
+                group.run([this, task, numThreads]{
+                    tbb::task_arena problemArena(numThreads);
+                    problemArena.execute([this, task, numThreads]{
+                        solve(task->first, task->second, numThreads);
+                    });
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    --numRunning;
+                    condition.notify_all();
+                });
+            });
+        }
+
+        arena.execute([&group]{
+            group.wait();
+        });
+    }
+
+private:
+    // mutex を取ってから呼ぶ
+    bool canStart(const slide::Problem& problem, int concurrency) const
+    {
+        if(numRunning == 0){
+            return true;
+        }
+        return numRunning < concurrency
+            && problem.swappingCost == runningSwappingCost
+            && problem.selectionCost == runningSelectionCost;
+    }
+
+    // 例外は問題毎に握りつぶし，他の問題と常駐するプロセスを止めない
+    void solve(int id, const slide::Problem& problem, int numThreads)
+    {
+        try{
+            std::unique_ptr<slide::Solver> solver = slide::Solver::create_solver(config.solver, problem);
+            solver->numThreads = numThreads;
+            if(config.timeLimit > 0){
+                solver->setTimeLimit(config.timeLimit);
+            }
+
+            // ソルバはより良い解答が見つかる度に渡してくるので，見つかったものから送る
+            solver->onImprovedAnswer = [this, id, &problem](const slide::Answer& answer, int cost, double elapsed){
+                if(!problem.check(answer)){
+                    std::cerr << "[slide_daemon] problem " << id << ": wrong answer" << std::endl;
+                    return;
+                }
+
+                std::cerr << boost::format("[slide_daemon] problem %d: cost = %d, time = %.3fms") % id % cost % elapsed << std::endl;
+                answerServer.send_problem((boost::format("%d\n%s") % id % answer.toString()).str());
+            };
+
+            solver->solve();
+        }catch(std::exception& e){
+            std::cerr << "[slide_daemon] problem " << id << ": " << e.what() << std::endl;
+        }
+    }
+};
+
+} // end of unnamed namespace
+
+int main(int argc, const char* const argv[])
+{
+    using boost::asio::ip::tcp;
+
+    const Config config = parseCommand(argc, argv);
+
+    if(slide::Solver::create_solver(config.solver, slide::Problem()) == nullptr){
+        std::cerr << "invalid solver name: " << config.solver << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try{
+        boost::asio::io_service io_service;
+
+        network::ProblemServer answerServer(io_service, tcp::endpoint(tcp::v4(), config.answerPort));
+        Daemon daemon(config, answerServer);
+
+        network::PostServer problemServer(io_service, tcp::endpoint(tcp::v4(), config.port),
+            [&daemon](std::stringstream& ss){
+                try{
+                    daemon.push(slide::Problem(ss));
+                }catch(std::exception& e){
+                    std::cerr << "[slide_daemon] Error:" << e.what() << std::endl;
+                }
+            }
+        );
+
+        boost::thread network(boost::bind(&boost::asio::io_service::run, &io_service));
+        boost::thread worker([&daemon]{ daemon.run(); });
+
+        std::string s;
+        while(std::cin >> s){
+            if(s == "end"){
+                break;
+            }
+        }
+
+        daemon.close();
+        worker.join();
+
+        problemServer.close();
+        answerServer.close();
+        io_service.stop();
+        network.join();
+    }catch(std::exception& e){
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
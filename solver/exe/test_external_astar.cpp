@@ -0,0 +1,136 @@
+// HitodeSolver の外部記憶の A* (memoryBudget > 0) を小さな盤面で最後まで動かし，正しい解答が出るかを確かめる
+//
+// 正しい盤面から選択したセルを無作為に動かした盤面を，メモリだけで解いたものとディスクを使って解いたものとで並べる．
+// memoryBudget を小さくして，層を何度にも分けて読み，Run をまとめる処理も通るようにする．
+// 解答が出ない，解答が正しくない，ファイルが残る，のいずれかで失敗とする．
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+
+#include "slide/HitodeSolver.hpp"
+#include "slide/Problem.hpp"
+#include "util/define.hpp"
+#include "util/Random.hpp"
+
+namespace
+{
+
+using namespace slide;
+
+// 正しい盤面から 1 つのセルを選び，steps 回動かした問題
+Problem makeProblem(int h, int w, int steps)
+{
+    const int swappingCost   = util::Random::nextInt(MIN_SWAPPING_COST,   MAX_SWAPPING_COST);
+    const int selectionCost  = util::Random::nextInt(MIN_SELECTION_COST,  MAX_SELECTION_COST);
+    const int selectionLimit = util::Random::nextInt(MIN_SELECTION_LIMIT, MAX_SELECTION_LIMIT);
+
+    Problem problem(h, w, swappingCost, selectionCost, selectionLimit);
+    problem.board = Board<Flexible>::finishedState(h, w);
+
+    Point p(util::Random::nextInt(0, h-1), util::Random::nextInt(0, w-1));
+    rep(i, steps){
+        const Point q = p + Point::delta(Direction(util::Random::nextInt(0, 3)));
+        if(!q.isIn(h, w)){
+            continue;
+        }
+        std::swap(problem.board(p), problem.board(q));
+        p = q;
+    }
+
+    return problem;
+}
+
+// 解けなければ none
+boost::optional<int> solve(const Problem& problem, std::size_t memoryBudget, const std::string& directory, double timeLimit)
+{
+    HitodeSolver solver(problem);
+    solver.memoryBudget = memoryBudget;
+    solver.spillDirectory = directory;
+    solver.setTimeLimit(timeLimit);
+
+    boost::optional<int> cost;
+    solver.onCreatedAnswer = [&problem, &cost](const Answer& answer){
+        cost = problem.check(answer);
+    };
+    solver.solve();
+
+    return cost;
+}
+
+} // end of unnamed namespace
+
+int main(int argc, const char* const argv[])
+{
+    namespace po = boost::program_options;
+    namespace fs = boost::filesystem;
+
+    int numBoards;
+    int steps;
+    std::size_t memoryBudget;
+    double timeLimit;
+
+    po::options_description opt("Allowed options");
+    opt.add_options()
+        ("help",                                                                      "print this help message")
+        ("boards,n",     po::value<int>(&numBoards)->default_value(5),              "number of random boards per size")
+        ("steps,s",      po::value<int>(&steps)->default_value(24),                 "number of moves to scramble the board")
+        ("memory,m",     po::value<std::size_t>(&memoryBudget)->default_value(4),   "memory budget of the external search [KiB]")
+        ("time_limit,T", po::value<double>(&timeLimit)->default_value(30.0),        "time limit per board [sec]")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opt), vm);
+    po::notify(vm);
+
+    if(vm.count("help")){
+        std::cerr << opt << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    const fs::path directory = fs::temp_directory_path() / fs::unique_path("test_external_astar_%%%%%%%%");
+
+    std::cout << boost::format("%6s %8s %10s %10s") % "size" % "board" % "memory" % "external" << std::endl;
+
+    const int sizes[][2] = {{3, 3}, {3, 4}, {4, 4}};
+
+    bool ok = true;
+    for(const auto& size : sizes){
+        const int h = size[0], w = size[1];
+
+        rep(n, numBoards){
+            const Problem problem = makeProblem(h, w, steps);
+            if(problem.board.isFinished()){
+                continue;
+            }
+
+            const boost::optional<int> inMemory = solve(problem, 0, directory.string(), timeLimit);
+            const boost::optional<int> external = solve(problem, memoryBudget << 10, directory.string(), timeLimit);
+
+            std::cout << boost::format("%3dx%-2d %8d %10s %10s") % h % w % n
+                % (inMemory ? std::to_string(*inMemory) : "-") % (external ? std::to_string(*external) : "-") << std::endl;
+
+            if(!external){
+                std::cerr << "no correct answer from the external search" << std::endl;
+                std::cerr << problem << std::endl;
+                ok = false;
+            }
+
+            // 層と Run のファイルは探索を終えたら消えているはず
+            if(!fs::is_empty(directory)){
+                std::cerr << "files are left in " << directory.string() << std::endl;
+                ok = false;
+            }
+        }
+    }
+
+    fs::remove_all(directory);
+
+    std::cout << (ok ? "OK" : "FAILED") << std::endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,145 @@
+// パターンデータベースを使った下界が許容的 (最適な解答のコストを超えない) ことを確かめる
+//
+// 正しい盤面から選択したセルを無作為に動かした小さな盤面について，パターンデータベースを使わない
+// ExactSolver (マンハッタン距離による IDA*) で最適な解答を求め，次の 2 つを確かめる．
+// - パターンデータベースの値 (断片のセルが動く延べ回数の下界) が，その解答の交換回数の 2 倍以下
+// - パターンデータベースを使った AdmissibleBoard の下界が，その解答のコスト以下
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include "slide/AdmissibleBoard.hpp"
+#include "slide/CostFeature.hpp"
+#include "slide/ExactSolver.hpp"
+#include "slide/PatternDatabase.hpp"
+#include "slide/PatternFeature.hpp"
+#include "slide/PlayBoard.hpp"
+#include "util/define.hpp"
+#include "util/Random.hpp"
+
+namespace
+{
+
+using namespace slide;
+
+// 正しい盤面から 1 つのセルを選び，steps 回動かした問題
+Problem makeProblem(int h, int w, int steps)
+{
+    const int swappingCost   = util::Random::nextInt(MIN_SWAPPING_COST,   MAX_SWAPPING_COST);
+    const int selectionCost  = util::Random::nextInt(MIN_SELECTION_COST,  MAX_SELECTION_COST);
+    const int selectionLimit = util::Random::nextInt(MIN_SELECTION_LIMIT, MAX_SELECTION_LIMIT);
+
+    Problem problem(h, w, swappingCost, selectionCost, selectionLimit);
+    problem.board = Board<Flexible>::finishedState(h, w);
+
+    Point p(util::Random::nextInt(0, h-1), util::Random::nextInt(0, w-1));
+    rep(i, steps){
+        const Point q = p + Point::delta(Direction(util::Random::nextInt(0, 3)));
+        if(!q.isIn(h, w)){
+            continue;
+        }
+        std::swap(problem.board(p), problem.board(q));
+        p = q;
+    }
+
+    return problem;
+}
+
+} // end of unnamed namespace
+
+int main(int argc, const char* const argv[])
+{
+    namespace po = boost::program_options;
+
+    int numBoards;
+    int steps;
+    double timeLimit;
+
+    po::options_description opt("Allowed options");
+    opt.add_options()
+        ("help",                                                                   "print this help message")
+        ("boards,n",     po::value<int>(&numBoards)->default_value(20),         "number of random boards per size")
+        ("steps,s",      po::value<int>(&steps)->default_value(24),             "number of moves to scramble the board")
+        ("time_limit,T", po::value<double>(&timeLimit)->default_value(10.0),    "time limit of the exact solver per board [sec]")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opt), vm);
+    po::notify(vm);
+
+    if(vm.count("help")){
+        std::cerr << opt << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << boost::format("%6s %8s %8s %12s %12s") % "size" % "checked" % "skipped" % "pdb/2swap" % "bound/cost" << std::endl;
+
+    const int sizes[][2] = {{3, 3}, {3, 4}, {4, 3}, {4, 4}};
+
+    for(const auto& size : sizes){
+        const int h = size[0], w = size[1];
+        int checked = 0, skipped = 0;
+        double patternRatio = 0.0, boundRatio = 0.0;
+
+        rep(n, numBoards){
+            const Problem problem = makeProblem(h, w, steps);
+            if(problem.board.isFinished()){
+                continue;
+            }
+
+            // パターンデータベースを使わずに最適な解答を求める
+            PatternDatabase::enabled = false;
+
+            ExactSolver solver(problem);
+            solver.setTimeLimit(timeLimit);
+            Answer optimal;
+            bool found = false;
+            solver.onCreatedAnswer = [&optimal, &found](const Answer& answer){
+                optimal = answer;
+                found = true;
+            };
+            solver.solve();
+
+            if(!found){
+                ++skipped;
+                continue;
+            }
+
+            const int numSelect = std::count_if(optimal.begin(), optimal.end(), [](Move move){ return move.isSelection; });
+            const int numSwap = optimal.size() - numSelect;
+            const int cost = solver.cost(optimal);
+
+            // パターンデータベースを使った下界
+            PatternDatabase::enabled = true;
+            if(PatternDatabase::load(h, w) == nullptr){
+                std::cerr << "no pattern database for " << h << "x" << w << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            CostFeature::setCosts(problem.swappingCost, problem.selectionCost);
+            const PlayBoard<Flexible> board(problem.board);
+            const PatternFeature pattern(board);
+            const AdmissibleBoard<Flexible> admissible(board, problem.selectionLimit);
+
+            if(pattern() > 2 * numSwap || admissible.lowerBound > cost){
+                std::cerr << boost::format("not admissible on %dx%d: pattern = %d, swap = %d, bound = %d, cost = %d")
+                    % h % w % pattern() % numSwap % admissible.lowerBound % cost << std::endl;
+                std::cerr << problem << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            ++checked;
+            patternRatio += numSwap > 0 ? double(pattern()) / (2 * numSwap) : 1.0;
+            boundRatio += double(admissible.lowerBound) / cost;
+        }
+
+        std::cout << boost::format("%3dx%-2d %8d %8d %12.3f %12.3f") % h % w % checked % skipped
+            % (patternRatio / std::max(1, checked)) % (boundRatio / std::max(1, checked)) << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
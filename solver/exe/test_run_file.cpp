@@ -0,0 +1,217 @@
+// SpillFile と Run に小さな探索の前線 (未処理の節点) を書き出し，読み戻して同じ内容になるかを確かめる
+//
+// - SpillFile に書き足したレコードが，chunk 個ずつ書いた順に読み戻せる
+// - ハッシュ値で並べて Run に書いたレコードが，RunReader と find で読み戻せる (ブロックをまたぐ大きさ)
+// - ファイルが消えたり短くなったりしたら，黙って壊れた値を返さずに例外を投げる
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include "util/define.hpp"
+#include "util/Random.hpp"
+#include "util/RunFile.hpp"
+
+namespace
+{
+
+// 前線の節点 (ExternalAstar の層のレコードを模したもの)
+struct Node
+{
+    ull hash;
+    ull parent;
+    int cost;
+    uchar cells[16];
+};
+
+bool operator==(const Node& lhs, const Node& rhs)
+{
+    return std::memcmp(&lhs, &rhs, sizeof(Node)) == 0;
+}
+
+std::vector<Node> makeFrontier(int size)
+{
+    std::vector<Node> nodes(size);
+    rep(i, size){
+        Node& node = nodes[i];
+        std::memset(&node, 0, sizeof(node));
+        // 同じハッシュ値が並ぶ場合も試すため，値の範囲を狭める
+        node.hash = util::Random::nextInt(1, size / 2 + 1) * 0x9e3779b97f4a7c15ull;
+        node.parent = util::Random::nextULL();
+        node.cost = i;
+        rep(k, 16){
+            node.cells[k] = util::Random::nextInt(0, 255);
+        }
+    }
+    return nodes;
+}
+
+bool check(bool condition, const std::string& message)
+{
+    if(!condition){
+        std::cerr << "failed: " << message << std::endl;
+    }
+    return condition;
+}
+
+// 書き足した順に chunk 個ずつ読み戻せるか
+bool testSpillFile(const std::string& directory, const std::vector<Node>& nodes, std::size_t chunk)
+{
+    util::SpillFile file(directory + "/spill.bin", sizeof(Node));
+    for(const Node& node : nodes){
+        file.append(&node);
+    }
+
+    std::vector<Node> read;
+    bool ok = true;
+    file.forEachChunk(chunk, [&read, &ok, chunk](const char* records, std::size_t count){
+        ok = ok && count <= chunk;
+        rep(i, count){
+            Node node;
+            std::memcpy(&node, records + i * sizeof(Node), sizeof(Node));
+            read.push_back(node);
+        }
+    });
+
+    return check(ok, "chunk is larger than requested")
+        && check(file.size() == nodes.size(), "spill file size")
+        && check(read == nodes, (boost::format("spill file contents (chunk = %d)") % chunk).str());
+}
+
+// ハッシュ値の昇順に Run へ書き，先頭から読んでも find で探しても同じものが出てくるか
+bool testRun(const std::string& directory, std::vector<Node> nodes)
+{
+    std::stable_sort(nodes.begin(), nodes.end(), [](const Node& a, const Node& b){ return a.hash < b.hash; });
+
+    util::Run run(directory + "/run.bin", sizeof(Node));
+    {
+        util::RunWriter writer(run);
+        for(const Node& node : nodes){
+            writer.write(node.hash, &node);
+        }
+        writer.close();
+    }
+
+    bool ok = check(run.size() == nodes.size(), "run size")
+        && check(run.index().size() == (nodes.size() + util::Run::BLOCK_RECORDS - 1) / util::Run::BLOCK_RECORDS, "run blocks");
+
+    {
+        util::RunReader reader(run);
+        std::vector<Node> read;
+        ull key;
+        Node node;
+        while(reader.next(key, &node)){
+            ok = ok && check(key == node.hash, "run key");
+            read.push_back(node);
+        }
+        ok = ok && check(read == nodes, "run contents");
+    }
+
+    rep(i, 100){
+        const Node& target = nodes[util::Random::nextInt(0, nodes.size() - 1)];
+        const std::vector<std::vector<char>> found = run.find(target.hash);
+        const std::size_t expected = std::count_if(nodes.begin(), nodes.end(), [&target](const Node& n){ return n.hash == target.hash; });
+        ok = ok && check(found.size() == expected, "run find count")
+            && check(std::any_of(found.begin(), found.end(), [&target](const std::vector<char>& p){ return std::memcmp(p.data(), &target, sizeof(Node)) == 0; }), "run find payload");
+    }
+    ok = ok && check(run.find(1ull).empty(), "run find missing key");
+
+    return ok;
+}
+
+// 読み書きできないときに例外を投げるか
+template<typename F>
+bool throws(F f)
+{
+    try{
+        f();
+    }catch(std::runtime_error& e){
+        return true;
+    }
+    return false;
+}
+
+bool testErrors(const std::string& directory, std::vector<Node> nodes)
+{
+    std::stable_sort(nodes.begin(), nodes.end(), [](const Node& a, const Node& b){ return a.hash < b.hash; });
+
+    bool ok = check(throws([&directory](){ util::SpillFile(directory + "/missing/spill.bin", sizeof(Node)); }), "open spill file in missing directory");
+
+    util::Run run(directory + "/broken.bin", sizeof(Node));
+    {
+        util::RunWriter writer(run);
+        for(const Node& node : nodes){
+            writer.write(node.hash, &node);
+        }
+        writer.close();
+    }
+
+    // 途中で切れたファイル
+    std::ofstream(run.path().c_str(), std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(nodes.data()), sizeof(Node));
+    ok = ok && check(throws([&run](){
+        util::RunReader reader(run);
+        ull key;
+        Node node;
+        while(reader.next(key, &node));
+    }), "read truncated run");
+    ok = ok && check(throws([&run, &nodes](){ run.find(nodes.back().hash); }), "find in truncated run");
+
+    // 消えたファイル
+    boost::filesystem::remove(run.path());
+    ok = ok && check(throws([&run](){ util::RunReader reader(run); }), "open removed run");
+
+    return ok;
+}
+
+} // end of unnamed namespace
+
+int main(int argc, const char* const argv[])
+{
+    namespace po = boost::program_options;
+    namespace fs = boost::filesystem;
+
+    int size;
+
+    po::options_description opt("Allowed options");
+    opt.add_options()
+        ("help",                                                         "print this help message")
+        ("size,n", po::value<int>(&size)->default_value(5000),        "number of nodes in the frontier")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opt), vm);
+    po::notify(vm);
+
+    if(vm.count("help")){
+        std::cerr << opt << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    const fs::path directory = fs::temp_directory_path() / fs::unique_path("test_run_file_%%%%%%%%");
+    fs::create_directories(directory);
+
+    const std::vector<Node> nodes = makeFrontier(std::max(size, 2));
+
+    bool ok = true;
+    for(std::size_t chunk : {std::size_t(1), std::size_t(7), std::size_t(1000), nodes.size() + 1}){
+        ok = testSpillFile(directory.string(), nodes, chunk) && ok;
+    }
+    ok = testRun(directory.string(), nodes) && ok;
+    ok = testErrors(directory.string(), nodes) && ok;
+
+    // Run と SpillFile はファイルを消しているはず
+    ok = check(fs::is_empty(directory), "files are left in " + directory.string()) && ok;
+    fs::remove_all(directory);
+
+    std::cout << (ok ? "OK" : "FAILED") << std::endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
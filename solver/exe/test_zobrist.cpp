@@ -0,0 +1,323 @@
+// ZobristTable のハッシュ値の衝突率と速さを，(id, 位置) 毎に乱数を持つ元々の表と比べる
+//
+// ランダムな盤面から選択と交換を繰り返して状態を集め，重複を除いた状態について
+// ハッシュ値の下位 (と上位) b bit が衝突した数を，一様な乱数での期待値と並べて出す．
+// 交換 1 回分の差分の計算時間は，表がキャッシュに載ったままの場合と，--evict の大きさの領域を読んで追い出した後の場合とを出す．
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include "slide/PlayBoard.hpp"
+#include "slide/ZobristTable.hpp"
+#include "util/define.hpp"
+#include "util/Random.hpp"
+
+namespace
+{
+
+using namespace slide;
+using Clock = std::chrono::high_resolution_clock;
+
+// 元々の表 ([id][pos] 毎に乱数を持つ)
+class ReferenceTable
+{
+private:
+    std::vector<ull> table;
+    std::vector<ull> selectedTable;
+
+public:
+    ReferenceTable() : table(256 * 256), selectedTable(256)
+    {
+        for(ull& key : table) key = util::Random::nextULL();
+        for(ull& key : selectedTable) key = util::Random::nextULL();
+    }
+
+    ull look(uchar id, Point pos) const {
+        return table[id * 256 + pos.toInt()];
+    }
+
+    ull lookSelected(uchar id) const {
+        return selectedTable[id];
+    }
+
+    ull swapDelta(uchar id1, uchar id2, Point src1, Point src2) const {
+        return look(id1, src1) ^ look(id1, src2) ^ look(id2, src1) ^ look(id2, src2);
+    }
+};
+
+template<typename Table>
+ull computeHash(const Table& table, const PlayBoard<Flexible>& board)
+{
+    ull hash = 0ull;
+    rep(i, board.height()) rep(j, board.width()){
+        hash ^= table.look(board(i, j), Point(i, j));
+    }
+    return board.isSelected() ? hash ^ table.lookSelected(board(board.selected)) : hash;
+}
+
+std::string stateKey(const PlayBoard<Flexible>& board)
+{
+    std::string ret(board.data(), board.data() + board.area());
+    ret.push_back(static_cast<char>(board.selected.toInt()));
+    return ret;
+}
+
+// 一様な乱数の n 個の値を 2^bits 通りに振ったとき，他と重なる値の数の期待値
+double expectedCollisions(double n, int bits)
+{
+    const double m = std::ldexp(1.0, bits);
+    return n - m * -std::expm1(n * std::log1p(-1.0 / m));
+}
+
+ull countCollisions(std::vector<ull> hashes, int bits, bool high)
+{
+    for(ull& hash : hashes){
+        hash = high ? hash >> (64 - bits) : (bits == 64 ? hash : hash & ((1ull << bits) - 1));
+    }
+    std::sort(hashes.begin(), hashes.end());
+    return hashes.size() - (std::unique(hashes.begin(), hashes.end()) - hashes.begin());
+}
+
+// 選択と交換を繰り返して歩く (直前の交換を戻す交換はしない)
+class RandomWalk
+{
+private:
+    PlayBoard<Flexible> board;
+    int step = 0;
+    Direction previous = Direction::Up;
+
+public:
+    explicit RandomWalk(int h, int w) : board(Board<Flexible>::randomState(h, w)) {
+        board.select(Point(util::Random::nextInt(0, h-1), util::Random::nextInt(0, w-1)));
+    }
+
+    const PlayBoard<Flexible>& current() const {
+        return board;
+    }
+
+    // 選択し直したら true
+    bool next(Direction& dir, Point& newSelect)
+    {
+        if(++step % 64 == 0){
+            newSelect = Point(util::Random::nextInt(0, board.height()-1), util::Random::nextInt(0, board.width()-1));
+            board.select(newSelect);
+            return true;
+        }
+
+        do{
+            dir = Direction(util::Random::nextInt(0, 3));
+        } while(!board.isValidMove(dir) || (step % 64 != 1 && dir == previous.opposite()));
+
+        board.move(dir);
+        previous = dir;
+        return false;
+    }
+};
+
+// 歩きながら差分で更新したハッシュ値
+template<typename Table>
+class IncrementalHash
+{
+private:
+    const Table& table;
+    ull hash;
+
+public:
+    IncrementalHash(const Table& table, const PlayBoard<Flexible>& board) : table(table), hash(computeHash(table, board)) {}
+
+    ull operator()() const {
+        return hash;
+    }
+
+    // board は交換後の盤面
+    void move(const PlayBoard<Flexible>& board, Direction dir)
+    {
+        const Point src1 = board.selected - Point::delta(dir);
+        const Point src2 = board.selected;
+        hash ^= table.swapDelta(board(src2), board(src1), src1, src2);
+    }
+
+    void select(const PlayBoard<Flexible>& board, uchar preSelId)
+    {
+        hash ^= table.lookSelected(preSelId) ^ table.lookSelected(board(board.selected));
+    }
+};
+
+// 歩いた道の交換
+struct Swap
+{
+    uchar id1, id2;
+    Point src1, src2;
+};
+
+std::vector<Swap> recordSwaps(int h, int w, int steps)
+{
+    std::vector<Swap> ret;
+    RandomWalk walk(h, w);
+    while(ret.size() < static_cast<std::size_t>(steps)){
+        Direction dir = Direction::Up;
+        Point newSelect;
+        if(!walk.next(dir, newSelect)){
+            const PlayBoard<Flexible>& board = walk.current();
+            const Point src1 = board.selected - Point::delta(dir);
+            ret.push_back({board(board.selected), board(src1), src1, board.selected});
+        }
+    }
+    return ret;
+}
+
+template<typename Table>
+double measureSwaps(const Table& table, const std::vector<Swap>& swaps, int repeat)
+{
+    ull hash = 0ull;
+
+    const Clock::time_point begin = Clock::now();
+    rep(r, repeat) for(const Swap& swap : swaps){
+        hash ^= table.swapDelta(swap.id1, swap.id2, swap.src1, swap.src2);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / (double(repeat) * swaps.size());
+
+    if(hash == 42ull){
+        std::cout << std::endl;
+    }
+    return ns;
+}
+
+// 表が L1, L2 から追い出された後の速さ (探索では子を作る合間に訪問済みの表などを引くので，その間に鍵の表も追い出される)
+// batch 回の交換毎に evict を 1 周読み，続く batch 回の交換だけを測る
+template<typename Table>
+double measureColdSwaps(const Table& table, const std::vector<Swap>& swaps, const std::vector<ull>& evict, int batch)
+{
+    ull hash = 0ull;
+    ull sink = 0ull;
+    double total = 0.0;
+    std::size_t count = 0;
+
+    for(std::size_t begin = 0; begin + batch <= swaps.size(); begin += batch){
+        // キャッシュラインに 1 つずつ触る
+        for(std::size_t i = 0; i < evict.size(); i += 8){
+            sink += evict[i];
+        }
+
+        const Clock::time_point t = Clock::now();
+        for(std::size_t k = begin; k < begin + batch; ++k){
+            const Swap& swap = swaps[k];
+            hash ^= table.swapDelta(swap.id1, swap.id2, swap.src1, swap.src2);
+        }
+        total += std::chrono::duration<double, std::nano>(Clock::now() - t).count();
+        count += batch;
+    }
+
+    if((hash ^ sink) == 42ull){
+        std::cout << std::endl;
+    }
+    return total / count;
+}
+
+} // end of unnamed namespace
+
+int main(int argc, const char* const argv[])
+{
+    namespace po = boost::program_options;
+
+    int numStates;
+    int timingSteps;
+    int evictMiB;
+    int coldBatch;
+
+    po::options_description opt("Allowed options");
+    opt.add_options()
+        ("help",                                                             "print this help message")
+        ("states,n", po::value<int>(&numStates)->default_value(1 << 18),    "number of visited states per size")
+        ("steps,s",  po::value<int>(&timingSteps)->default_value(1 << 22),  "number of swaps for timing")
+        ("evict,e",  po::value<int>(&evictMiB)->default_value(8),           "size of the buffer read between cold-cache batches [MiB]")
+        ("batch,b",  po::value<int>(&coldBatch)->default_value(256),         "number of swaps timed after each eviction")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opt), vm);
+    po::notify(vm);
+
+    if(vm.count("help")){
+        std::cerr << opt << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    const int sizes[][2] = {{4, 4}, {8, 8}, {16, 16}};
+
+    // L2 より大きくしておく
+    std::vector<ull> evict((std::size_t(evictMiB) << 20) / sizeof(ull));
+    for(ull& x : evict) x = util::Random::nextULL();
+    const int bits[] = {20, 24, 28, 32, 64};
+
+    for(const auto& size : sizes){
+        const int h = size[0], w = size[1];
+
+        const ZobristTable<Flexible> zobrist(h, w);
+        const ReferenceTable reference;
+
+        // 状態を集める (差分で更新した値が作り直した値と一致することも確かめる)
+        std::unordered_map<std::string, std::pair<ull, ull>> states;
+        RandomWalk walk(h, w);
+        IncrementalHash<ZobristTable<Flexible>> hash(zobrist, walk.current());
+        IncrementalHash<ReferenceTable> referenceHash(reference, walk.current());
+
+        while(states.size() < static_cast<std::size_t>(numStates)){
+            const uchar selId = walk.current()(walk.current().selected);
+            Direction dir = Direction::Up;
+            Point newSelect;
+            if(walk.next(dir, newSelect)){
+                hash.select(walk.current(), selId);
+                referenceHash.select(walk.current(), selId);
+            }
+            else{
+                hash.move(walk.current(), dir);
+                referenceHash.move(walk.current(), dir);
+            }
+
+            if(states.size() % 4096 == 0 && hash() != computeHash(zobrist, walk.current())){
+                std::cerr << "incremental hash mismatch on " << h << "x" << w << std::endl;
+                return EXIT_FAILURE;
+            }
+            states.emplace(stateKey(walk.current()), std::make_pair(hash(), referenceHash()));
+        }
+
+        std::vector<ull> hashes, referenceHashes;
+        for(const auto& state : states){
+            hashes.push_back(state.second.first);
+            referenceHashes.push_back(state.second.second);
+        }
+
+        const std::vector<Swap> swaps = recordSwaps(h, w, 1 << 16);
+        const int repeat = std::max(1, timingSteps / int(swaps.size()));
+        std::cout << boost::format("%dx%d: %d states, swap delta %.2f ns (reference %.2f ns)")
+            % h % w % states.size() % measureSwaps(zobrist, swaps, repeat) % measureSwaps(reference, swaps, repeat) << std::endl;
+
+        // 探索では色々な盤面の子を順に作るので，交換の順も混ぜる
+        std::vector<Swap> shuffled = swaps;
+        rep(i, shuffled.size()){
+            std::swap(shuffled[i], shuffled[util::Random::nextInt(i, shuffled.size() - 1)]);
+        }
+        std::cout << boost::format("  cold cache: swap delta %.2f ns (reference %.2f ns), shuffled %.2f ns (reference %.2f ns)")
+            % measureColdSwaps(zobrist, swaps, evict, coldBatch) % measureColdSwaps(reference, swaps, evict, coldBatch)
+            % measureColdSwaps(zobrist, shuffled, evict, coldBatch) % measureColdSwaps(reference, shuffled, evict, coldBatch) << std::endl;
+        std::cout << boost::format("  %6s %12s %12s %12s %12s %12s") % "bits" % "expected" % "low" % "high" % "ref low" % "ref high" << std::endl;
+        for(const int b : bits){
+            std::cout << boost::format("  %6d %12.1f %12d %12d %12d %12d") % b % expectedCollisions(states.size(), b)
+                % countCollisions(hashes, b, false) % countCollisions(hashes, b, true)
+                % countCollisions(referenceHashes, b, false) % countCollisions(referenceHashes, b, true) << std::endl;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -4,6 +4,7 @@
 #include "CostFeature.hpp"
 #include "ManhattanFeature.hpp"
 #include "ParityFeature.hpp"
+#include "PatternFeature.hpp"
 #include "PlayBoard.hpp"
 
 namespace slide
@@ -16,6 +17,7 @@ class AdmissibleBoardBase : public PlayBoardBase<H, W>, public CMPFeatures
 {
 private:
     ParityFeature<H, W> parity;
+    PatternFeature pattern;
 
 public:
     int lowerBound;
@@ -34,8 +36,10 @@ public:
     {
         PlayBoardBase<H, W>::operator=(board);
         CostFeature::init(selectionLimit);
-        ManhattanFeature::init(*this);
-        parity.init(*this);
+        const FeatureSums sums = computeFeatureSums(*this, FeatureSums::PARITY);
+        ManhattanFeature::init(*this, sums);
+        parity.init(*this, sums);
+        pattern.init(*this);
         lowerBound = computeLowerBound();
     }
 
@@ -54,8 +58,9 @@ public:
             return 1 << 29;
         }
 
-        // Manhattan 1
-        const int m1 = swappingCost * ((selManhattan + manhattan + 1) >> 1) + (isSelected() && !parity() ? 0 : selectionCost);
+        // Manhattan 1 (パターンデータベースがあれば，マンハッタン距離の代わりにその値を使う)
+        const int moved = std::max<int>(selManhattan + manhattan, pattern());
+        const int m1 = swappingCost * ((moved + 1) >> 1) + (isSelected() && !parity() ? 0 : selectionCost);
 
         // Manhattan 2
         constexpr int manhattan2Table[] = {0, 2, 4, 7, 10, 13, 16, 20, 24, 28, 32, 36, 40, 45, 50, 55, 60};
@@ -84,6 +89,7 @@ public:
         CostFeature::move();
         ManhattanFeature::move(*this, dir);
         parity.move();
+        pattern.move(*this, dir);
         lowerBound = computeLowerBound();
     }
 
@@ -1,11 +1,18 @@
 #ifndef SLIDE_ANSWER_LINEAR_TREE_HPP_
 #define SLIDE_ANSWER_LINEAR_TREE_HPP_
 
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <vector>
 
+#include <boost/assert.hpp>
+
 #include "Answer.hpp"
 #include "util/SpinMutex.hpp"
+#include "util/ThreadIndexManager.hpp"
 
 namespace slide
 {
@@ -22,27 +29,228 @@ public:
         : parentIndex(parentIndex), move(move), parentThread(parentThread) {}
 };
 
+// 解答木の節点を持つアリーナ
+// 探索毎に作って盤面に渡し，探索が終われば節点ごと破棄する．
+// 節点はスレッド毎に固定長のチャンクへ追加するので，追加中でも既存の節点は移動しない．
+// reclaim で生き残っている盤面から辿れない節点を捨てる．
 class AnswerLinearTree
 {
+public:
+    static constexpr uint NONE         = std::numeric_limits<uint>::max();
+    static constexpr int  CHUNK_BITS   = 16;
+    static constexpr uint CHUNK_SIZE   = 1u << CHUNK_BITS;
+    static constexpr uint CHUNK_MASK   = CHUNK_SIZE - 1;
+
+    // チャンクへのポインタは BLOCK_SIZE 個ずつのブロックにまとめ，ブロックの表は最大数を確保しておく
+    // (他スレッドが参照している間に再確保されないように．表は 2 KiB，ブロックは使う分だけ確保する)
+    static constexpr int  BLOCK_BITS   = 8;
+    static constexpr std::size_t BLOCK_SIZE = std::size_t(1) << BLOCK_BITS;
+    static constexpr std::size_t BLOCK_MASK = BLOCK_SIZE - 1;
+    static constexpr std::size_t MAX_BLOCKS = std::size_t(1) << (32 - CHUNK_BITS - BLOCK_BITS);
+
+    // 節点数がこれを超えるまでは回収しない
+    static constexpr std::size_t MIN_RECLAIM_SIZE = std::size_t(1) << 20;
+
 private:
-    AnswerLinearTree() = delete;
+    using Chunk = std::unique_ptr<AnswerLinearTreeNode[]>;
+
+    struct Storage
+    {
+        std::vector<std::unique_ptr<Chunk[]>> blocks;
+        std::size_t numChunks = 0;
+        uint size = 0;
+
+        Chunk& chunk(std::size_t i)
+        {
+            return blocks[i >> BLOCK_BITS][i & BLOCK_MASK];
+        }
+
+        const Chunk& chunk(std::size_t i) const
+        {
+            return blocks[i >> BLOCK_BITS][i & BLOCK_MASK];
+        }
+
+        void pushChunk(Chunk chunk)
+        {
+            if(numChunks == blocks.size() * BLOCK_SIZE){
+                BOOST_ASSERT(blocks.size() < MAX_BLOCKS);
+                if(blocks.empty()){
+                    blocks.reserve(MAX_BLOCKS);
+                }
+                blocks.emplace_back(new Chunk[BLOCK_SIZE]);
+            }
+            this->chunk(numChunks) = std::move(chunk);
+            ++numChunks;
+        }
+
+        Chunk popChunk()
+        {
+            --numChunks;
+            return std::move(chunk(numChunks));
+        }
+    };
+
+    std::vector<Storage> storages;
+    std::vector<Chunk> freeChunks;
+    util::SpinMutex mutex;
+
+    std::size_t reclaimSize = MIN_RECLAIM_SIZE;
+
+    Chunk allocateChunk()
+    {
+        std::lock_guard<util::SpinMutex> lock(mutex);
+        if(freeChunks.empty()){
+            return Chunk(new AnswerLinearTreeNode[CHUNK_SIZE]);
+        }
+
+        Chunk ret = std::move(freeChunks.back());
+        freeChunks.pop_back();
+        return ret;
+    }
+
+    void push_back(Storage& storage, const AnswerLinearTreeNode& node)
+    {
+        if(storage.size == storage.numChunks * CHUNK_SIZE){
+            storage.pushChunk(allocateChunk());
+        }
+
+        storage.chunk(storage.size >> CHUNK_BITS)[storage.size & CHUNK_MASK] = node;
+        ++storage.size;
+    }
+
+    void releaseChunks(Storage& storage)
+    {
+        std::lock_guard<util::SpinMutex> lock(mutex);
+        while(storage.numChunks > 0){
+            freeChunks.push_back(storage.popChunk());
+        }
+        storage.size = 0;
+    }
 
 public:
-    static std::vector<std::vector<AnswerLinearTreeNode>> nodes;
-    static util::SpinMutex mutex;
+    AnswerLinearTree() : storages(util::ThreadIndexManager::MAX_THREADS) {}
 
-    static uint add(uint parentIndex, Move move, uchar parentThread, uchar thisThread)
+    AnswerLinearTree(const AnswerLinearTree&) = delete;
+    AnswerLinearTree& operator=(const AnswerLinearTree&) = delete;
+
+    uint add(uint parentIndex, Move move, uchar parentThread, uchar thisThread)
     {
-        if(nodes.size() <= thisThread){
+        Storage& storage = storages[thisThread];
+        const uint ret = storage.size;
+        push_back(storage, AnswerLinearTreeNode(parentIndex, move, parentThread));
+        return ret;
+    }
+
+    const AnswerLinearTreeNode& at(uchar thread, uint index) const
+    {
+        BOOST_ASSERT(index < storages[thread].size);
+        return storages[thread].chunk(index >> CHUNK_BITS)[index & CHUNK_MASK];
+    }
+
+    std::size_t size() const
+    {
+        std::size_t ret = 0;
+        for(const Storage& storage : storages){
+            ret += storage.size;
+        }
+        return ret;
+    }
+
+    // 前回の回収から節点が十分に増えたか
+    bool needsReclaim() const
+    {
+        return size() >= reclaimSize;
+    }
+
+    // 全ての節点を捨てる (チャンクは再利用のために残す)
+    void clear()
+    {
+        for(Storage& storage : storages){
+            releaseChunks(storage);
+        }
+        reclaimSize = MIN_RECLAIM_SIZE;
+    }
+
+    // roots から辿れる節点だけを前に詰め直し (mark and compact)，roots の index を付け替える．
+    // 余ったチャンクは解放するので，メモリ使用量は生きている経路の節点数に比例する．
+    // Feature は index, thread を持つ型 (AnswerTreeFeature)．並列に呼んではならない．
+    template<typename Feature>
+    void reclaim(const std::vector<Feature*>& roots)
+    {
+        // 辿れる節点に印を付ける
+        std::vector<std::vector<uint>> newIndex(util::ThreadIndexManager::MAX_THREADS);
+        rep(t, util::ThreadIndexManager::MAX_THREADS){
+            newIndex[t].assign(storages[t].size, NONE);
+        }
+
+        for(const Feature* root : roots){
+            uint index = root->index;
+            uchar thread = root->thread;
+            while(index != NONE && newIndex[thread][index] == NONE){
+                newIndex[thread][index] = 0;
+                const AnswerLinearTreeNode& node = at(thread, index);
+                index = node.parentIndex;
+                thread = node.parentThread;
+            }
+        }
+
+        // スレッド毎に元の順序のまま番号を振り直す (新しい番号は元の番号以下になる)
+        std::size_t live = 0;
+        rep(t, util::ThreadIndexManager::MAX_THREADS){
+            uint next = 0;
+            for(uint& index : newIndex[t]){
+                if(index != NONE){
+                    index = next++;
+                }
+            }
+            live += next;
+        }
+
+        // 前から順に詰める．書き込み先は読み終えた位置なので，その場で移動できる
+        rep(t, util::ThreadIndexManager::MAX_THREADS){
+            Storage& storage = storages[t];
+            uint next = 0;
+            rep(i, storage.size){
+                if(newIndex[t][i] == NONE){
+                    continue;
+                }
+
+                AnswerLinearTreeNode node = at(t, i);
+                if(node.parentIndex != NONE){
+                    node.parentIndex = newIndex[node.parentThread][node.parentIndex];
+                }
+                storage.chunk(next >> CHUNK_BITS)[next & CHUNK_MASK] = node;
+                ++next;
+            }
+
+            // 使わなくなったチャンクを返す
+            const std::size_t usedChunks = (next + CHUNK_SIZE - 1) >> CHUNK_BITS;
             std::lock_guard<util::SpinMutex> lock(mutex);
-            if(nodes.size() <= thisThread){
-                nodes.resize(thisThread + 1);
+            while(storage.numChunks > usedChunks){
+                freeChunks.push_back(storage.popChunk());
             }
+            storage.size = next;
         }
 
-        const uint ret = nodes[thisThread].size();
-        nodes[thisThread].emplace_back(parentIndex, move, parentThread);
-        return ret;
+        for(Feature* root : roots){
+            if(root->index != NONE){
+                root->index = newIndex[root->thread][root->index];
+            }
+        }
+
+        // 取っておくチャンクは，次の回収までに増える分 (使っている分と同じ数) まで
+        {
+            std::lock_guard<util::SpinMutex> lock(mutex);
+            std::size_t used = 0;
+            for(const Storage& storage : storages){
+                used += storage.numChunks;
+            }
+            if(freeChunks.size() > used){
+                freeChunks.resize(used);
+            }
+        }
+
+        reclaimSize = std::max(MIN_RECLAIM_SIZE, live * 2);
     }
 };
 
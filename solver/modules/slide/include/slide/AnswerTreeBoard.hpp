@@ -15,14 +15,14 @@ public:
 
 	AnswerTreeBoardBase() = default;
 
-	explicit AnswerTreeBoardBase(const PlayBoardBase<H, W>& board) {
-		init(board);
+	explicit AnswerTreeBoardBase(const PlayBoardBase<H, W>& board, AnswerLinearTree& tree) {
+		init(board, tree);
 	}
 
-	void init(const PlayBoardBase<H, W>& board)
+	void init(const PlayBoardBase<H, W>& board, AnswerLinearTree& tree)
 	{
 		PlayBoardBase<H, W>::operator=(board);
-		AnswerTreeFeature::init();
+		AnswerTreeFeature::init(tree);
 		swappingCount = 0;
 	}
 
@@ -2,7 +2,6 @@
 #define ANSWER_TREE_FEATURE_HPP_
 
 #include <algorithm>
-#include <limits>
 
 #include "AnswerLinearTree.hpp"
 #include "util/ThreadIndexManager.hpp"
@@ -15,27 +14,29 @@ class AnswerTreeFeature
 public:
     uint index;
     uchar thread;
+    AnswerLinearTree* tree;
 
+    // init を呼ぶまでは節点を追加できない
     AnswerTreeFeature()
-    {
-        init();
-    }
+        : index(AnswerLinearTree::NONE), thread(0), tree(nullptr) {}
 
-    void init()
+    // tree は節点を追加するアリーナ (探索毎に作ったものを渡す)
+    void init(AnswerLinearTree& tree)
     {
-        index = std::numeric_limits<uint>::max();
+        index = AnswerLinearTree::NONE;
         thread = 0;
+        this->tree = &tree;
     }
 
     void move(Direction dir, uchar thisThread = util::ThreadIndexManager::getLocalId())
     {
-        index = AnswerLinearTree::add(index, Move(dir), thread, thisThread);
+        index = tree->add(index, Move(dir), thread, thisThread);
         thread = thisThread;
     }
 
     void select(Point newSelect, uchar thisThread = util::ThreadIndexManager::getLocalId())
     {
-        index = AnswerLinearTree::add(index, Move(newSelect), thread, thisThread);
+        index = tree->add(index, Move(newSelect), thread, thisThread);
         thread = thisThread;
     }
 
@@ -46,8 +47,8 @@ public:
         uint nowIndex = index;
         uchar nowThread = thread;
 
-        while(nowIndex != std::numeric_limits<uint>::max()){
-            const AnswerLinearTreeNode& p = AnswerLinearTree::nodes[nowThread][nowIndex];
+        while(nowIndex != AnswerLinearTree::NONE){
+            const AnswerLinearTreeNode& p = tree->at(nowThread, nowIndex);
             answer.push_back(p.move);
             nowIndex = p.parentIndex;
             nowThread = p.parentThread;
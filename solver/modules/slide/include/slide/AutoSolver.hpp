@@ -0,0 +1,43 @@
+#ifndef SLIDE_AUTO_SOLVER_HPP_
+#define SLIDE_AUTO_SOLVER_HPP_
+
+#include <string>
+#include <vector>
+
+#include "Solver.hpp"
+#include "SolverProfile.hpp"
+
+namespace slide
+{
+
+// SolverProfile から問題に合ったソルバとパラメータを選んで解く
+// record にすると解き終わった結果を profilePath に書き足すので，使うほど選択が良くなる．
+// 選んだものだけを記録すると他の候補が記録されないままになるので，記録するときは exploration の確率で candidates から無作為に選ぶ．
+// どちらも既定では切ってあり (create_solver("auto") は記録を読むだけ)，run_slide では --profile で有効になる．
+class AutoSolver : public Solver
+{
+public:
+    static bool verbose;
+
+    std::string profilePath = "slide_profile.txt";
+    bool record = false;
+
+    // 記録が無いときに使う
+    SolverProfile::Parameters fallback = {"dragon", 4000, 100};
+
+    // 記録するときに，この確率で記録によらず candidates から選ぶ
+    double exploration = 0.0;
+    std::vector<SolverProfile::Parameters> candidates = {{"dragon", 4000, 100}, {"kurage", 4000, 0}, {"lizard", 4000, 0}};
+
+    // 実際に使ったパラメータ (solve の後に読む)
+    SolverProfile::Parameters selected;
+
+    using Solver::Solver;
+    virtual ~AutoSolver() override = default;
+
+    void solve() override;
+};
+
+} // end of namespace slide
+
+#endif
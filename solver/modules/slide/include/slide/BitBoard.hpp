@@ -132,6 +132,13 @@ public:
         return test(Point(y, x));
     }
 
+    // 行 y の bit 列 (x bit 目が (y, x))
+    ushort row(int y) const
+    {
+        BOOST_ASSERT(0 <= y && y < height());
+        return data[y];
+    }
+
     bool testAllRow(int row) const
     {
         BOOST_ASSERT(0 <= row && row < height());
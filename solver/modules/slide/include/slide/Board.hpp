@@ -110,6 +110,11 @@ public:
         return height() * width();
     }
 
+    // 行優先に並んだ area() 個のセル
+    constexpr const uchar* data() const {
+        return cell;
+    }
+
     Point find(uchar index) const
     {
         const int pos = std::find(cell, cell + area(), index) - cell;
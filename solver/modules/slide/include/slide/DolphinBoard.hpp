@@ -3,9 +3,14 @@
 
 #include <cstdlib>
 
+#include <boost/assert.hpp>
+
+#include "AnswerTreeBoard.hpp"
 #include "FixBoard.hpp"
+#include "HashFeature.hpp"
 #include "OctopusBoard.hpp"
 #include "UrchinBoard.hpp"
+#include "ZobristTable.hpp"
 
 namespace slide
 {
@@ -14,6 +19,49 @@ extern double MeanCoefficient;
 extern double ManhattanCoefficient;
 extern double LinearCoefficient;
 
+// AnswerTreeBoard に，セルの配置と選択中のセルのハッシュ値を交換と選択の度に差分で持たせたもの
+template<int H, int W>
+class HashAnswerTreeBoardBase : public AnswerTreeBoardBase<H, W>
+{
+public:
+    HashFeature<H, W> cellHash;
+
+    HashAnswerTreeBoardBase() = default;
+
+    explicit HashAnswerTreeBoardBase(const PlayBoardBase<H, W>& board, AnswerLinearTree& tree) {
+        init(board, tree);
+    }
+
+    // ハッシュ値は initHash を呼ぶまで持たない
+    void init(const PlayBoardBase<H, W>& board, AnswerLinearTree& tree)
+    {
+        AnswerTreeBoardBase<H, W>::init(board, tree);
+        cellHash.table = nullptr;
+    }
+
+    void initHash(const ZobristTable<H, W>* table)
+    {
+        cellHash.init(*this, 0, table);
+    }
+
+    void move(Direction dir)
+    {
+        BOOST_ASSERT(cellHash.table != nullptr);
+        AnswerTreeBoardBase<H, W>::move(dir);
+        cellHash.move(*this, dir);
+    }
+
+    void select(Point newSelect)
+    {
+        BOOST_ASSERT(cellHash.table != nullptr);
+        AnswerTreeBoardBase<H, W>::select(newSelect);
+        cellHash.select(*this, 0);
+    }
+};
+
+template<int H, int W>
+using FixHashAnswerTreeBoard = FixBoard<PlayBoardUtility<HashAnswerTreeBoardBase<H, W>>>;
+
 template<typename Base>
 class DolphinBoard : public Base
 {
@@ -36,6 +84,12 @@ public:
     // from FixBoard
     using Base::fixed;
 
+    // from HashAnswerTreeBoardBase
+    using Base::cellHash;
+
+    // fixed のセルの分のハッシュ値
+    ull fixedHash = 0ull;
+
     using Base::Base;
 
     double evaluate() const
@@ -52,9 +106,32 @@ public:
         return score;
     }
 
+    // ハッシュ値を持ち始める (盤面を作ったら，動かす前に呼ぶ)
+    void initHash(const ZobristTable<H, W>* table)
+    {
+        Base::initHash(table);
+        fixedHash = 0ull;
+        rep(i, height()){
+            updateFixedHash(i, fixed.row(i));
+        }
+    }
+
+    // セルの配置，選択中のセル，fixed のセルから決まるハッシュ値 (揃える順番が違っても同じ盤面なら同じ値)
+    ull hash() const
+    {
+        return cellHash.hash ^ fixedHash;
+    }
+
     double align(Point p)
     {
+        const BitBoard<H, W> before = fixed;
         const bool ret = Base::align(p); 
+
+        // 交換と選択の分は cellHash が持っているので，fixed が変わった分だけ足す
+        rep(i, height()){
+            updateFixedHash(i, before.row(i) ^ fixed.row(i));
+        }
+
         if(!ret) return 1 << 29;
         return evaluate();
     }
@@ -137,13 +214,20 @@ public:
         return manhattan;
     }
 
+private:
+    void updateFixedHash(int y, uint bits)
+    {
+        for(; bits != 0; bits &= bits - 1){
+            fixedHash ^= cellHash.table->lookFixed(Point(y, __builtin_ctz(bits)));
+        }
+    }
 };
 
 template<int H, int W = H>
-using DolphinOctopusBoard = DolphinBoard<OctopusBoard<FixAnswerTreeBoard<H, W>>>;
+using DolphinOctopusBoard = DolphinBoard<OctopusBoard<FixHashAnswerTreeBoard<H, W>>>;
 
 template<int H, int W = H>
-using DolphinUrchinBoard = DolphinBoard<UrchinBoard<FixAnswerTreeBoard<H, W>>>;
+using DolphinUrchinBoard = DolphinBoard<UrchinBoard<FixHashAnswerTreeBoard<H, W>>>;
 
 } // end of namespace slide
 
@@ -12,6 +12,9 @@ class DragonSolver : public Solver
 public:
     static bool verbose;
 
+    int totalBeamWidth = 4000;  // kurage, whale のビーム幅
+    int kurageMaxArea = 100;    // 面積がこれ以下なら初めから kurage だけで解く
+
     using Solver::Solver;
     virtual ~DragonSolver() override = default;
         
@@ -0,0 +1,51 @@
+#ifndef SLIDE_EXACT_BOARD_HPP_
+#define SLIDE_EXACT_BOARD_HPP_
+
+#include "HashFeature.hpp"
+#include "AdmissibleBoard.hpp"
+
+namespace slide
+{
+
+// ExactSolver の盤面 (置換表を引くためにハッシュ値を持つ)
+template<int H, int W = H>
+class ExactBoardBase : public AdmissibleBoard<H, W>, public HashFeature<H, W>
+{
+public:
+    using AdmissibleBoard<H, W>::selectionLimit;
+    using HashFeature<H, W>::hash;
+
+    ExactBoardBase() = default;
+    ExactBoardBase(const PlayBoard<H, W>& board, int selectionLimit, const ZobristTable<H, W>* table) {
+        init(board, selectionLimit, table);
+    }
+
+    void init(const PlayBoard<H, W>& board, int selectionLimit, const ZobristTable<H, W>* table)
+    {
+        AdmissibleBoard<H, W>::init(board, selectionLimit);
+        HashFeature<H, W>::init(*this, selectionLimit, table);
+    }
+
+    /**************************************************************************
+     * Operations
+     *************************************************************************/
+
+    void move(Direction dir)
+    {
+        AdmissibleBoard<H, W>::move(dir);
+        HashFeature<H, W>::move(*this, dir);
+    }
+
+    void select(Point newSelect)
+    {
+        AdmissibleBoard<H, W>::select(newSelect);
+        HashFeature<H, W>::select(*this, selectionLimit);
+    }
+};
+
+template<int H, int W = H>
+using ExactBoard = PlayBoardUtility<ExactBoardBase<H, W>>;
+
+} // end of namespace slide
+
+#endif
@@ -1,8 +1,15 @@
 #ifndef SLIDE_EXACT_SOLVER_HPP_
 #define SLIDE_EXACT_SOLVER_HPP_
 
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+#include "util/TranspositionTable.hpp"
+
 #include "Solver.hpp"
-#include "AdmissibleBoard.hpp"
+#include "ExactBoard.hpp"
 #include "Problem.hpp"
 
 namespace slide
@@ -11,19 +18,79 @@ namespace slide
 class ExactSolver : public Solver
 {
 private:
+    // 締め切りを確認する間隔 (訪問節点数)
+    static constexpr ull TIME_CHECK_INTERVAL = 1 << 16;
+
+    // 1 スレッドが 1 秒に訪問する節点数 × 盤面の面積 (選択の子の数が面積に比例するので，面積で割って使う)
+    static constexpr double NODE_RATE = 1 << 24;
+
+    // 締め切りが近くても，置換表はこれだけは確保する
+    static constexpr std::size_t MIN_TABLE_BYTES = std::size_t(1) << 20;
+
+    // 逐次に辿る部分木毎の状態
+    struct Worker
+    {
+        ull visitedNode = 0;
+        ull tableHits = 0;      // 置換表に値があった節点数
+        ull tableCutoffs = 0;   // そのうち置換表の下界で枝刈りした節点数
+        Answer answer;      // 見つけた解答の，部分木の根から下の部分 (逆順)
+    };
+
     Answer answer;
-    ull visitedNode;
+    std::atomic<ull> visitedNode;
+    std::atomic<ull> tableHits;
+    std::atomic<ull> tableCutoffs;
+    std::atomic<bool> found;
+    std::atomic<bool> timeUp;
+    std::mutex answerMutex;
+
+    // 盤面から残りのコストの下界を引く (DFS の中だけで使う)
+    std::unique_ptr<util::TranspositionTable> table;
 
     template<int H, int W>
-    void IDAstar(const PlayBoard<H, W>& board);
+    bool IDAstar(const PlayBoard<H, W>& board);
 
+    // depth < splitDepth の間は子をタスクとして並列に辿り，それより下は DFS で逐次に辿る
+    // prefix は根から board までの操作
     template<int H, int W>
-    int startDFS(const AdmissibleBoard<H, W>& board, int lb);
+    int parallelDFS(const ExactBoard<H, W>& board, int lb, Move preMove, int depth, const Answer& prefix);
 
     template<int H, int W>
-    int DFS(AdmissibleBoard<H, W>& board, int lb, Move preMove);
+    int DFS(ExactBoard<H, W>& board, int lb, Move preMove, Worker& worker);
+
+    // 締め切りを過ぎていれば全てのタスクを止める
+    void checkTime()
+    {
+        if(isTimeUp()){
+            timeUp.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // 他のタスクが解答を見つけたか，締め切りを過ぎた
+    bool isStopped() const
+    {
+        return found.load(std::memory_order_relaxed) || timeUp.load(std::memory_order_relaxed);
+    }
+
+    // 締め切りまでに訪問できる節点数の分の置換表の大きさ [byte] (tableBytes を超えない)
+    std::size_t tableBytesFor(int area) const;
+
+    // 直前の操作によって次にできる操作が変わるので，置換表のキーには直前の操作も混ぜる
+    static ull tableKey(ull hash, Move preMove);
+
+    void addStatistics(const Worker& worker);
+
+    // 最初に見つけたタスクの解答だけを残す
+    void setAnswer(const Answer& prefix, const Answer& reversedSuffix);
 
 public:
+    // 並列に辿る深さ
+    int splitDepth = 3;
+
+    // 置換表の大きさの上限 [byte] (0 なら置換表を使わない)
+    // 締め切りがあれば，小さな盤面や短い締め切りで毎回この大きさを確保して 0 で埋めないように tableBytesFor で小さくする
+    std::size_t tableBytes = std::size_t(1) << 30;
+
     using Solver::Solver;
     virtual ~ExactSolver() override = default;
 
@@ -0,0 +1,140 @@
+#ifndef SLIDE_EXTERNAL_ASTAR_HPP_
+#define SLIDE_EXTERNAL_ASTAR_HPP_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "util/RunFile.hpp"
+
+#include "HitodeBoard.hpp"
+#include "Solver.hpp"
+
+namespace slide
+{
+
+// HitodeSolver の双方向 A* を，ディスクを使って限られたメモリで行う (外部記憶の A*)
+//
+// 各方向の未処理の節点は下界毎のファイル (層) に書き足し，下界の小さい層から順に 1 層ずつ処理する．
+// 層はメモリに収まる大きさずつハッシュ値で並べて Run に書き出し (外部整列)，それらを併合しながら，
+// 探索済みの状態のファイル (ハッシュ値の昇順の Run) と 1 度ずつ突き合わせて重複を除く (遅延重複検出)．
+// 残った節点は層毎に新しい Run として書き出し，相手側の Run と突き合わせて出会ったかを調べてから展開する．
+// Run が増えすぎたら 1 つにまとめる．解答は Run に残した親のハッシュ値を辿って作る．
+template<int H, int W>
+class ExternalAstar
+{
+public:
+    // これを超えたら Run をまとめる
+    static constexpr std::size_t MAX_RUNS = 8;
+
+    // 層を併合しながら締め切りを確認する間隔 (状態数)
+    static constexpr std::size_t TIME_CHECK_INTERVAL = 1 << 12;
+
+private:
+    // 探索済みの状態 (Run のペイロード)
+    struct Closed
+    {
+        ull parent;
+        Move preMove;
+        uchar selectionLimit;
+    };
+
+    // 未処理の節点 (層のファイルのレコード，後ろに盤面が続く)
+    struct Header
+    {
+        ull hash;
+        ull parent;
+        int cost;
+        Move preMove;
+        uchar selectionLimit;
+        uchar selected;     // 選択していなければ 0xff
+    };
+
+    // 探索済みの状態の Run を，ハッシュ値の昇順に 1 度だけ読み進める
+    class ClosedCursor
+    {
+    private:
+        util::RunReader reader;
+        ull key;
+        Closed closed;
+        bool has;
+
+    public:
+        explicit ClosedCursor(const util::Run& run) : reader(run)
+        {
+            has = reader.next(key, &closed);
+        }
+
+        // hash 未満を読み飛ばし，hash があればその状態を返す (hash は前に呼んだときより大きくすること)
+        const Closed* seek(ull hash)
+        {
+            while(has && key < hash){
+                has = reader.next(key, &closed);
+            }
+            return has && key == hash ? &closed : nullptr;
+        }
+    };
+
+    struct Side
+    {
+        int id;
+        const ZobristTable<H, W>* table;
+        std::map<int, std::unique_ptr<util::SpillFile>> open;   // 下界 -> 層
+        std::vector<std::unique_ptr<util::Run>> closed;
+    };
+
+    const Solver& solver;
+    const int maxSelectionLimit;
+    const std::size_t memoryBudget;
+    const std::string directory;
+
+    int height;
+    int width;
+    std::size_t recordSize;
+    std::size_t fileCount;
+    Side sides[2];
+
+    std::string newPath(const Side& side, const char* kind);
+
+    void encode(const HitodeBoard<H, W>& board, char* record) const;
+    HitodeBoard<H, W> decode(const Side& side, const char* record) const;
+
+    void push(Side& side, const HitodeBoard<H, W>& board);
+
+    // 層 f の節点を全て処理する．出会ったらそのハッシュ値を返す
+    ull expandLayer(Side& side, int f);
+
+    // 層の一部をハッシュ値の昇順 (同じ状態は 1 つ) の Run にする
+    std::unique_ptr<util::Run> sortChunk(const Side& side, const char* records, std::size_t count);
+
+    // 層を並べた Run を併合し，重複を除いた状態を展開する．出会ったらそのハッシュ値を返す
+    ull mergeLayer(Side& side, const std::vector<std::unique_ptr<util::Run>>& runs);
+
+    void expand(Side& side, const HitodeBoard<H, W>& board);
+
+    void compact(Side& side);
+
+    // hash の状態の中で，選択回数を最も残しているもの
+    boost::optional<Closed> findClosed(const Side& side, ull hash) const;
+    Answer buildAnswer(const Side& side, ull hash) const;
+
+public:
+    ExternalAstar(const Solver& solver, int maxSelectionLimit, std::size_t memoryBudget, std::string directory);
+
+    // 出会った盤面までの，それぞれの始点からの操作列 (締め切りまでに出会わなければ none)
+    boost::optional<std::pair<Answer, Answer>> search(const HitodeBoard<H, W>& start1, const HitodeBoard<H, W>& start2);
+
+    // 探索済みの状態の数
+    ull visitedNode() const;
+};
+
+} // end of namespace slide
+
+#include "details/ExternalAstar.hpp"
+
+#endif
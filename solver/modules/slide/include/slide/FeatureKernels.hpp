@@ -0,0 +1,55 @@
+#ifndef SLIDE_FEATURE_KERNELS_HPP_
+#define SLIDE_FEATURE_KERNELS_HPP_
+
+#include "PlayBoard.hpp"
+#include "util/define.hpp"
+
+namespace slide
+{
+
+// 盤面全体から特徴量を作り直すときの値 (選択中のセルは含めない．転倒数だけは全てのセルで数える)
+//
+// セル (id = 正しい行 * 16 + 正しい列) と，位置毎の正しい id の表を AVX2 / SSE4 で 32 / 16 セルずつ比べ，
+// マンハッタン距離とその二乗，揃っていないセルの位置の和を 1 度の走査で求める．
+// Linear Conflict と転倒数は，その走査で作った「正しい行 (列) にいるセル」のビット列を辿り，
+// 既に見た値の集合をビット列で持って popcount で数える．
+struct FeatureSums
+{
+    enum Kind : uint
+    {
+        BASIC = 0,                  // マンハッタン距離，その二乗，Variance (常に求める)
+        LINEAR_CONFLICT = 1 << 0,
+        PARITY = 1 << 1,
+        ALL = LINEAR_CONFLICT | PARITY,
+    };
+
+    int manhattan;
+    int squaredManhattan;
+    int linearConflict;
+
+    // 揃っていないセルの位置の二乗和，行の和，列の和，個数 (VarianceFeature)
+    int squaredSum;
+    int sumY;
+    int sumX;
+    int count;
+
+    // 行優先に並べたときの転倒数の偶奇
+    bool parity;
+};
+
+// cell は行優先に並んだ height * width 個のセル，selected は選択中のセルの添字 (選択していなければ -1)
+FeatureSums computeFeatureSums(const uchar* cell, int height, int width, int selected, uint kinds = FeatureSums::ALL);
+
+template<int H, int W>
+FeatureSums computeFeatureSums(const PlayBoardBase<H, W>& board, uint kinds = FeatureSums::ALL)
+{
+    const int selected = board.isSelected() ? board.selected.toInt(board.width()) : -1;
+    return computeFeatureSums(board.data(), board.height(), board.width(), selected, kinds);
+}
+
+// 使っている命令セットの名前 ("AVX2", "SSE4.1", "scalar")
+const char* featureKernelName();
+
+} // end of namespace slide
+
+#endif
@@ -2,6 +2,7 @@
 #define SLIDE_FIX_BOARD_HPP_
 
 #include <iostream>
+#include <utility>
 
 #include "AnswerBoard.hpp"
 #include "AnswerTreeBoard.hpp"
@@ -39,13 +40,16 @@ public:
 
     FixBoard() = default;
 
-    explicit FixBoard(const PlayBoardBase<H, W>& board) {
-        init(board);
+    // args は Base::init にそのまま渡す (AnswerTreeBoard なら解答木のアリーナ)
+    template<typename... Args>
+    explicit FixBoard(const PlayBoardBase<H, W>& board, Args&&... args) {
+        init(board, std::forward<Args>(args)...);
     }
 
-    void init(const PlayBoardBase<H, W>& board)
+    template<typename... Args>
+    void init(const PlayBoardBase<H, W>& board, Args&&... args)
     {
-        Base::init(board);
+        Base::init(board, std::forward<Args>(args)...);
         fixed.init(board.height(), board.width());
     }
 
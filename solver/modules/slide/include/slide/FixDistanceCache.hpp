@@ -0,0 +1,111 @@
+#ifndef SLIDE_FIX_DISTANCE_CACHE_HPP_
+#define SLIDE_FIX_DISTANCE_CACHE_HPP_
+
+#include <memory>
+
+#include <boost/assert.hpp>
+
+#include "BitBoard.hpp"
+#include "Point.hpp"
+#include "Wavefront.hpp"
+#include "util/define.hpp"
+
+namespace slide
+{
+
+// fixed の盤面毎の，選択セルの移動回数の表
+//
+// FixBoard::trajectPiece の A* は展開の度に countMoveTo で BFS をするので，同じ fixed の盤面，同じ始点の BFS を何度も繰り返す．
+// そこで (fixed の盤面, 始点) 毎に，始点から全てのセルまでの移動回数を 1 回の BFS で求めて覚えておく．
+// BFS は BitBoard の行単位で波面を広げる Wavefront を使う．
+// 表はスレッド毎の直接写像のキャッシュで，fixed の盤面そのものを鍵に持つ．
+// セルを fix / unfix すると鍵が変わるので古い表を引くことはなく，元に戻せば同じ表をまた引ける．
+template<int H, int W>
+class FixDistanceCache
+{
+public:
+    static constexpr int arrayH = arraySize(H);
+    static constexpr int arrayW = arraySize(W);
+    static constexpr uchar UNREACHABLE = Wavefront<H, W>::UNREACHABLE;
+
+private:
+    static constexpr int LOG_SLOTS = 10;
+    static constexpr int SLOTS = 1 << LOG_SLOTS;
+
+    struct Entry
+    {
+        ushort rows[arrayH];            // 鍵: fixed の盤面
+        uchar h, w;                     // 鍵: 盤面の大きさ (0 なら空．src はどの値も有効な位置なので空の印にできない)
+        uchar src;                      // 鍵: 始点
+        uchar dist[arrayH][arrayW];     // 始点からの移動回数 (UNREACHABLE なら届かない)
+    };
+
+    std::unique_ptr<Entry[]> entries;
+
+    // 空の項は大きさで弾くので，rows, src, dist は読まれる前に必ず書かれる
+    FixDistanceCache() : entries(new Entry[SLOTS])
+    {
+        rep(i, SLOTS){
+            entries[i].h = 0;
+            entries[i].w = 0;
+        }
+    }
+
+    static FixDistanceCache& local()
+    {
+        static thread_local FixDistanceCache cache;
+        return cache;
+    }
+
+    static uint slotOf(const BitBoard<H, W>& fixed, Point src)
+    {
+        ull key = src.toInt() | fixed.height() << 8 | fixed.width() << 16;
+        rep(i, fixed.height()){
+            key = (key ^ fixed.row(i)) * 0x9e3779b97f4a7c15ull;
+        }
+        return key >> (64 - LOG_SLOTS);
+    }
+
+    static bool matches(const Entry& entry, const BitBoard<H, W>& fixed, Point src)
+    {
+        if(entry.h != fixed.height() || entry.w != fixed.width() || entry.src != src.toInt()){
+            return false;
+        }
+        rep(i, fixed.height()){
+            if(entry.rows[i] != fixed.row(i)){
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    // fixed の盤面で選択セルを src から dst まで動かすのにかかる最小の移動回数 (動かせなければ -1)
+    static int count(const BitBoard<H, W>& fixed, Point src, Point dst)
+    {
+        BOOST_ASSERT(src.isIn(fixed.height(), fixed.width()));
+        BOOST_ASSERT(dst.isIn(fixed.height(), fixed.width()));
+        BOOST_ASSERT(!fixed(src));
+
+        Entry& entry = local().entries[slotOf(fixed, src)];
+        if(!matches(entry, fixed, src)){
+            rep(i, fixed.height()){
+                entry.rows[i] = fixed.row(i);
+            }
+            entry.h = fixed.height();
+            entry.w = fixed.width();
+            entry.src = src.toInt();
+
+            Wavefront<H, W> wave;
+            wave.searchAll(fixed, src);
+            wave.distances(entry.dist);
+        }
+
+        const uchar d = entry.dist[dst.y][dst.x];
+        return d == UNREACHABLE ? -1 : d;
+    }
+};
+
+} // end of namespace slide
+
+#endif
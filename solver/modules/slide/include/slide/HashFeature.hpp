@@ -47,10 +47,8 @@ public:
     {
         const Point src1 = board.selected - Point::delta(dir);
         const Point src2 = board.selected;
-        const uchar id1  = board(src2);
-        const uchar id2  = board(src1);
 
-        hash ^= table->look(id1, src1) ^ table->look(id1, src2) ^ table->look(id2, src1) ^ table->look(id2, src2);
+        hash ^= table->swapDelta(board(src2), board(src1), src1, src2);
     }
 
     void select(const PlayBoardBase<H, W>& board, int selectionLimit)
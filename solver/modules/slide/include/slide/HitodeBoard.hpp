@@ -1,11 +1,14 @@
 #ifndef SLIDE_HITODE_BOARD_HPP_
 #define SLIDE_HITODE_BOARD_HPP_
 
+#include <type_traits>
+
 #include <boost/optional.hpp>
 
 #include "AnswerTreeFeature.hpp"
 #include "HashFeature.hpp"
 #include "AdmissibleBoard.hpp"
+#include "PackedBoard.hpp"
 
 namespace slide
 {
@@ -61,6 +64,55 @@ public:
 template<int H, int W = H>
 using HitodeBoard = PlayBoardUtility<HitodeBoardBase<H, W>>;
 
+// 待ち行列に入れておくための，盤面を詰めた HitodeBoard (特徴量は取り出すときに作り直す)
+template<int H, int W>
+class PackedHitodeBoard
+{
+private:
+    PackedBoard<H, W> board;
+
+public:
+    ull hash;
+    ull parentHash;
+    int cost;
+    int lowerBound;
+    uchar selectionLimit;
+    Move preMove;
+
+    PackedHitodeBoard() = default;
+
+    explicit PackedHitodeBoard(const HitodeBoard<H, W>& board)
+        : board(board), hash(board.hash), parentHash(board.parentHash), cost(board.cost), lowerBound(board.lowerBound),
+          selectionLimit(board.selectionLimit), preMove(board.preMove) {}
+
+    HitodeBoard<H, W> unpack(const ZobristTable<H, W>* table) const
+    {
+        HitodeBoard<H, W> ret(board.unpack(), selectionLimit, table);
+        ret.cost = cost;
+        ret.lowerBound = lowerBound;
+        ret.parentHash = parentHash;
+        ret.preMove = preMove;
+        BOOST_ASSERT(ret.hash == hash);
+        return ret;
+    }
+};
+
+// 探索の待ち行列の要素 (詰められない大きさでは HitodeBoard そのもの)
+template<int H, int W>
+using HitodeNode = typename std::conditional<isPackable(H, W), PackedHitodeBoard<H, W>, HitodeBoard<H, W>>::type;
+
+template<int H, int W>
+HitodeBoard<H, W> unpackNode(const PackedHitodeBoard<H, W>& node, const ZobristTable<H, W>* table)
+{
+    return node.unpack(table);
+}
+
+template<int H, int W>
+HitodeBoard<H, W> unpackNode(HitodeBoard<H, W> board, const ZobristTable<H, W>*)
+{
+    return board;
+}
+
 } // end of namespace slide
 
 #endif
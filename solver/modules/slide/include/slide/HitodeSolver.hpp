@@ -1,8 +1,13 @@
 #ifndef SLIDE_HITODE_SOLVER_HPP_
 #define SLIDE_HITODE_SOLVER_HPP_
 
+#include <cstddef>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include <boost/optional.hpp>
+
 #include "branch.hpp"
 #include "HitodeBoard.hpp"
 #include "Problem.hpp"
@@ -16,13 +21,27 @@ class HitodeSolver : public Solver
 private:
     ull visitedNode;
 
+    // 締め切りまでに出会わなければ none
+    template<int H, int W>
+    boost::optional<Answer> bidirectionalAstar(const PlayBoard<H, W>& board);
+
+    // 出会った盤面までの，元の盤面側と逆盤面側それぞれの操作列
     template<int H, int W>
-    Answer bidirectionalAstar(const PlayBoard<H, W>& board);
+    boost::optional<std::pair<Answer, Answer>> parallelAstar(const HitodeBoard<H, W>& start1, const HitodeBoard<H, W>& start2);
+
+    template<int H, int W>
+    boost::optional<std::pair<Answer, Answer>> externalAstar(const HitodeBoard<H, W>& start1, const HitodeBoard<H, W>& start2);
 
     template<int H, int W>
     Board<H, W> inverseBoard(const Board<H, W>& board, std::vector<uchar>& table, std::vector<uchar>& invTable);
 
 public:
+    // 0 でなければ，探索した状態と未処理の節点をディスクに書き出し，メモリをおよそこの大きさ [byte] に抑える
+    std::size_t memoryBudget = 0;
+
+    // memoryBudget を使うときにファイルを書き出すディレクトリ
+    std::string spillDirectory = "hitode_spill";
+
     using Solver::Solver;
     virtual ~HitodeSolver() override = default;
     
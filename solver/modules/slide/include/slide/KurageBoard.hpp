@@ -44,21 +44,22 @@ public:
     using PlayBoardBase<H, W>::arrayW;
 
     KurageBoard() = default;
-    KurageBoard(const PlayBoard<H, W>& board, int selectionLimit) {
-        init(board, selectionLimit);
+    KurageBoard(const PlayBoard<H, W>& board, int selectionLimit, AnswerLinearTree& tree, const ZobristTable<H, W>* table) {
+        init(board, selectionLimit, tree, table);
     }
 
-    void init(const PlayBoard<H, W>& board, int selectionLimit)
+    void init(const PlayBoard<H, W>& board, int selectionLimit, AnswerLinearTree& tree, const ZobristTable<H, W>* table)
     {
         PlayBoardBase<H, W>::operator=(board);
-        ManhattanFeature::init(*this);
-        linearConflict.init(*this);
-        parity.init(*this);
-        AnswerTreeFeature::init();
-        variance.init(*this);
-        squaredManhattan.init(*this);
+        const FeatureSums sums = computeFeatureSums(*this);
+        ManhattanFeature::init(*this, sums);
+        linearConflict.init(*this, sums);
+        parity.init(*this, sums);
+        AnswerTreeFeature::init(tree);
+        variance.init(*this, sums);
+        squaredManhattan.init(*this, sums);
         weightedManhattan.init(*this);
-        hash.init(*this);
+        hash.init(*this, table);
         firstManhattan = manhattan;
         score = evaluate(selectionLimit);
         preMove = Move(Direction::Up);
@@ -80,6 +81,115 @@ public:
 
     // more less, more better
     float evaluate(int selectionLimit, int thread = util::ThreadIndexManager::getLocalId()) const
+    {
+        return evaluate(*this, linearConflict, variance, squaredManhattan, weightedManhattan, selectionLimit, thread);
+    }
+
+    bool isPrunnable(int selectionLimit) const {
+        return selectionLimit == 0 && parity();
+    }
+
+    /**************************************************************************
+     * Operations
+     *************************************************************************/
+
+    void move(Direction dir, int selectionLimit, int thread = util::ThreadIndexManager::getLocalId())
+    {
+        moveFeatures(dir);
+        AnswerTreeFeature::move(dir, thread);
+
+        score = evaluate(selectionLimit, thread);
+        preMove = Move(dir);
+    }
+
+    void select(Point newSelect, int selectionLimit, int thread = util::ThreadIndexManager::getLocalId())
+    {
+        selectFeatures(newSelect);
+        AnswerTreeFeature::select(newSelect, thread);
+
+        score = evaluate(selectionLimit, thread);
+        preMove = Move(newSelect);
+    }
+
+    // 評価済みの子を実体化する (評価値は計算し直さない)
+    void apply(Move move, float childScore, int thread = util::ThreadIndexManager::getLocalId())
+    {
+        if(move.isSelection){
+            selectFeatures(move.getSelected());
+            AnswerTreeFeature::select(move.getSelected(), thread);
+        }
+        else{
+            moveFeatures(move.getDirection());
+            AnswerTreeFeature::move(move.getDirection(), thread);
+        }
+
+        score = childScore;
+        preMove = move;
+    }
+
+    /**************************************************************************
+     * Lookahead
+     *************************************************************************/
+
+    // 実体化していない子の情報
+    struct Child
+    {
+        float score;
+        ull hash;
+        ushort manhattan;
+        bool parity;
+
+        constexpr bool isFinished() const {
+            return manhattan == 0;
+        }
+
+        constexpr bool isPrunnable(int selectionLimit) const {
+            return selectionLimit == 0 && parity;
+        }
+    };
+
+    // 解答木に節点を追加せず，盤面もコピーせずに子を評価する
+    Child peekMove(Direction dir, int selectionLimit, int thread = util::ThreadIndexManager::getLocalId()) const
+    {
+        const ManhattanFeature nextManhattan = ManhattanFeature::peekMove(*this, dir);
+        const LinearConflictFeature<H, W> nextLinearConflict = linearConflict.peekMove(*this, dir);
+        const VarianceFeature<H, W> nextVariance = variance.peekMove(*this, dir);
+        const SquaredManhattanFeature<H, W> nextSquaredManhattan = squaredManhattan.peekMove(*this, dir);
+        const WeightedManhattanFeature<H, W> nextWeightedManhattan = weightedManhattan.peekMove(*this, dir);
+
+        return {
+            evaluate(nextManhattan, nextLinearConflict, nextVariance, nextSquaredManhattan, nextWeightedManhattan, selectionLimit, thread),
+            hash.peekMove(*this, dir)(),
+            nextManhattan.manhattan,
+            parity.peekMove()()
+        };
+    }
+
+    Child peekSelect(Point newSelect, int selectionLimit, int thread = util::ThreadIndexManager::getLocalId()) const
+    {
+        const ManhattanFeature nextManhattan = ManhattanFeature::peekSelect(*this, newSelect);
+        const LinearConflictFeature<H, W> nextLinearConflict = linearConflict.peekSelect(*this, newSelect);
+        const VarianceFeature<H, W> nextVariance = variance.peekSelect(*this, newSelect);
+        const SquaredManhattanFeature<H, W> nextSquaredManhattan = squaredManhattan.peekSelect(*this, newSelect);
+        const WeightedManhattanFeature<H, W> nextWeightedManhattan = weightedManhattan.peekSelect(*this, newSelect);
+
+        return {
+            evaluate(nextManhattan, nextLinearConflict, nextVariance, nextSquaredManhattan, nextWeightedManhattan, selectionLimit, thread),
+            hash.peekSelect(*this, newSelect)(),
+            nextManhattan.manhattan,
+            parity.peekSelect(nextManhattan.selManhattan)()
+        };
+    }
+
+private:
+    // 盤面を作らずに子を評価できるよう，特徴量を引数に取る
+    float evaluate(
+        const ManhattanFeature& manhattanFeature,
+        const LinearConflictFeature<H, W>& linearConflictFeature,
+        const VarianceFeature<H, W>& varianceFeature,
+        const SquaredManhattanFeature<H, W>& squaredManhattanFeature,
+        const WeightedManhattanFeature<H, W>& weightedManhattanFeature,
+        int selectionLimit, int thread) const
     {
         /*
         float score = 0.0f;
@@ -91,30 +201,24 @@ public:
         return score;
         */
 
+        const int manhattan = manhattanFeature.manhattan;
+
         float s = 0.0f;
         s += 15 * manhattan;
-        s += 15 * std::max(2.0f, 4.0f-selectionLimit/2.0f)*linearConflict();
-        s += selManhattan;
+        s += 15 * std::max(2.0f, 4.0f-selectionLimit/2.0f)*linearConflictFeature();
+        s += manhattanFeature.selManhattan;
         s += 60 * manhattan / (firstManhattan + 1) * util::Random::nextReal(thread);
-        s += 30 * variance();
-        s += 150 * squaredManhattan();
+        s += 30 * varianceFeature();
+        s += 150 * squaredManhattanFeature();
 
-        if(H*2 <= W || W*2 <= H){
-            s += 50 * weightedManhattan();
+        if(this->height()*2 <= this->width() || this->width()*2 <= this->height()){
+            s += 50 * weightedManhattanFeature();
         }
 
         return s;
     }
 
-    bool isPrunnable(int selectionLimit) const {
-        return selectionLimit == 0 && parity();
-    }
-
-    /**************************************************************************
-     * Operations
-     *************************************************************************/
-
-    void move(Direction dir, int selectionLimit, int thread = util::ThreadIndexManager::getLocalId())
+    void moveFeatures(Direction dir)
     {
         PlayBoardBase<H, W>::move(dir);
         ManhattanFeature::move(*this, dir);
@@ -123,14 +227,10 @@ public:
         squaredManhattan.move(*this, dir);
         weightedManhattan.move(*this, dir);
         parity.move();
-        AnswerTreeFeature::move(dir, thread);
         hash.move(*this, dir);
-
-        score = evaluate(selectionLimit, thread);
-        preMove = Move(dir);
     }
 
-    void select(Point newSelect, int selectionLimit, int thread = util::ThreadIndexManager::getLocalId())
+    void selectFeatures(Point newSelect)
     {
         const Point preSelect = selected;
         PlayBoardBase<H, W>::select(newSelect);
@@ -140,11 +240,7 @@ public:
         squaredManhattan.select(*this, preSelect);
         weightedManhattan.select(*this, preSelect);
         parity.select(selManhattan);
-        AnswerTreeFeature::select(newSelect, thread);
         hash.select(*this);
-
-        score = evaluate(selectionLimit, thread);
-        preMove = Move(newSelect);
     }
 };
 
@@ -0,0 +1,77 @@
+#ifndef SLIDE_KURAGE_CANDIDATES_HPP_
+#define SLIDE_KURAGE_CANDIDATES_HPP_
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+#include "Answer.hpp"
+#include "util/define.hpp"
+
+namespace slide
+{
+
+// ビームサーチで生成された，まだ実体化していない子の列
+// 親の盤面と操作だけを覚えておき，生き残ったものだけを後で実体化する
+class KurageCandidates
+{
+public:
+    static constexpr int LAYER_BITS = 5;
+    static constexpr int MAX_LAYER  = 1 << LAYER_BITS;
+
+    std::vector<float> score;
+    std::vector<uint>  parent;   // (親の添字 << LAYER_BITS) | 親のレイヤ
+    std::vector<Move>  move;
+
+    static uint packParent(uint index, int layer)
+    {
+        BOOST_ASSERT(0 <= layer && layer < MAX_LAYER);
+        return (index << LAYER_BITS) | uint(layer);
+    }
+
+    static int parentLayer(uint packed)
+    {
+        return packed & (MAX_LAYER - 1);
+    }
+
+    static uint parentIndex(uint packed)
+    {
+        return packed >> LAYER_BITS;
+    }
+
+    std::size_t size() const
+    {
+        return score.size();
+    }
+
+    bool empty() const
+    {
+        return score.empty();
+    }
+
+    void reserve(std::size_t n)
+    {
+        score.reserve(n);
+        parent.reserve(n);
+        move.reserve(n);
+    }
+
+    void clear()
+    {
+        score.clear();
+        parent.clear();
+        move.clear();
+    }
+
+    void push_back(float childScore, uint packedParent, Move childMove)
+    {
+        score.push_back(childScore);
+        parent.push_back(packedParent);
+        move.push_back(childMove);
+    }
+};
+
+} // end of namespace slide
+
+#endif
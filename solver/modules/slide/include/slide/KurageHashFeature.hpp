@@ -1,8 +1,6 @@
 #ifndef SLIDE_KURAGE_HASH_FEATURE_HPP_
 #define SLIDE_KURAGE_HASH_FEATURE_HPP_
 
-#include <memory>
-
 #include "PlayBoard.hpp"
 #include "ZobristTable.hpp"
 
@@ -16,17 +14,19 @@ private:
     ull selHash;
     ull hash;
 
-public:
-    static std::unique_ptr<const ZobristTable<H, W>> table;
+    // 探索毎に作ったテーブル (同時に動く探索同士で共有しない)
+    const ZobristTable<H, W>* table;
 
+public:
     KurageHashFeature() = default;
 
-    KurageHashFeature(const PlayBoardBase<H, W>& board) {
-        init(board);
+    KurageHashFeature(const PlayBoardBase<H, W>& board, const ZobristTable<H, W>* table) {
+        init(board, table);
     }
 
-    void init(const PlayBoardBase<H, W>& board)
+    void init(const PlayBoardBase<H, W>& board, const ZobristTable<H, W>* table)
     {
+        this->table = table;
         hash = 0ull;
 
         rep(i, board.height()) rep(j, board.width()) {
@@ -49,25 +49,50 @@ public:
 
     void move(const PlayBoardBase<H, W>& board, Direction dir)
     {
+        // board は交換後の盤面
         const Point src1 = board.selected - Point::delta(dir);
         const Point src2 = board.selected;
-        const uchar id1  = board(src2);
-        const uchar id2  = board(src1);
+        update(src1, src2, board(src2), board(src1));
+    }
 
-        hash ^= table->look(id1, src1) ^ table->look(id1, src2) ^ table->look(id2, src1) ^ table->look(id2, src2);
+    // 交換前の盤面 board から，交換後の特徴量を求める
+    KurageHashFeature peekMove(const PlayBoardBase<H, W>& board, Direction dir) const
+    {
+        const Point src1 = board.selected;
+        const Point src2 = board.selected + Point::delta(dir);
+        KurageHashFeature next = *this;
+        next.update(src1, src2, board(src1), board(src2));
+        return next;
     }
 
     void select(const PlayBoardBase<H, W>& board)
+    {
+        updateSelection(board(board.selected));
+    }
+
+    // 選択前の盤面 board から，newSelect を選択した後の特徴量を求める
+    KurageHashFeature peekSelect(const PlayBoardBase<H, W>& board, Point newSelect) const
+    {
+        KurageHashFeature next = *this;
+        next.updateSelection(board(newSelect));
+        return next;
+    }
+
+private:
+    // 位置 src1, src2 にある id1, id2 のセルを交換する (交換の前後どちらから見ても同じ値になる)
+    void update(Point src1, Point src2, uchar id1, uchar id2)
+    {
+        hash ^= table->swapDelta(id1, id2, src1, src2);
+    }
+
+    void updateSelection(uchar selId)
     {
         hash ^= selHash;
-        selHash = table->lookSelected(board(board.selected));
+        selHash = table->lookSelected(selId);
         hash ^= selHash;
     }
 };
 
-template<int H, int W>
-std::unique_ptr<const ZobristTable<H, W>> KurageHashFeature<H, W>::table = nullptr;
-
 } // end of namespace slide
 
 #endif
@@ -1,6 +1,7 @@
 #ifndef SLIDE_KURAGE_SOLVER_HPP_
 #define SLIDE_KURAGE_SOLVER_HPP_
 
+#include <cstddef>
 #include <utility>
 #include <vector>
 
@@ -35,6 +36,8 @@ private:
 public:
     static bool verbose;
     int totalBeamWidth = 4000;
+    std::size_t visitedCapacity = 1 << 23;
+    int reclaimInterval = 32;   // 解答木を詰め直す間隔 (ステップ数)．0 なら節点数が倍になる毎
     bool retry = true;
 
     using Solver::Solver;
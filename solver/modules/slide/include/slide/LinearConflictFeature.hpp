@@ -1,6 +1,7 @@
 #ifndef SLIDE_LINEAR_CONFLICT_FEATURE_HPP_
 #define SLIDE_LINEAR_CONFLICT_FEATURE_HPP_
 
+#include "FeatureKernels.hpp"
 #include "PlayBoard.hpp"
 #include "util/define.hpp"
 
@@ -29,6 +30,11 @@ public:
         linearConflict = compute(board);
     }
 
+    void init(const PlayBoardBase<H, W>&, const FeatureSums& sums)
+    {
+        linearConflict = sums.linearConflict;
+    }
+
     int operator()() const
     {
         return linearConflict;
@@ -36,65 +42,57 @@ public:
 
     void move(const PlayBoardBase<H, W>& board, Direction dir)
     {
-             if(dir == Direction::Up)    moveUp(board);
-        else if(dir == Direction::Right) moveRight(board);
-        else if(dir == Direction::Down)  moveDown(board);
-        else                             moveLeft(board);
+        // board は交換後の盤面
+        const Point p = board.selected - Point::delta(dir);
+        update(board, dir, board.selected, p, Point(board(p)));
     }
 
-    void moveUp(const PlayBoardBase<H, W>& board)
+    // 交換前の盤面 board から，交換後の特徴量を求める
+    // 交換で動く 2 セルは数え上げの対象から外れるので，交換前の盤面のままで計算できる
+    LinearConflictFeature peekMove(const PlayBoardBase<H, W>& board, Direction dir) const
     {
-        const Point p = board.selected + Point::delta(Direction::Down);
-        const Point dst(board(p));
-
-        if(dst.y == board.selected.y){
-            linearConflict -= computeHorizotally(board, board.selected, dst);
-        }
-        else if(dst.y == p.y){
-            linearConflict += computeHorizotally(board, p, dst);
-        }
+        const Point next = board.selected + Point::delta(dir);
+        LinearConflictFeature ret = *this;
+        ret.update(board, dir, next, board.selected, Point(board(next)));
+        return ret;
     }
 
-    void moveRight(const PlayBoardBase<H, W>& board)
+    void select(const PlayBoardBase<H, W>& board, Point preSelect)
     {
-        const Point p = board.selected + Point::delta(Direction::Left);
-        const Point dst(board(p));
-
-        if(dst.x == board.selected.x){
-            linearConflict -= computeVertically(board, board.selected, dst);
-        }
-        else if(dst.x == p.x){
-            linearConflict += computeVertically(board, p, dst);
-        }
+        updateSelection(board, preSelect, board.selected);
     }
 
-    void moveDown(const PlayBoardBase<H, W>& board)
+    // 選択前の盤面 board から，newSelect を選択した後の特徴量を求める
+    LinearConflictFeature peekSelect(const PlayBoardBase<H, W>& board, Point newSelect) const
     {
-        const Point p = board.selected + Point::delta(Direction::Up);
-        const Point dst(board(p));
-
-        if(dst.y == board.selected.y){
-            linearConflict -= computeHorizotally(board, board.selected, dst);
-        }
-        else if(dst.y == p.y){
-            linearConflict += computeHorizotally(board, p, dst);
-        }
+        LinearConflictFeature ret = *this;
+        ret.updateSelection(board, board.selected, newSelect);
+        return ret;
     }
-    
-    void moveLeft(const PlayBoardBase<H, W>& board)
-    {
-        const Point p = board.selected + Point::delta(Direction::Right);
-        const Point dst(board(p));
 
-        if(dst.x == board.selected.x){
-            linearConflict -= computeVertically(board, board.selected, dst);
+private:
+    // selected: 交換後の選択位置，p: 選択してないけど移動させられたセルの移動先，dst: そのセルの正しい位置
+    void update(const Board<H, W>& board, Direction dir, Point selected, Point p, Point dst)
+    {
+        if(dir == Direction::Up || dir == Direction::Down){
+            if(dst.y == selected.y){
+                linearConflict -= computeHorizotally(board, selected, dst);
+            }
+            else if(dst.y == p.y){
+                linearConflict += computeHorizotally(board, p, dst);
+            }
         }
-        else if(dst.x == p.x){
-            linearConflict += computeVertically(board, p, dst);
+        else{
+            if(dst.x == selected.x){
+                linearConflict -= computeVertically(board, selected, dst);
+            }
+            else if(dst.x == p.x){
+                linearConflict += computeVertically(board, p, dst);
+            }
         }
     }
 
-    void select(const PlayBoardBase<H, W>& board, Point preSelect)
+    void updateSelection(const Board<H, W>& board, Point preSelect, Point newSelect)
     {
         const Point preDst(board(preSelect));
         if(preDst.y == preSelect.y){
@@ -104,16 +102,15 @@ public:
             linearConflict += computeVertically(board, preSelect, preDst);
         }
 
-        const Point newDst(board(board.selected));
-        if(newDst.y == board.selected.y){
-            linearConflict -= computeHorizotally(board, board.selected, newDst);
+        const Point newDst(board(newSelect));
+        if(newDst.y == newSelect.y){
+            linearConflict -= computeHorizotally(board, newSelect, newDst);
         }
-        if(newDst.x == board.selected.x){
-            linearConflict -= computeVertically(board, board.selected, newDst);
+        if(newDst.x == newSelect.x){
+            linearConflict -= computeVertically(board, newSelect, newDst);
         }
     }
 
-private:
     static int computeHorizotally(const Board<H, W>& board, Point p, Point dst_a)
     {
         int sum = 0;
@@ -153,39 +150,7 @@ private:
 public:
     static int compute(const PlayBoardBase<H, W>& board)
     {
-        int sum = 0;
-
-        // 横
-        rep(i, board.height()) reps(j, 1, board.width()){
-            if(board.selected == Point(i, j)){
-                continue;
-            }
-
-            const Point dst_a(board(i, j));
-            if(dst_a.y == i){
-                rep(k, j){
-                    const Point dst_b(board(i, k));
-                    sum += dst_b.y == i && dst_a.x < dst_b.x && board.selected != Point(i, k);
-                }
-            }
-        }
-
-        // 縦
-        rep(i, board.width()) reps(j, 1, board.height()){
-            if(board.selected == Point(j, i)){
-                continue;
-            }
-
-            const Point dst_a(board(j, i));
-            if(dst_a.x == i){
-                rep(k, j){
-                    const Point dst_b(board(k, i));
-                    sum += dst_b.x == i && dst_a.y < dst_b.y && board.selected != Point(k, i);
-                }
-            }
-        }
-
-        return sum;
+        return computeFeatureSums(board, FeatureSums::LINEAR_CONFLICT).linearConflict;
     }
 };
 
@@ -12,6 +12,8 @@ class LizardSolver : public Solver
 public:
     static bool verbose;
 
+    int totalBeamWidth = 4000;  // kurage のビーム幅
+
     using Solver::Solver;
     virtual ~LizardSolver() override = default;
 
@@ -1,6 +1,7 @@
 #ifndef SLIDE_MANHATTAN_FEATURE_HPP_
 #define SLIDE_MANHATTAN_FEATURE_HPP_
 
+#include "FeatureKernels.hpp"
 #include "Point.hpp"
 #include "PlayBoard.hpp"
 
@@ -31,7 +32,14 @@ public:
     template<int H, int W>
     void init(const PlayBoardBase<H, W>& board)
     {
-        manhattan = compute(board);
+        init(board, computeFeatureSums(board, FeatureSums::BASIC));
+    }
+
+    // 他の特徴量とまとめて求めた値から作る
+    template<int H, int W>
+    void init(const PlayBoardBase<H, W>& board, const FeatureSums& sums)
+    {
+        manhattan = sums.manhattan;
 
         if(board.isSelected()){
             selId = board(board.selected);
@@ -45,80 +53,35 @@ public:
     template<int H, int W>
     void move(const PlayBoardBase<H, W>& board, Direction dir)
     {
-             if(dir == Direction::Up)    moveUp(board);
-        else if(dir == Direction::Right) moveRight(board);
-        else if(dir == Direction::Down)  moveDown(board);
-        else                             moveLeft(board);
+        // board は交換後の盤面
+        const Point src1 = board.selected - Point::delta(dir);
+        update(dir, src1, board.selected, Point(board(src1)));
     }
 
+    // 交換前の盤面 board から，交換後の特徴量を求める
     template<int H, int W>
-    void moveUp(const PlayBoardBase<H, W>& board)
+    ManhattanFeature peekMove(const PlayBoardBase<H, W>& board, Direction dir) const
     {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Up);
-        const Point dst1 = Point(selId);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        selManhattan += src1.y > dst1.y ? -1 : 1;
-        manhattan    += src2.y < dst2.y ? -1 : 1;
+        const Point src2 = board.selected + Point::delta(dir);
+        ManhattanFeature next = *this;
+        next.update(dir, board.selected, src2, Point(board(src2)));
+        return next;
     }
 
     template<int H, int W>
-    void moveRight(const PlayBoardBase<H, W>& board)
-    {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Right);
-        const Point dst1 = Point(selId);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        selManhattan += src1.x < dst1.x ? -1 : 1;
-        manhattan    += src2.x > dst2.x ? -1 : 1;
-    }
-
-    template<int H, int W>
-    void moveDown(const PlayBoardBase<H, W>& board)
-    {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Down);
-        const Point dst1 = Point(selId);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        selManhattan += src1.y < dst1.y ? -1 : 1;
-        manhattan    += src2.y > dst2.y ? -1 : 1;
-    }
-
-    template<int H, int W>
-    void moveLeft(const PlayBoardBase<H, W>& board)
+    void select(const PlayBoardBase<H, W>& board)
     {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Left);
-        const Point dst1 = Point(selId);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        selManhattan += src1.x > dst1.x ? -1 : 1;
-        manhattan    += src2.x < dst2.x ? -1 : 1;
+        BOOST_ASSERT(board.isSelected());
+        updateSelection(board, board.selected);
     }
 
+    // 選択前の盤面 board から，newSelect を選択した後の特徴量を求める
     template<int H, int W>
-    void select(const PlayBoardBase<H, W>& board)
+    ManhattanFeature peekSelect(const PlayBoardBase<H, W>& board, Point newSelect) const
     {
-        BOOST_ASSERT(board.isSelected());
-        manhattan += selManhattan;
-        selId = board(board.selected);
-        selManhattan = (board.selected - Point(selId)).l1norm();
-        manhattan -= selManhattan;
+        ManhattanFeature next = *this;
+        next.updateSelection(board, newSelect);
+        return next;
     }
 
     void unsetSelection()
@@ -135,15 +98,7 @@ public:
     template<int H, int W>
     static int compute(const PlayBoardBase<H, W>& board)
     {
-        int manhattan = 0;
-
-        rep(i, board.height()) rep(j, board.width()){
-            if(Point(i, j) != board.selected){
-                manhattan += (Point(i, j) - Point(board(i, j))).l1norm();
-            }
-        }
-
-        return manhattan;
+        return computeFeatureSums(board, FeatureSums::BASIC).manhattan;
     }
 
     template<int H, int W>
@@ -178,6 +133,40 @@ public:
     {
         return (p + Point::delta(Direction::Left)).x < Point(board(p)).x ? -1 : 1;
     }
+
+private:
+    // src1: 選択中のセルの移動元，src2: 選択中のセルの移動先 (= 選択してないけど移動させられたセルの移動元)
+    // dst2: 選択してないけど移動させられたセルの正しい位置
+    void update(Direction dir, Point src1, Point src2, Point dst2)
+    {
+        const Point dst1 = Point(selId);
+
+        if(dir == Direction::Up){
+            selManhattan += src1.y > dst1.y ? -1 : 1;
+            manhattan    += src2.y < dst2.y ? -1 : 1;
+        }
+        else if(dir == Direction::Right){
+            selManhattan += src1.x < dst1.x ? -1 : 1;
+            manhattan    += src2.x > dst2.x ? -1 : 1;
+        }
+        else if(dir == Direction::Down){
+            selManhattan += src1.y < dst1.y ? -1 : 1;
+            manhattan    += src2.y > dst2.y ? -1 : 1;
+        }
+        else{
+            selManhattan += src1.x > dst1.x ? -1 : 1;
+            manhattan    += src2.x < dst2.x ? -1 : 1;
+        }
+    }
+
+    template<int H, int W>
+    void updateSelection(const PlayBoardBase<H, W>& board, Point newSelect)
+    {
+        manhattan += selManhattan;
+        selId = board(newSelect);
+        selManhattan = (newSelect - Point(selId)).l1norm();
+        manhattan -= selManhattan;
+    }
 };
 
 } // end of namespace slide
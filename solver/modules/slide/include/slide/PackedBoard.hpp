@@ -0,0 +1,144 @@
+#ifndef SLIDE_PACKED_BOARD_HPP_
+#define SLIDE_PACKED_BOARD_HPP_
+
+#include <type_traits>
+
+#include <boost/assert.hpp>
+
+#include "PlayBoard.hpp"
+
+namespace slide
+{
+
+// PackedBoard に詰められる大きさか (大きさが決まっていて 32 セル以下)
+inline constexpr bool isPackable(int h, int w)
+{
+    return h != Flexible && w != Flexible && h * w <= 32;
+}
+
+// セルを 1 つ 4 bit (16 セル以下) か 5 bit (32 セル以下) に詰めた PlayBoard
+//
+// セルの値は正しい位置の行優先の添字 (y * W + x)．16 セル以下なら 64 bit の語 1 つ，
+// それより大きければ 128 bit の語 1 つか 2 つに収まり，交換は 2 つのセルの xor をシフトして書き戻すだけ．
+// 探索で大量に持つ節点を小さくするためのもので，特徴量は持たない．
+template<int H, int W>
+class PackedBoard
+{
+    static_assert(isPackable(H, W), "PackedBoard needs a fixed size board with at most 32 cells");
+
+public:
+    static constexpr int AREA = H * W;
+    static constexpr int BITS = AREA <= 16 ? 4 : 5;
+
+private:
+    using Word = typename std::conditional<AREA <= 16, ull, unsigned __int128>::type;
+
+    static constexpr int CELLS_PER_WORD = sizeof(Word) * 8 / BITS;
+    static constexpr int WORDS = (AREA + CELLS_PER_WORD - 1) / CELLS_PER_WORD;
+    static constexpr uchar NOT_SELECTED = 0xff;
+
+    Word words[WORDS];
+    uchar selectedIndex;
+
+    static constexpr Word mask() {
+        return (Word(1) << BITS) - 1;
+    }
+
+    static constexpr int wordOf(int i) {
+        return i / CELLS_PER_WORD;
+    }
+
+    static constexpr int shiftOf(int i) {
+        return i % CELLS_PER_WORD * BITS;
+    }
+
+    int get(int i) const {
+        return static_cast<int>(words[wordOf(i)] >> shiftOf(i) & mask());
+    }
+
+public:
+    PackedBoard() = default;
+
+    explicit PackedBoard(const PlayBoardBase<H, W>& board)
+        : words(), selectedIndex(board.isSelected() ? board.selected.toInt(W) : NOT_SELECTED)
+    {
+        rep(i, AREA){
+            words[wordOf(i)] |= Word(Point(board.data()[i]).toInt(W)) << shiftOf(i);
+        }
+    }
+
+    PlayBoard<H, W> unpack() const
+    {
+        PlayBoard<H, W> ret(H, W);
+        rep(i, AREA){
+            ret(Point(uchar(i), W)) = Point(uchar(get(i)), W).toInt();
+        }
+        if(isSelected()){
+            ret.select(selected());
+        }
+        return ret;
+    }
+
+    /**************************************************************************
+     * Accessors
+     *************************************************************************/
+
+    uchar operator()(Point p) const {
+        return Point(uchar(get(p.toInt(W))), W).toInt();
+    }
+
+    uchar operator()(int y, int x) const {
+        return operator()(Point(y, x));
+    }
+
+    bool isSelected() const {
+        return selectedIndex != NOT_SELECTED;
+    }
+
+    Point selected() const {
+        BOOST_ASSERT(isSelected());
+        return Point(selectedIndex, W);
+    }
+
+    bool operator==(const PackedBoard& board) const
+    {
+        rep(i, WORDS){
+            if(words[i] != board.words[i]) return false;
+        }
+        return selectedIndex == board.selectedIndex;
+    }
+
+    bool operator!=(const PackedBoard& board) const {
+        return !(*this == board);
+    }
+
+    /**************************************************************************
+     * Operations
+     *************************************************************************/
+
+    void swap(Point p1, Point p2)
+    {
+        const int i = p1.toInt(W), j = p2.toInt(W);
+        const Word diff = Word(get(i) ^ get(j));
+        words[wordOf(i)] ^= diff << shiftOf(i);
+        words[wordOf(j)] ^= diff << shiftOf(j);
+    }
+
+    void move(Direction dir)
+    {
+        const Point next = selected() + Point::delta(dir);
+        BOOST_ASSERT(next.isIn(H, W));
+        swap(selected(), next);
+        selectedIndex = next.toInt(W);
+    }
+
+    void select(Point newSelect)
+    {
+        BOOST_ASSERT(newSelect.isIn(H, W));
+        selectedIndex = newSelect.toInt(W);
+    }
+};
+
+} // end of namespace slide
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef PARITY_FEATURE_HPP_
 #define PARITY_FEATURE_HPP_
 
+#include "FeatureKernels.hpp"
 #include "PlayBoard.hpp"
 
 namespace slide
@@ -23,13 +24,12 @@ public:
 
     void init(const PlayBoardBase<H, W>& board)
     {
-        parity = false;
+        init(board, computeFeatureSums(board, FeatureSums::PARITY));
+    }
 
-        rep(i, board.area()) rep(j, i) {
-            const Point p1(i/board.width(), i%board.width());
-            const Point p2(j/board.width(), j%board.width());
-            parity ^= board(p1) < board(p2);
-        }
+    void init(const PlayBoardBase<H, W>& board, const FeatureSums& sums)
+    {
+        parity = sums.parity;
 
         selParity = false;
         if(board.isSelected()){
@@ -46,6 +46,13 @@ public:
         selParity = !selParity;
     }
 
+    ParityFeature peekMove() const
+    {
+        ParityFeature next = *this;
+        next.move();
+        return next;
+    }
+
     void select(const PlayBoardBase<H, W>& board)
     {
         select((board.selected - Point(board(board.selected))).l1norm());
@@ -58,6 +65,13 @@ public:
         parity ^= selParity;
     }
 
+    ParityFeature peekSelect(int selManhattan) const
+    {
+        ParityFeature next = *this;
+        next.select(selManhattan);
+        return next;
+    }
+
     void unsetSelection()
     {
         select(0);
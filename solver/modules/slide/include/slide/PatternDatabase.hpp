@@ -0,0 +1,101 @@
+#ifndef SLIDE_PATTERN_DATABASE_HPP_
+#define SLIDE_PATTERN_DATABASE_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Point.hpp"
+#include "util/define.hpp"
+
+namespace slide
+{
+
+// 互いに素な断片 (連続した正しい位置を持つセルの組) 毎のパターンデータベース
+//
+// 選択に関係なく，隣り合うセルの交換は 2 つのセルをそれぞれ 1 マス動かす．
+// 断片毎に「断片のセルだけを区別し，隣り合う任意のセルを交換してよい」緩和問題を考え，
+// 断片のセルが動いた延べ回数の最小値を後ろ向きの探索で求めておく．
+// 全ての断片の和は交換回数の 2 倍以下なので，マンハッタン距離の代わりに下界に使える．
+//
+// 表は「各セルの位置 * 面積^(断片内の番号)」の和で引く (移動の度に差分で更新できる)．
+// 生成した表は終了までメモリに持つ．directory を指定したときだけファイルに書き出し，次からは mmap して読む．
+class PatternDatabase
+{
+public:
+    // 断片の数の上限 (盤面が持つ添字の数)
+    static constexpr int MAX_PATTERNS = 12;
+
+    // 表 1 つの大きさの上限 [byte] (これを満たす断片が作れない大きさの盤面では使わない)
+    static constexpr std::size_t MAX_TABLE_BYTES = std::size_t(1) << 24;
+
+    // false なら表を使わない (下界はマンハッタン距離だけで計算する)
+    static bool enabled;
+
+    // 表を書き出すディレクトリ (空ならファイルを使わず，プロセス毎にメモリ上で生成する)
+    static std::string directory;
+
+    // 表が届かないセル
+    static constexpr uchar UNREACHABLE = 0xff;
+
+private:
+    int h;
+    int w;
+    int patternSize;
+    int patternNum;
+
+    // 正しい位置のセルの id (Point::toInt) 毎の，断片の番号と添字への重み
+    uchar patternOf[MAX_DIVISION_NUM * MAX_DIVISION_NUM];
+    uint weightOf[MAX_DIVISION_NUM * MAX_DIVISION_NUM];
+
+    // 断片毎の表 (mapped か memory の中を指す)
+    std::vector<const uchar*> tables;
+    std::size_t tableSize;
+
+    std::unique_ptr<uchar[]> memory;
+
+    void* mapped;
+    std::size_t mappedBytes;
+
+    PatternDatabase(int h, int w);
+
+    void generate(const std::string& path) const;
+    void build();
+    void generateTable(int pattern, uchar* table) const;
+    bool map(const std::string& path);
+
+public:
+    PatternDatabase(const PatternDatabase&) = delete;
+    PatternDatabase& operator=(const PatternDatabase&) = delete;
+    ~PatternDatabase();
+
+    // h * w の盤面の表を読む (無ければ生成する)．作れない大きさか，使わない場合は nullptr
+    // 一度読んだ表は終了まで持ち続ける
+    static const PatternDatabase* load(int h, int w);
+
+    // load 済みの表 (無ければ nullptr)
+    static const PatternDatabase* find(int h, int w);
+
+    int height() const { return h; }
+    int width() const { return w; }
+    int area() const { return h * w; }
+    int size() const { return patternNum; }
+
+    int patternOfCell(uchar id) const {
+        return patternOf[id];
+    }
+
+    // 位置 p にあるセル id の，その断片の添字への寄与
+    uint weight(uchar id, Point p) const {
+        return weightOf[id] * (p.y * w + p.x);
+    }
+
+    int lookup(int pattern, uint index) const {
+        return tables[pattern][index];
+    }
+};
+
+} // end of namespace slide
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SLIDE_PATTERN_FEATURE_HPP_
+#define SLIDE_PATTERN_FEATURE_HPP_
+
+#include <array>
+
+#include "PatternDatabase.hpp"
+#include "PlayBoard.hpp"
+
+namespace slide
+{
+
+// パターンデータベースの値の和 (断片のセルが動く延べ回数の下界)
+// 選択しても値は変わらない．表が読まれていない大きさの盤面では常に 0
+class PatternFeature
+{
+private:
+    const PatternDatabase* db;
+    std::array<uint, PatternDatabase::MAX_PATTERNS> index;
+    ushort sum;
+
+public:
+    PatternFeature() = default;
+
+    template<int H, int W>
+    explicit PatternFeature(const PlayBoardBase<H, W>& board) {
+        init(board);
+    }
+
+    template<int H, int W>
+    void init(const PlayBoardBase<H, W>& board)
+    {
+        db = PatternDatabase::find(board.height(), board.width());
+        sum = 0;
+        if(db == nullptr){
+            return;
+        }
+
+        index.fill(0u);
+        rep(i, board.height()) rep(j, board.width()) {
+            const uchar id = board(i, j);
+            index[db->patternOfCell(id)] += db->weight(id, Point(i, j));
+        }
+        rep(i, db->size()){
+            sum += db->lookup(i, index[i]);
+        }
+    }
+
+    int operator()() const {
+        return sum;
+    }
+
+    template<int H, int W>
+    void move(const PlayBoardBase<H, W>& board, Direction dir)
+    {
+        if(db == nullptr){
+            return;
+        }
+
+        // board は交換後の盤面
+        const Point src1 = board.selected - Point::delta(dir);
+        const Point src2 = board.selected;
+        const uchar id1  = board(src2);
+        const uchar id2  = board(src1);
+        const int p1 = db->patternOfCell(id1);
+        const int p2 = db->patternOfCell(id2);
+
+        // 同じ断片のセル同士なら，両方動かしてから引く
+        sum -= db->lookup(p1, index[p1]);
+        if(p2 != p1){
+            sum -= db->lookup(p2, index[p2]);
+        }
+
+        index[p1] += db->weight(id1, src2) - db->weight(id1, src1);
+        index[p2] += db->weight(id2, src1) - db->weight(id2, src2);
+
+        sum += db->lookup(p1, index[p1]);
+        if(p2 != p1){
+            sum += db->lookup(p2, index[p2]);
+        }
+    }
+};
+
+} // end of namespace slide
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SLIDE_PORTFOLIO_SOLVER_HPP_
+#define SLIDE_PORTFOLIO_SOLVER_HPP_
+
+#include <string>
+#include <vector>
+
+#include "Solver.hpp"
+
+namespace slide
+{
+
+// 複数のソルバを同時に走らせ，最も良い解答を採用する
+// 各ソルバは 1 つの TBB の arena の中のタスクとして同時に動き，numThreads を share の比で分けた大きさの入れ子の arena で並列化する．
+// 最適だと分かった解答が見つかるか締め切りを過ぎると，残りのソルバを打ち切る．
+class PortfolioSolver : public Solver
+{
+public:
+    struct Entry
+    {
+        std::string name;   // create_solver に渡す名前
+        double share;       // 並列化数の割合 (0 なら 1 スレッド)
+    };
+
+    static bool verbose;
+
+    std::vector<Entry> entries = {{"straight", 0.0}, {"kurage", 1.0}, {"dragon", 1.0}, {"lizard", 1.0}};
+
+    // 最も良い解答を出したソルバの名前 (solve の後に読む)
+    std::string winner;
+
+    using Solver::Solver;
+    virtual ~PortfolioSolver() override = default;
+
+    void solve() override;
+
+    // "kurage:2,dragon:1,straight" の形式 (share を省略すると 1)
+    static std::vector<Entry> parseEntries(const std::string& str);
+
+private:
+    // 解答のコストの下界 (これに達した解答は最適)
+    int lowerBound() const;
+
+    // 見つけた解答が最適であるソルバか
+    static bool isExact(const std::string& name);
+};
+
+} // end of namespace slide
+
+#endif
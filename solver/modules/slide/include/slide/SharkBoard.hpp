@@ -50,10 +50,17 @@ public:
 		MoveCountCoefficient = ManhattanDistanceCoefficient;
 	}
 
-	double evaluate(Point candidatePoint)
+	double evaluate(Point candidatePoint) const
+	{
+		SharkBoard tmp;
+		return evaluate(candidatePoint, tmp);
+	}
+
+	// tmp は作業用の盤面 (使い回せば盤面や解答の領域を確保し直さずに済む)
+	double evaluate(Point candidatePoint, SharkBoard& tmp) const
 	{
 		double s = 0.0;
-		SharkBoard tmp = *this;
+		tmp = *this;
 		tmp.align(candidatePoint);
 
 		s += MeanCoefficient * evaluateMean(tmp);
@@ -109,7 +116,7 @@ public:
 		return x_sum + y_sum;
 	}
 
-	double evaluateMean(SharkBoard board) const 
+	double evaluateMean(const SharkBoard& board) const 
 	{
 		int x_sum = 0;
 		int y_sum = 0;
@@ -169,7 +176,7 @@ public:
         return sum;
     }
 
-    int manhattan(SharkBoard board) const 
+    int manhattan(const SharkBoard& board) const 
     {
     	int selManhattan = 0;
     	int manhattan = 0;
@@ -1,7 +1,10 @@
 #ifndef SLIDE_SOLVER_HPP_
 #define SLIDE_SOLVER_HPP_
 
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -14,10 +17,22 @@ namespace slide
 class Solver
 {
 public:
+    using Clock = std::chrono::steady_clock;
+
 	Problem problem;
     int numThreads = -1;
+
+    // 解答が見つかる度に呼ばれる (それまでに渡したものよりコストが真に小さい解答だけ)
 	std::function<void(const Answer&)> onCreatedAnswer;
 
+    // onCreatedAnswer と同時に，コストと startTime からの経過時間 [ms] を付けて呼ばれる
+    // コストは呼ばれる度に真に小さくなる
+    std::function<void(const Answer&, int cost, double elapsed)> onImprovedAnswer;
+
+    // deadline を過ぎると，各ソルバはそれまでに見つけた解答を残して探索をやめる
+    Clock::time_point startTime = Clock::now();
+    Clock::time_point deadline = Clock::time_point::max();
+
 	Solver() = default;
 	Solver(const Problem& problem) : problem(problem) {}
 	virtual ~Solver() = default;
@@ -25,6 +40,47 @@ public:
 	virtual void solve() = 0;
 	static std::unique_ptr<Solver> create_solver(const std::string& solver_name,
                                                  const Problem& problem);
+
+    // 今から seconds 秒後を締め切りにする
+    void setTimeLimit(double seconds);
+
+    // 内部で使うソルバに締め切りを引き継ぐ (parent が cancel されたときも止まる)
+    void inheritDeadline(const Solver& parent)
+    {
+        startTime = parent.startTime;
+        deadline = parent.deadline;
+        this->parent = &parent;
+    }
+
+    // 他のスレッドから探索を打ち切る
+    void cancel()
+    {
+        cancelled.store(true, std::memory_order_release);
+    }
+
+    bool isTimeUp() const
+    {
+        return cancelled.load(std::memory_order_acquire)
+            || (parent != nullptr && parent->isTimeUp())
+            || (deadline != Clock::time_point::max() && Clock::now() >= deadline);
+    }
+
+    int cost(const Answer& answer) const;
+
+    // これまでに渡した解答の最小コスト (まだ無ければ 1 << 29)
+    int bestCost();
+
+protected:
+    // これまでに渡した解答より良ければ onCreatedAnswer, onImprovedAnswer に渡す
+    // 複数のスレッドから呼んでよい
+    bool publishAnswer(const Answer& answer);
+
+private:
+    std::mutex publishMutex;
+    int publishedCost = 1 << 29;
+
+    std::atomic<bool> cancelled{false};
+    const Solver* parent = nullptr;
 };
 
 } // end of namespace slide
@@ -0,0 +1,90 @@
+#ifndef SLIDE_SOLVER_PROFILE_HPP_
+#define SLIDE_SOLVER_PROFILE_HPP_
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+
+#include "Problem.hpp"
+#include "Solver.hpp"
+
+namespace slide
+{
+
+// 過去に解いた問題の特徴と，使ったソルバ・パラメータ・時間・コストの表
+// 新しい問題には，特徴の近い記録の中で最もコストの小さかったソルバとパラメータを選ぶ．
+// ファイルは 1 行 1 記録の空白区切り (height width selectionLimit manhattan costRatio solver beamWidth kurageMaxArea time cost completed)
+// 締め切りで打ち切られた記録 (completed = 0) の時間はそのソルバが必要な時間ではないので，選ぶときには使わない．
+// completed の無い古い記録は終わったものとして読む．
+class SolverProfile
+{
+public:
+    struct Features
+    {
+        int height;
+        int width;
+        int selectionLimit;
+        int manhattan;      // 初期盤面のマンハッタン距離
+        double costRatio;   // 選択コスト / 交換コスト
+
+        static Features of(const Problem& problem);
+
+        double distance(const Features& other) const;
+    };
+
+    struct Parameters
+    {
+        std::string solver;
+        int totalBeamWidth;
+        int kurageMaxArea;
+
+        // solver に合わせて名前以外のパラメータを設定する
+        void apply(Solver& target) const;
+
+        // target に設定されているパラメータを読む
+        static Parameters of(const std::string& solver, const Solver& target);
+
+        bool operator==(const Parameters& other) const
+        {
+            return solver == other.solver && totalBeamWidth == other.totalBeamWidth && kurageMaxArea == other.kurageMaxArea;
+        }
+    };
+
+    struct Record
+    {
+        Features features;
+        Parameters parameters;
+        double time;    // [ms]
+        int cost;
+        bool completed; // 締め切りや打ち切りで止められずに終わったか
+    };
+
+    std::vector<Record> records;
+
+    // 選ぶときに見る，近い記録の数
+    int neighbors = 8;
+
+    SolverProfile() = default;
+
+    explicit SolverProfile(const boost::filesystem::path& path)
+    {
+        load(path);
+    }
+
+    // ファイルが無ければ空のまま
+    void load(const boost::filesystem::path& path);
+    void save(const boost::filesystem::path& path) const;
+
+    // 1 記録だけをファイルの末尾に書き足す
+    static void append(const boost::filesystem::path& path, const Record& record);
+
+    // 打ち切られた記録と，timeLimit [ms] を超えた記録は使わない (0 以下なら制限なし)
+    // 使える記録が無ければ none
+    boost::optional<Parameters> select(const Features& features, double timeLimit = 0.0) const;
+};
+
+} // end of namespace slide
+
+#endif
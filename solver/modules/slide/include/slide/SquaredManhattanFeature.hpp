@@ -1,6 +1,7 @@
 #ifndef SLIDE_SQUARED_MANHATTAN_FEATURE_HPP_
 #define SLIDE_SQUARED_MANHATTAN_FEATURE_HPP_
 
+#include "FeatureKernels.hpp"
 #include "Point.hpp"
 #include "PlayBoard.hpp"
 #include "util/sqrt_approx.hpp"
@@ -31,96 +32,83 @@ public:
         return util::sqrt_approx(manhattan);
     }
 
-    void init(const PlayBoardBase<H, W>& board)
+    void init(const PlayBoardBase<H, W>& board, int y, int x, int h, int w)
     {
+        this->y = y;
+        this->x = x;
+        this->h = h;
+        this->w = w;
         manhattan = compute(board);
     }
 
-    void move(const PlayBoardBase<H, W>& board, Direction dir)
+    void init(const PlayBoardBase<H, W>&, const FeatureSums& sums)
     {
-             if(dir == Direction::Up)    moveUp(board);
-        else if(dir == Direction::Right) moveRight(board);
-        else if(dir == Direction::Down)  moveDown(board);
-        else                             moveLeft(board);
+        manhattan = sums.squaredManhattan;
     }
 
-    void moveUp(const PlayBoardBase<H, W>& board)
+    void move(const PlayBoardBase<H, W>& board, Direction dir)
     {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Up);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        manhattan += (src2.y < dst2.y ? -2 : 2) * (src1 - dst2).l1norm() - 1;
+        // board は交換後の盤面
+        const Point src1 = board.selected - Point::delta(dir);
+        update(dir, src1, board.selected, Point(board(src1)));
     }
 
-    void moveRight(const PlayBoardBase<H, W>& board)
+    // 交換前の盤面 board から，交換後の特徴量を求める
+    SquaredManhattanFeature peekMove(const PlayBoardBase<H, W>& board, Direction dir) const
     {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Right);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
+        const Point src2 = board.selected + Point::delta(dir);
+        SquaredManhattanFeature next = *this;
+        next.update(dir, board.selected, src2, Point(board(src2)));
+        return next;
+    }
 
-        manhattan += (src2.x > dst2.x ? -2 : 2) * (src1 - dst2).l1norm() - 1;
+    void select(const PlayBoardBase<H, W>& board, Point preSelect)
+    {
+        BOOST_ASSERT(board.isSelected());
+        updateSelection(board, preSelect, board.selected);
     }
 
-    void moveDown(const PlayBoardBase<H, W>& board)
+    // 選択前の盤面 board から，newSelect を選択した後の特徴量を求める
+    SquaredManhattanFeature peekSelect(const PlayBoardBase<H, W>& board, Point newSelect) const
     {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Down);
+        SquaredManhattanFeature next = *this;
+        next.updateSelection(board, board.selected, newSelect);
+        return next;
+    }
 
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
+    /**************************************************************************
+     * For static use
+     *************************************************************************/
 
-        manhattan += (src2.y > dst2.y ? -2 : 2) * (src1 - dst2).l1norm() - 1;
+    static int compute(const PlayBoardBase<H, W>& board)
+    {
+        return computeFeatureSums(board, FeatureSums::BASIC).squaredManhattan;
     }
 
-    void moveLeft(const PlayBoardBase<H, W>& board)
+private:
+    // src1: 選択中のセルの移動元，src2: 選択中のセルの移動先 (= 選択してないけど移動させられたセルの移動元)
+    // dst2: 選択してないけど移動させられたセルの正しい位置
+    void update(Direction dir, Point src1, Point src2, Point dst2)
     {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Left);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
+        int sign;
+             if(dir == Direction::Up)    sign = src2.y < dst2.y ? -2 : 2;
+        else if(dir == Direction::Right) sign = src2.x > dst2.x ? -2 : 2;
+        else if(dir == Direction::Down)  sign = src2.y > dst2.y ? -2 : 2;
+        else                             sign = src2.x < dst2.x ? -2 : 2;
 
-        manhattan += (src2.x < dst2.x ? -2 : 2) * (src1 - dst2).l1norm() - 1;
+        manhattan += sign * (src1 - dst2).l1norm() - 1;
     }
 
-    void select(const PlayBoardBase<H, W>& board, Point preSelect)
+    void updateSelection(const PlayBoardBase<H, W>& board, Point preSelect, Point newSelect)
     {
-        BOOST_ASSERT(board.isSelected());
         if(preSelect.y >= 0){
             const int tmp = (preSelect - Point(board(preSelect))).l1norm();
             manhattan += tmp * tmp;
         }
 
-        const int tmp = (board.selected - Point(board(board.selected))).l1norm();
+        const int tmp = (newSelect - Point(board(newSelect))).l1norm();
         manhattan -= tmp * tmp;
     }
-
-    /**************************************************************************
-     * For static use
-     *************************************************************************/
-
-    static int compute(const PlayBoardBase<H, W>& board)
-    {
-        int manhattan = 0;
-
-        rep(i, board.height()) rep(j, board.width()){
-            if(Point(i, j) != board.selected){
-                const int tmp = (Point(i, j) - Point(board(i, j))).l1norm();
-                manhattan += tmp * tmp;
-            }
-        }
-
-        return manhattan;
-    }
 };
 
 template<int H, int W>
@@ -133,19 +121,20 @@ class RestrictedSquaredManhattanFeature
 private:
     int manhattan;
 
-    constexpr static int getCoefficient(Point p)
+    // 距離を数えない領域 [x, x+w)×[y, y+h) (盤面毎に持つので，同時に動く別のソルバと干渉しない)
+    uchar y, x, h, w;
+
+    constexpr int getCoefficient(Point p) const
     {
         return p.isIn(y, x, h, w) ? 0 : 1;
     }
 
 public:
-    static int y, x, h, w;
-
     RestrictedSquaredManhattanFeature() = default;
 
-    explicit RestrictedSquaredManhattanFeature(const PlayBoardBase<H, W>& board)
+    RestrictedSquaredManhattanFeature(const PlayBoardBase<H, W>& board, int y, int x, int h, int w)
     {
-        init(board);
+        init(board, y, x, h, w);
     }
 
     constexpr float operator()() const
@@ -153,86 +142,47 @@ public:
         return util::sqrt_approx(manhattan);
     }
 
-    void init(const PlayBoardBase<H, W>& board)
+    void init(const PlayBoardBase<H, W>& board, int y, int x, int h, int w)
     {
+        this->y = y;
+        this->x = x;
+        this->h = h;
+        this->w = w;
         manhattan = compute(board);
     }
 
     void move(const PlayBoardBase<H, W>& board, Direction dir)
     {
-             if(dir == Direction::Up)    moveUp(board);
-        else if(dir == Direction::Right) moveRight(board);
-        else if(dir == Direction::Down)  moveDown(board);
-        else                             moveLeft(board);
+        // board は交換後の盤面
+        const Point src1 = board.selected - Point::delta(dir);
+        update(dir, src1, board.selected, Point(board(src1)));
     }
 
-    void moveUp(const PlayBoardBase<H, W>& board)
+    // 交換前の盤面 board から，交換後の特徴量を求める
+    RestrictedSquaredManhattanFeature peekMove(const PlayBoardBase<H, W>& board, Direction dir) const
     {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Up);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        manhattan += getCoefficient(dst2) * ((src2.y < dst2.y ? -2 : 2) * (src1 - dst2).l1norm() - 1);
-    }
-
-    void moveRight(const PlayBoardBase<H, W>& board)
-    {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Right);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        manhattan += getCoefficient(dst2) * ((src2.x > dst2.x ? -2 : 2) * (src1 - dst2).l1norm() - 1);
-    }
-
-    void moveDown(const PlayBoardBase<H, W>& board)
-    {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Down);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        manhattan += getCoefficient(dst2) * ((src2.y > dst2.y ? -2 : 2) * (src1 - dst2).l1norm() - 1);
-    }
-
-    void moveLeft(const PlayBoardBase<H, W>& board)
-    {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Left);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        manhattan += getCoefficient(dst2) * ((src2.x < dst2.x ? -2 : 2) * (src1 - dst2).l1norm() - 1);
+        const Point src2 = board.selected + Point::delta(dir);
+        RestrictedSquaredManhattanFeature next = *this;
+        next.update(dir, board.selected, src2, Point(board(src2)));
+        return next;
     }
 
     void select(const PlayBoardBase<H, W>& board, Point preSelect)
     {
         BOOST_ASSERT(board.isSelected());
-        if(preSelect.y >= 0){
-            const Point dst(board(preSelect));
-            const int tmp = (preSelect - Point(board(preSelect))).l1norm();
-            manhattan += getCoefficient(dst) * tmp * tmp;
-        }
-
-        const Point dst(board(board.selected));
-        const int tmp = (board.selected - dst).l1norm();
-        manhattan -= getCoefficient(dst) * tmp * tmp;
+        updateSelection(board, preSelect, board.selected);
     }
 
-    /**************************************************************************
-     * For static use
-     *************************************************************************/
+    // 選択前の盤面 board から，newSelect を選択した後の特徴量を求める
+    RestrictedSquaredManhattanFeature peekSelect(const PlayBoardBase<H, W>& board, Point newSelect) const
+    {
+        RestrictedSquaredManhattanFeature next = *this;
+        next.updateSelection(board, board.selected, newSelect);
+        return next;
+    }
 
-    static int compute(const PlayBoardBase<H, W>& board)
+private:
+    int compute(const PlayBoardBase<H, W>& board) const
     {
         int manhattan = 0;
 
@@ -246,19 +196,33 @@ public:
 
         return manhattan;
     }
-};
 
-template<int H, int W>
-int RestrictedSquaredManhattanFeature<H, W>::y;
+    // src1: 選択中のセルの移動元，src2: 選択中のセルの移動先 (= 選択してないけど移動させられたセルの移動元)
+    // dst2: 選択してないけど移動させられたセルの正しい位置
+    void update(Direction dir, Point src1, Point src2, Point dst2)
+    {
+        int sign;
+             if(dir == Direction::Up)    sign = src2.y < dst2.y ? -2 : 2;
+        else if(dir == Direction::Right) sign = src2.x > dst2.x ? -2 : 2;
+        else if(dir == Direction::Down)  sign = src2.y > dst2.y ? -2 : 2;
+        else                             sign = src2.x < dst2.x ? -2 : 2;
 
-template<int H, int W>
-int RestrictedSquaredManhattanFeature<H, W>::x;
+        manhattan += getCoefficient(dst2) * (sign * (src1 - dst2).l1norm() - 1);
+    }
 
-template<int H, int W>
-int RestrictedSquaredManhattanFeature<H, W>::h;
+    void updateSelection(const PlayBoardBase<H, W>& board, Point preSelect, Point newSelect)
+    {
+        if(preSelect.y >= 0){
+            const Point dst(board(preSelect));
+            const int tmp = (preSelect - Point(board(preSelect))).l1norm();
+            manhattan += getCoefficient(dst) * tmp * tmp;
+        }
 
-template<int H, int W>
-int RestrictedSquaredManhattanFeature<H, W>::w;
+        const Point dst(board(newSelect));
+        const int tmp = (newSelect - dst).l1norm();
+        manhattan -= getCoefficient(dst) * tmp * tmp;
+    }
+};
 
 } // end of namespace slide
 
@@ -2,6 +2,7 @@
 #define SLIDE_URCHIN_BOARD_HPP_
 
 #include <algorithm>
+#include <utility>
 #include <vector>
 
 #include "AlignBoard.hpp"
@@ -45,13 +46,15 @@ private:
 public:
 	UrchinBoardBase() = default;
 
-	UrchinBoardBase(const PlayBoardBase<H, W>& board) {
-		init(board);
+	template<typename... Args>
+	UrchinBoardBase(const PlayBoardBase<H, W>& board, Args&&... args) {
+		init(board, std::forward<Args>(args)...);
 	}
 
-	void init(const PlayBoardBase<H, W>& board)
+	template<typename... Args>
+	void init(const PlayBoardBase<H, W>& board, Args&&... args)
 	{
-		Base::init(board);
+		Base::init(board, std::forward<Args>(args)...);
 		std::fill_n(leftMost, arrayH, 0);
 		std::fill_n(rightMost, arrayH, width()-1);
     }
@@ -1,6 +1,7 @@
 #ifndef SLIDE_VARIANCE_FEATURE_HPP_
 #define SLIDE_VARIANCE_FEATURE_HPP_
 
+#include "FeatureKernels.hpp"
 #include "PlayBoard.hpp"
 
 namespace slide
@@ -31,6 +32,27 @@ private:
         --cnt;
     }
 
+    // 選択中のセルが pre から selected へ移動し，id のセルが selected から pre へ移動する
+    void update(const PlayBoardBase<H, W>& board, Point pre, Point selected, uchar id)
+    {
+        if(board.correctId(selected) != id){
+            remove(selected);
+        }
+        if(board.correctId(pre) != id){
+            add(pre);
+        }
+    }
+
+    void updateSelection(const PlayBoardBase<H, W>& board, Point preSelect, Point newSelect)
+    {
+        if(preSelect.y >= 0 && !board.isAligned(preSelect)){
+            add(preSelect);
+        }
+        if(!board.isAligned(newSelect)){
+            remove(newSelect);
+        }
+    }
+
 public:
     VarianceFeature() = default;
 
@@ -40,16 +62,15 @@ public:
 
     void init(const PlayBoardBase<H, W>& board)
     {
-        squaredSum = 0;
-        sum_y = 0;
-        sum_x = 0;
-        cnt = 0;
-
-        rep(i, board.height()) rep(j, board.width()){
-            if(!board.isAligned(i, j) && board.selected != Point(i, j)){
-                add(Point(i, j));
-            }
-        }
+        init(board, computeFeatureSums(board, FeatureSums::BASIC));
+    }
+
+    void init(const PlayBoardBase<H, W>&, const FeatureSums& sums)
+    {
+        squaredSum = sums.squaredSum;
+        sum_y = sums.sumY;
+        sum_x = sums.sumX;
+        cnt = sums.count;
     }
 
     float operator()() const
@@ -59,25 +80,31 @@ public:
 
     void move(const PlayBoardBase<H, W>& board, Direction dir)
     {
+        // board は交換後の盤面
         const Point pre = board.selected - Point::delta(dir);
-        const uchar id = board(pre);
+        update(board, pre, board.selected, board(pre));
+    }
 
-        if(board.correctId(board.selected) != id){
-            remove(board.selected);
-        }
-        if(board.correctId(pre) != id){
-            add(pre);
-        }
+    // 交換前の盤面 board から，交換後の特徴量を求める
+    VarianceFeature peekMove(const PlayBoardBase<H, W>& board, Direction dir) const
+    {
+        const Point next = board.selected + Point::delta(dir);
+        VarianceFeature ret = *this;
+        ret.update(board, board.selected, next, board(next));
+        return ret;
     }
 
     void select(const PlayBoardBase<H, W>& board, Point preSelect)
     {
-        if(preSelect.y >= 0 && !board.isAligned(preSelect)){
-            add(preSelect);
-        }
-        if(!board.isAligned(board.selected)){
-            remove(board.selected);
-        }
+        updateSelection(board, preSelect, board.selected);
+    }
+
+    // 選択前の盤面 board から，newSelect を選択した後の特徴量を求める
+    VarianceFeature peekSelect(const PlayBoardBase<H, W>& board, Point newSelect) const
+    {
+        VarianceFeature ret = *this;
+        ret.updateSelection(board, board.selected, newSelect);
+        return ret;
     }
 
     static float compute(const PlayBoardBase<H, W>& board)
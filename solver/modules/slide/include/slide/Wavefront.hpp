@@ -0,0 +1,149 @@
+#ifndef SLIDE_WAVEFRONT_HPP_
+#define SLIDE_WAVEFRONT_HPP_
+
+#include <algorithm>
+
+#include <boost/assert.hpp>
+
+#include "BitBoard.hpp"
+#include "Direction.hpp"
+#include "Point.hpp"
+#include "util/define.hpp"
+
+namespace slide
+{
+
+// fixed のセルを避けて選択セルを動かす BFS (BitBoard の行単位で波面を広げる)
+//
+// 移動回数 d で初めて届くセルを層 layers[d] として行毎の bit 列で持つ．
+// 次の層は前の層の左右へのシフトと上下の行との or を，空いていてまだ届いていないセルで mask したもので，
+// 1 歩が行数回の論理演算で済む．経路は dst から層を 1 つずつ戻って求める．
+template<int H, int W>
+class Wavefront
+{
+public:
+    static constexpr int arrayH = arraySize(H);
+    static constexpr int arrayW = arraySize(W);
+    static constexpr uchar UNREACHABLE = 0xff;
+
+private:
+    int h, w;
+    int depth;                                  // 層の数
+    ushort layers[arrayH * arrayW + 1][arrayH]; // 空いたセルは arrayH * arrayW 個以下なので層もそれ以下
+
+    bool contains(int d, Point p) const {
+        return layers[d][p.y] >> p.x & 1;
+    }
+
+    // stop が true なら dst に届いたところで止める
+    void expand(const BitBoard<H, W>& fixed, Point src, Point dst, bool stop)
+    {
+        h = fixed.height();
+        w = fixed.width();
+        const uint full = (1u << w) - 1;
+
+        uint open[arrayH], visited[arrayH];
+        rep(i, h){
+            open[i] = ~uint(fixed.row(i)) & full;
+            visited[i] = layers[0][i] = 0;
+        }
+        visited[src.y] = layers[0][src.y] = 1u << src.x;
+        depth = 1;
+
+        if(stop && src == dst){
+            return;
+        }
+
+        while(true){
+            const ushort* front = layers[depth - 1];
+            ushort* next = layers[depth];
+
+            uint any = 0;
+            rep(i, h){
+                uint reach = uint(front[i]) << 1 | front[i] >> 1;
+                if(i > 0)     reach |= front[i-1];
+                if(i < h - 1) reach |= front[i+1];
+                next[i] = reach & open[i] & ~visited[i];
+                any |= next[i];
+            }
+            if(any == 0){
+                return;
+            }
+
+            rep(i, h){
+                visited[i] |= next[i];
+            }
+            ++depth;
+
+            if(stop && contains(depth - 1, dst)){
+                return;
+            }
+        }
+    }
+
+public:
+    // src から dst までの最小の移動回数 (動かせなければ -1)．dst に届いたところで止める．
+    int search(const BitBoard<H, W>& fixed, Point src, Point dst)
+    {
+        BOOST_ASSERT(src.isIn(fixed.height(), fixed.width()));
+        BOOST_ASSERT(dst.isIn(fixed.height(), fixed.width()));
+        BOOST_ASSERT(!fixed(src));
+
+        expand(fixed, src, dst, true);
+        return contains(depth - 1, dst) ? depth - 1 : -1;
+    }
+
+    // src から届く全てのセルまで広げる
+    void searchAll(const BitBoard<H, W>& fixed, Point src)
+    {
+        BOOST_ASSERT(src.isIn(fixed.height(), fixed.width()));
+        BOOST_ASSERT(!fixed(src));
+
+        expand(fixed, src, src, false);
+    }
+
+    // 各セルまでの移動回数 (届かなければ UNREACHABLE)．searchAll の後なら全てのセルについて正しい．
+    void distances(uchar dist[arrayH][arrayW]) const
+    {
+        rep(i, h){
+            std::fill_n(dist[i], w, UNREACHABLE);
+        }
+        rep(d, depth) rep(i, h){
+            for(uint bits = layers[d][i]; bits != 0; bits &= bits - 1){
+                dist[i][__builtin_ctz(bits)] = d;
+            }
+        }
+    }
+
+    // search で届いた dst への最短経路を pre に書く (pre[p] は p に入るときの向き．経路上のセルだけ書く)．
+    // 前の層の隣のセルのうち，Direction の番号が最も小さい向きから入るものを選ぶ．
+    void tracePath(Point dst, char pre[arrayH][arrayW]) const
+    {
+        BOOST_ASSERT(contains(depth - 1, dst));
+
+        Point p = dst;
+        for(int d = depth - 1; d > 0; --d){
+            rep(k, 4){
+                const Point q = p - Point::delta(Direction(k));
+                if(q.isIn(h, w) && contains(d - 1, q)){
+                    pre[p.y][p.x] = k;
+                    p = q;
+                    break;
+                }
+            }
+        }
+    }
+};
+
+template<int H, int W>
+constexpr int Wavefront<H, W>::arrayH;
+
+template<int H, int W>
+constexpr int Wavefront<H, W>::arrayW;
+
+template<int H, int W>
+constexpr uchar Wavefront<H, W>::UNREACHABLE;
+
+} // end of namespace slide
+
+#endif
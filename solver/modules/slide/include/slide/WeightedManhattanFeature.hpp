@@ -38,78 +38,43 @@ public:
 
     void move(const PlayBoardBase<H, W>& board, Direction dir)
     {
-             if(dir == Direction::Up)    moveUp(board);
-        else if(dir == Direction::Right) moveRight(board);
-        else if(dir == Direction::Down)  moveDown(board);
-        else                             moveLeft(board);
+        // board は交換後の盤面
+        const Point src1 = board.selected - Point::delta(dir);
+        update(board, dir, board.selected, board(src1));
     }
 
-    void moveUp(const PlayBoardBase<H, W>& board)
+    // 交換前の盤面 board から，交換後の特徴量を求める
+    WeightedManhattanFeature peekMove(const PlayBoardBase<H, W>& board, Direction dir) const
     {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Up);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        manhattan += weight(board(src1)) * (src2.y < dst2.y ? -1 : 1);
-    }
-
-    void moveRight(const PlayBoardBase<H, W>& board)
-    {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Right);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        manhattan += weight(board(src1)) * (src2.x > dst2.x ? -2 : 2);
-    }
-
-    void moveDown(const PlayBoardBase<H, W>& board)
-    {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Down);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        manhattan += weight(board(src1)) * (src2.y > dst2.y ? -2 : 2);
-    }
-
-    void moveLeft(const PlayBoardBase<H, W>& board)
-    {
-        // 選択中のセル
-        const Point src1 = board.selected - Point::delta(Direction::Left);
-
-        // 選択してないけど移動させられたセル
-        const Point src2 = board.selected;
-        const Point dst2 = Point(board(src1));
-
-        manhattan += weight(board(src1)) * (src2.x < dst2.x ? -2 : 2);
+        const Point src2 = board.selected + Point::delta(dir);
+        WeightedManhattanFeature next = *this;
+        next.update(board, dir, src2, board(src2));
+        return next;
     }
 
     void select(const PlayBoardBase<H, W>& board, Point preSelect)
     {
         BOOST_ASSERT(board.isSelected());
-        if(preSelect.y >= 0){
-            manhattan += weight(board(preSelect)) * (preSelect - Point(board(preSelect))).l1norm();
-        }
+        updateSelection(board, preSelect, board.selected);
+    }
 
-        manhattan -= weight(board(board.selected)) * (board.selected - Point(board(board.selected))).l1norm();
+    // 選択前の盤面 board から，newSelect を選択した後の特徴量を求める
+    WeightedManhattanFeature peekSelect(const PlayBoardBase<H, W>& board, Point newSelect) const
+    {
+        WeightedManhattanFeature next = *this;
+        next.updateSelection(board, board.selected, newSelect);
+        return next;
     }
 
     /**************************************************************************
      * For static use
      *************************************************************************/
 
-    static float weight(uchar id)
+    static float weight(const PlayBoardBase<H, W>& board, uchar id)
     {
         const Point dst(id);
-        return (util::abs(dst.y - (H-1)*0.5f) + util::abs(dst.x - (W-1)*0.5f)) / (H+W-2) + 1; // ∈ [1, 2]
+        const int h = board.height(), w = board.width();
+        return (util::abs(dst.y - (h-1)*0.5f) + util::abs(dst.x - (w-1)*0.5f)) / (h+w-2) + 1; // ∈ [1, 2]
     }
 
     static float compute(const PlayBoardBase<H, W>& board)
@@ -118,12 +83,33 @@ public:
 
         rep(i, board.height()) rep(j, board.width()){
             if(Point(i, j) != board.selected){
-                manhattan += weight(board(i, j)) * (Point(i, j) - Point(board(i, j))).l1norm();
+                manhattan += weight(board, board(i, j)) * (Point(i, j) - Point(board(i, j))).l1norm();
             }
         }
 
         return manhattan;
     }
+
+private:
+    // src2: 選択してないけど移動させられたセルの移動元，id2: そのセルの番号
+    void update(const PlayBoardBase<H, W>& board, Direction dir, Point src2, uchar id2)
+    {
+        const Point dst2(id2);
+
+             if(dir == Direction::Up)    manhattan += weight(board, id2) * (src2.y < dst2.y ? -1 : 1);
+        else if(dir == Direction::Right) manhattan += weight(board, id2) * (src2.x > dst2.x ? -2 : 2);
+        else if(dir == Direction::Down)  manhattan += weight(board, id2) * (src2.y > dst2.y ? -2 : 2);
+        else                             manhattan += weight(board, id2) * (src2.x < dst2.x ? -2 : 2);
+    }
+
+    void updateSelection(const PlayBoardBase<H, W>& board, Point preSelect, Point newSelect)
+    {
+        if(preSelect.y >= 0){
+            manhattan += weight(board, board(preSelect)) * (preSelect - Point(board(preSelect))).l1norm();
+        }
+
+        manhattan -= weight(board, board(newSelect)) * (newSelect - Point(board(newSelect))).l1norm();
+    }
 };
 
 } // end of namespace slide
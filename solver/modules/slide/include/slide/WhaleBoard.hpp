@@ -40,19 +40,21 @@ public:
 
     WhaleBoard() = default;
 
-    WhaleBoard(const PlayBoard<H, W>& board)
+    // [x, x+w)×[y, y+h) は二乗マンハッタン距離に数えない
+    WhaleBoard(const PlayBoard<H, W>& board, AnswerLinearTree& tree, const ZobristTable<H, W>* table, int y, int x, int h, int w)
     {
-        init(board);
+        init(board, tree, table, y, x, h, w);
     }
 
-    void init(const PlayBoard<H, W>& board)
+    void init(const PlayBoard<H, W>& board, AnswerLinearTree& tree, const ZobristTable<H, W>* table, int y, int x, int h, int w)
     {
         PlayBoardBase<H, W>::operator=(board);
-        ManhattanFeature::init(*this);
-        linearConflict.init(*this);
-        squaredManhattan.init(*this);
-        AnswerTreeFeature::init();
-        hash.init(*this);
+        const FeatureSums sums = computeFeatureSums(*this, FeatureSums::LINEAR_CONFLICT);
+        ManhattanFeature::init(*this, sums);
+        linearConflict.init(*this, sums);
+        squaredManhattan.init(*this, y, x, h, w);
+        AnswerTreeFeature::init(tree);
+        hash.init(*this, table);
         firstManhattan = manhattan;
         preMove = Move(Direction::Up);
     }
@@ -69,12 +71,7 @@ public:
     // more less, more better
     float evaluate(int thread = util::ThreadIndexManager::getLocalId()) const
     {
-        float s = 0.0f;
-        s += 10 * manhattan;
-        s += 20 * linearConflict();
-        s += 60 * manhattan / (firstManhattan + 1) * util::Random::nextReal(thread);
-        s += 200 * squaredManhattan();
-        return s;
+        return evaluate(*this, linearConflict, squaredManhattan, thread);
     }
 
     /**************************************************************************
@@ -83,12 +80,8 @@ public:
 
     void move(Direction dir, int thread = util::ThreadIndexManager::getLocalId())
     {
-        PlayBoardBase<H, W>::move(dir);
-        ManhattanFeature::move(*this, dir);
-        linearConflict.move(*this, dir);
-        squaredManhattan.move(*this, dir);
+        moveFeatures(dir);
         AnswerTreeFeature::move(dir, thread);
-        hash.move(*this, dir);
 
         preMove = Move(dir);
         score = evaluate(thread);
@@ -108,6 +101,72 @@ public:
         preMove = Move(newSelect);
         score = evaluate(thread);
     }
+
+    // 評価済みの子を実体化する (評価値は計算し直さない)
+    void apply(Direction dir, float childScore, int thread = util::ThreadIndexManager::getLocalId())
+    {
+        moveFeatures(dir);
+        AnswerTreeFeature::move(dir, thread);
+
+        preMove = Move(dir);
+        score = childScore;
+    }
+
+    /**************************************************************************
+     * Lookahead
+     *************************************************************************/
+
+    // 実体化していない子の情報
+    struct Child
+    {
+        float score;
+        ull hash;
+        ushort manhattan;
+
+        constexpr bool isFinished() const {
+            return manhattan == 0;
+        }
+    };
+
+    // 解答木に節点を追加せず，盤面もコピーせずに子を評価する
+    Child peekMove(Direction dir, int thread = util::ThreadIndexManager::getLocalId()) const
+    {
+        const ManhattanFeature nextManhattan = ManhattanFeature::peekMove(*this, dir);
+        const LinearConflictFeature<H, W> nextLinearConflict = linearConflict.peekMove(*this, dir);
+        const RestrictedSquaredManhattanFeature<H, W> nextSquaredManhattan = squaredManhattan.peekMove(*this, dir);
+
+        return {
+            evaluate(nextManhattan, nextLinearConflict, nextSquaredManhattan, thread),
+            hash.peekMove(*this, dir)(),
+            nextManhattan.manhattan
+        };
+    }
+
+private:
+    float evaluate(
+        const ManhattanFeature& manhattanFeature,
+        const LinearConflictFeature<H, W>& linearConflictFeature,
+        const RestrictedSquaredManhattanFeature<H, W>& squaredManhattanFeature,
+        int thread) const
+    {
+        const int manhattan = manhattanFeature.manhattan;
+
+        float s = 0.0f;
+        s += 10 * manhattan;
+        s += 20 * linearConflictFeature();
+        s += 60 * manhattan / (firstManhattan + 1) * util::Random::nextReal(thread);
+        s += 200 * squaredManhattanFeature();
+        return s;
+    }
+
+    void moveFeatures(Direction dir)
+    {
+        PlayBoardBase<H, W>::move(dir);
+        ManhattanFeature::move(*this, dir);
+        linearConflict.move(*this, dir);
+        squaredManhattan.move(*this, dir);
+        hash.move(*this, dir);
+    }
 };
 
 } // end of namespace slide
@@ -1,6 +1,7 @@
 #ifndef SLIDE_WHALE_SOLVER_HPP_
 #define SLIDE_WHALE_SOLVER_HPP_
 
+#include <cstddef>
 #include <utility>
 #include <vector>
 
@@ -18,6 +19,7 @@ class WhaleSolver : public Solver
 public:
     static bool verbose;
     int totalBeamWidth = 4000;
+    std::size_t visitedCapacity = 1 << 23;
     int offset_x;
     int offset_y;
 
@@ -33,7 +35,7 @@ public:
     }
 
     template<int H, int W>
-    std::vector<AnswerTreeBoard<H, W>> decreaseManhattan(const PlayBoard<H, W>& start, int selectionLimit, int y, int x, int h, int w);
+    std::vector<AnswerTreeBoard<H, W>> decreaseManhattan(const PlayBoard<H, W>& start, AnswerLinearTree& tree, int selectionLimit, int y, int x, int h, int w);
 
 };
 
@@ -1,7 +1,8 @@
 #ifndef ZOBRIST_HASH_HPP_
 #define ZOBRIST_HASH_HPP_
 
-#include <type_traits>
+#include <vector>
+
 #include <boost/assert.hpp>
 
 #include "Board.hpp"
@@ -12,98 +13,66 @@
 namespace slide
 {
 
-template<int H, int W>
-class FixedZobristTableVariables
-{
-protected:
-    ull table[MAX_DIVISION_NUM * MAX_DIVISION_NUM][H][W];    // [id][pos.y][pos.x]
-    ull selectedTable[MAX_DIVISION_NUM * MAX_DIVISION_NUM];  // [id]
-
-    FixedZobristTableVariables() = default;
-    FixedZobristTableVariables(const FixedZobristTableVariables&) = default;
-
-    constexpr int height() const {
-        return H;
-    }
-    constexpr int width() const {
-        return W;
-    }
-
-#ifdef NDEBUG
-    void resize(int, int) {}
-#else
-    void resize(int h, int w) {
-    	BOOST_ASSERT(h == H && w == W);
-    }
-#endif
-};
-
-class FlexibleZobristTableVariables
-{
-protected:
-    int h, w;
-    ull table[MAX_DIVISION_NUM * MAX_DIVISION_NUM][MAX_DIVISION_NUM][MAX_DIVISION_NUM];
-    ull selectedTable[MAX_DIVISION_NUM * MAX_DIVISION_NUM];
-
-    FlexibleZobristTableVariables() = default;
-    FlexibleZobristTableVariables(const FlexibleZobristTableVariables&) = default;
-    constexpr FlexibleZobristTableVariables(int h, int w) : h(h), w(w), table(), selectedTable() {}
-
-public:
-    constexpr int height() const {
-        return h;
-    }
-    constexpr int width() const {
-        return w;
-    }
-    void resize(int h, int w) {
-        this->h = h;
-        this->w = w;
-    }
-};
-
-template<int H, int W>
-using ZobristTableVariables = typename std::conditional<H != Flexible, FixedZobristTableVariables<H, W>, FlexibleZobristTableVariables>::type;
-
+// Zobrist ハッシュの鍵
+//
+// (id, 位置) 毎の鍵を表に持つと 16x16 で 512 KiB になり，交換の度にばらばらの 4 箇所を引くことになる．
+// そこで id 毎，位置毎の乱数 (各 256 個) だけを持ち，その xor を 128 bit の積の上位と下位の xor で混ぜたものを
+// (id, 位置) の鍵とする (単なる xor や和では盤面全体の xor が並びによらず一定になってしまう)．
+// 表は選択用，fixed 用と合わせて 8 KiB で L1 に収まり，鍵の計算は積 1 回で済む．衝突率は exe/test_zobrist で確かめられる．
+// 表がキャッシュに載ったままなら 1 回引くだけの元の表より遅いが，探索の合間に追い出された後は 8x8 以上で速い (同じく test_zobrist)．
+// H, W は他の盤面の型と揃えるためだけのもので，表の大きさには関わらない．
 template<int _H, int _W = _H>
-class ZobristTable : ZobristTableVariables<_H, _W>
+class ZobristTable
 {
-private:
-    using Base = ZobristTableVariables<_H, _W>;
-    using Base::table;
-    using Base::selectedTable;
-
 public:
     static constexpr int H = _H;
     static constexpr int W = _W;
+    static constexpr int KEYS = MAX_DIVISION_NUM * MAX_DIVISION_NUM;
 
-    using Base::height;
-    using Base::width;
+private:
+    ull idKeys[KEYS];           // [id]
+    ull positionKeys[KEYS];     // [pos.toInt()]
+    ull selectedKeys[KEYS];     // [id]
+    ull fixedKeys[KEYS];        // [pos.toInt()]
+    int h, w;
 
+    static ull mix(ull x)
+    {
+        const unsigned __int128 r = static_cast<unsigned __int128>(x) * 0x9e3779b97f4a7c15ull;
+        return static_cast<ull>(r) ^ static_cast<ull>(r >> 64);
+    }
+
+public:
     ZobristTable(){
         static_assert((H != Flexible && W != Flexible) || (H == Flexible && W == Flexible),
             "Both of H and W must be Flexible or must be non-Flexible simultaniously!");
-        init();
+        init(H, W);
     };
 
     ZobristTable(int h, int w) {
         init(h, w);
     }
 
-    void init()
+    void init(int h, int w)
     {
-        rep(i, MAX_DIVISION_NUM * MAX_DIVISION_NUM) rep(y, height()) rep(x, width()){
-            table[i][y][x] = util::Random::nextULL();
-        }
-        rep(i, MAX_DIVISION_NUM * MAX_DIVISION_NUM){
-        	selectedTable[i] = util::Random::nextULL();
+        BOOST_ASSERT(H == Flexible || (h == H && w == W));
+        this->h = h;
+        this->w = w;
+
+        rep(i, KEYS){
+            idKeys[i] = util::Random::nextULL();
+            positionKeys[i] = util::Random::nextULL();
+            selectedKeys[i] = util::Random::nextULL();
+            fixedKeys[i] = util::Random::nextULL();
         }
     }
 
-    void init(int h, int w)
-    {
-        Base::resize(h, w);
-        init();
+    int height() const {
+        return h;
+    }
+
+    int width() const {
+        return w;
     }
 
     ull look(uchar id, Point pos) const
@@ -111,27 +80,40 @@ public:
         BOOST_ASSERT(Point(id).isIn(height(), width()));
         BOOST_ASSERT(pos.isIn(height(), width()));
 
-        return table[id][pos.y][pos.x];
+        return mix(idKeys[id] ^ positionKeys[pos.toInt()]);
     }
 
     ull lookSelected(uchar id) const
     {
-        BOOST_ASSERT(Point(id).isIn(H, W));
-        return selectedTable[id];
+        BOOST_ASSERT(Point(id).isIn(height(), width()));
+        return selectedKeys[id];
     }
 
-    ull& look(uchar id, Point pos)
+    // pos のセルが fix されていることの鍵 (FixBoard の盤面を区別するときに使う)
+    ull lookFixed(Point pos) const
     {
-        BOOST_ASSERT(Point(id).isIn(height(), width()));
         BOOST_ASSERT(pos.isIn(height(), width()));
+        return fixedKeys[pos.toInt()];
+    }
 
-        return table[id][pos.y][pos.x];
+    // 位置 src1, src2 にある id1, id2 のセルを交換したときのハッシュ値の変化 (交換の前後どちらから見ても同じ)
+    ull swapDelta(uchar id1, uchar id2, Point src1, Point src2) const
+    {
+        const ull k1 = idKeys[id1], k2 = idKeys[id2];
+        const ull p1 = positionKeys[src1.toInt()], p2 = positionKeys[src2.toInt()];
+        return mix(k1 ^ p1) ^ mix(k1 ^ p2) ^ mix(k2 ^ p1) ^ mix(k2 ^ p2);
     }
 
-    ull& lookSelected(uchar id)
+    // id の付け替え (id -> table[id]) をした盤面用の表 (付け替えた盤面でも同じ状態は同じハッシュ値になる)
+    ZobristTable relabel(const std::vector<uchar>& table) const
     {
-        BOOST_ASSERT(Point(id).isIn(H, W));
-        return selectedTable[id];
+        ZobristTable ret = *this;
+        rep(i, height()) rep(j, width()){
+            const uchar id = Point(i, j).toInt();
+            ret.idKeys[table[id]] = idKeys[id];
+            ret.selectedKeys[table[id]] = selectedKeys[id];
+        }
+        return ret;
     }
 };
 
@@ -30,224 +30,50 @@ inline SolveCaller<Callee> make_solve_caller(Callee& callee)
     return SolveCaller<Callee>(callee);
 }
 
-#ifdef USE_FAST_BRANCH
+template<int... Sizes>
+struct BranchSizes {};
+
+// 固定の大きさの PlayBoard<H, W> に特殊化して実体化する (H, W) の組
+// (CMake の BRANCH_SIZES か BRANCH_PROFILE から決まる．cmake/BranchSizes.cmake 参照．指定がなければ FAST と同じ)
+#ifdef SLIDE_BRANCH_SIZES
+using SpecializedSizes = BranchSizes<SLIDE_BRANCH_SIZES>;
+#else
+using SpecializedSizes = BranchSizes<
+    8,8, 12,8, 4,4, 16,16, 9,9, 10,10, 6,6, 5,5, 8,4, 7,7, 3,6, 9,8, 2,16, 3,16, 4,16, 10,8, 12,12,
+    2,2, 2,3, 2,4, 2,5, 2,6, 2,7, 2,8, 3,2, 3,3, 3,4, 3,5, 4,2, 4,3, 5,2, 5,3, 6,2, 7,2, 8,2
+>;
+#endif
+
+namespace details
+{
 
 template<typename F, typename... Args>
-typename std::result_of<F(const PlayBoard<Flexible>&, Args&&...)>::type branch(F&& f, const PlayBoard<Flexible>& board, Args&& ...args)
+typename std::result_of<F(const PlayBoard<Flexible>&, Args&&...)>::type branch(BranchSizes<>, F&& f, const PlayBoard<Flexible>& board, Args&& ...args)
 {
-    if(board.height() == 8 && board.width() == 8){
-        return f(PlayBoard<8, 8>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 12 && board.width() == 8){
-        return f(PlayBoard<12, 8>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 4 && board.width() == 4){
-        return f(PlayBoard<4, 4>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 16 && board.width() == 16){
-        return f(PlayBoard<16, 16>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 9 && board.width() == 9){
-        return f(PlayBoard<9, 9>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 10 && board.width() == 10){
-        return f(PlayBoard<10, 10>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 6 && board.width() == 6){
-        return f(PlayBoard<6, 6>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 5 && board.width() == 5){
-        return f(PlayBoard<5, 5>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 8 && board.width() == 4){
-        return f(PlayBoard<8, 4>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 7 && board.width() == 7){
-        return f(PlayBoard<7, 7>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 3 && board.width() == 6){
-        return f(PlayBoard<3, 6>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 9 && board.width() == 8){
-        return f(PlayBoard<9, 8>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 2 && board.width() == 16){
-        return f(PlayBoard<2, 16>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 3 && board.width() == 16){
-        return f(PlayBoard<3, 16>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 4 && board.width() == 16){
-        return f(PlayBoard<4, 16>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 10 && board.width() == 8){
-        return f(PlayBoard<10, 8>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 12 && board.width() == 8){
-        return f(PlayBoard<12, 8>(board), std::forward<Args>(args)...);
-    }
-    else if(board.height() == 12 && board.width() == 12){
-        return f(PlayBoard<12, 12>(board), std::forward<Args>(args)...);
-    }
-    else{
-        return f(board, std::forward<Args>(args)...);
-    }
+    return f(board, std::forward<Args>(args)...);
 }
 
-#else
-
-template<typename F, typename... Args>
-typename std::result_of<F(const PlayBoard<Flexible>&, Args&&...)>::type branch(F&& f, const PlayBoard<Flexible>& board, Args&& ...args)
+template<int H, int W, int... Sizes, typename F, typename... Args>
+typename std::result_of<F(const PlayBoard<Flexible>&, Args&&...)>::type branch(BranchSizes<H, W, Sizes...>, F&& f, const PlayBoard<Flexible>& board, Args&& ...args)
 {
-    const int x = board.height();
-    if(x < 9){
-        if(x < 6){
-            if(x < 4){
-                if(x == 2){
-                    return branch<F, 2, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-                else{
-                    return branch<F, 3, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-            }
-            else{
-                if(x == 4){
-                    return branch<F, 4, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-                else{
-                    return branch<F, 5, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-            }
-        }
-        else{
-            if(x == 6){
-                return branch<F, 6, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-            }
-            else if(x == 7){
-                return branch<F, 7, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-            }
-            else{
-                return branch<F, 8, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-            }
-        }
-    }
-    else{
-        if(x < 13){
-            if(x < 11){
-                if(x == 9){
-                    return branch<F, 9, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-                else{
-                    return branch<F, 10, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-            }
-            else{
-                if(x == 11){
-                    return branch<F, 11, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-                else{
-                    return branch<F, 12, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-            }
-        }
-        else{
-            if(x < 15){
-                if(x == 13){
-                    return branch<F, 13, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-                else{
-                    return branch<F, 14, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-            }
-            else{
-                if(x == 15){
-                    return branch<F, 15, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-                else{
-                    return branch<F, 16, Args...>(std::forward<F>(f), board, std::forward<Args>(args)...);
-                }
-            }
-        }
+    static_assert(2 <= H && H <= MAX_DIVISION_NUM && 2 <= W && W <= MAX_DIVISION_NUM, "invalid size in SLIDE_BRANCH_SIZES");
+    if(board.height() == H && board.width() == W){
+        return f(PlayBoard<H, W>(board), std::forward<Args>(args)...);
     }
+    return branch(BranchSizes<Sizes...>(), std::forward<F>(f), board, std::forward<Args>(args)...);
 }
 
-template<typename F, int H, typename... Args>
+} // end of namespace details
+
+// 盤面の大きさが SpecializedSizes にあれば PlayBoard<H, W> に直して f を呼び，
+// なければ PlayBoard<Flexible> のまま f を呼ぶ (大きさを実行時に持つ汎用の経路)．
+// f が make_solve_caller で作ったものなら，汎用の経路は solve<Flexible, Flexible> の実体になる．
+template<typename F, typename... Args>
 typename std::result_of<F(const PlayBoard<Flexible>&, Args&&...)>::type branch(F&& f, const PlayBoard<Flexible>& board, Args&& ...args)
 {
-    const int x = board.width();
-    if(x < 9){
-        if(x < 6){
-            if(x < 4){
-                if(x == 2){
-                    return f(PlayBoard<H, 2>(board), std::forward<Args>(args)...);
-                }
-                else{
-                    return f(PlayBoard<H, 3>(board), std::forward<Args>(args)...);
-                }
-            }
-            else{
-                if(x == 4){
-                    return f(PlayBoard<H, 4>(board), std::forward<Args>(args)...);
-                }
-                else{
-                    return f(PlayBoard<H, 5>(board), std::forward<Args>(args)...);
-                }
-            }
-        }
-        else{
-            if(x == 6){
-                return f(PlayBoard<H, 6>(board), std::forward<Args>(args)...);
-            }
-            else if(x == 7){
-                return f(PlayBoard<H, 7>(board), std::forward<Args>(args)...);
-            }
-            else{
-                return f(PlayBoard<H, 8>(board), std::forward<Args>(args)...);
-            }
-        }
-    }
-    else{
-        if(x < 13){
-            if(x < 11){
-                if(x == 9){
-                    return f(PlayBoard<H, 9>(board), std::forward<Args>(args)...);
-                }
-                else{
-                    return f(PlayBoard<H, 10>(board), std::forward<Args>(args)...);
-                }
-            }
-            else{
-                if(x == 11){
-                    return f(PlayBoard<H, 11>(board), std::forward<Args>(args)...);
-                }
-                else{
-                    return f(PlayBoard<H, 12>(board), std::forward<Args>(args)...);
-                }
-            }
-        }
-        else{
-            if(x < 15){
-                if(x == 13){
-                    return f(PlayBoard<H, 13>(board), std::forward<Args>(args)...);
-                }
-                else{
-                    return f(PlayBoard<H, 14>(board), std::forward<Args>(args)...);
-                }
-            }
-            else{
-                if(x == 15){
-                    return f(PlayBoard<H, 15>(board), std::forward<Args>(args)...);
-                }
-                else{
-                    return f(PlayBoard<H, 16>(board), std::forward<Args>(args)...);
-                }
-            }
-        }
-    }
+    return details::branch(SpecializedSizes(), std::forward<F>(f), board, std::forward<Args>(args)...);
 }
 
-#endif
-
 };
 
 #endif
@@ -14,8 +14,9 @@
 #include <tbb/partitioner.h>
 #include <tbb/tbb.h>
 
+#include "util/parallel_select.hpp"
 #include "util/StopWatch.hpp"
-#include "util/SpinMutex.hpp"
+#include "util/ThreadIndexManager.hpp"
 
 namespace slide
 {
@@ -26,17 +27,19 @@ AnswerTreeBoard<H, W> DolphinSolver::compute(const std::vector<AnswerTreeBoard<H
     using DolphinBoard = DolphinUrchinBoard<H, W>;
     //using DolphinBoard = DolphinOctopusBoard<H, W>;
 
+    // 揃える順番が違うだけの同じ盤面をビームから除くためのハッシュ
+    const ZobristTable<H, W> table(start[0].height(), start[0].width());
+
     std::vector<DolphinBoard> boards;
-    std::vector<DolphinBoard> nextBoards;
 
     if(start[0].isSelected()){
         boards.reserve(start.size());
         for(const AnswerTreeBoard<H, W>& board : start){
             BOOST_ASSERT(Point(board(board.selected)).isIn(y, x, h, w));
-            DolphinBoard dolphin(board);
+            DolphinBoard dolphin(board, *board.tree);
+            dolphin.initHash(&table);
             dolphin.swappingCount = board.swappingCount;
-            dolphin.index = board.index;
-            dolphin.thread = board.thread;
+            static_cast<AnswerTreeFeature&>(dolphin) = board;
             boards.push_back(std::move(dolphin));
         }
     }
@@ -44,36 +47,70 @@ AnswerTreeBoard<H, W> DolphinSolver::compute(const std::vector<AnswerTreeBoard<H
         // [x, x+w)×[y, y+h) 内の全部の位置を初期位置としてセットする
         if(h == 2){
             rep(i, h) rep(j, w-2){
-                DolphinBoard board(start[0]);
+                DolphinBoard board(start[0], *start[0].tree);
+                board.initHash(&table);
                 board.select(board.find(board.correctId(i, j+x+1)));
                 boards.push_back(board);
             }
         }
         else if(w == 2){
             rep(i, h-2) rep(j, w){
-                DolphinBoard board(start[0]);
+                DolphinBoard board(start[0], *start[0].tree);
+                board.initHash(&table);
                 board.select(board.find(board.correctId(i+y+1, j)));
                 boards.push_back(board);
             }
         }
         else {
             rep(i, h-2) rep(j, w-2){
-                DolphinBoard board(start[0]);
+                DolphinBoard board(start[0], *start[0].tree);
+                board.initHash(&table);
                 board.select(board.find(board.correctId(i+y+1, j+x+1)));
                 boards.push_back(board);
             }
         }
     }
-    DolphinBoard returnAnswerBoard;
-    returnAnswerBoard.swappingCount = 1 << 29;
+    // スレッド毎の出力先 (ロックを取らずに子の盤面を書き，反復を跨いで使い回す)
+    struct Segment
+    {
+        std::vector<DolphinBoard> boards;   // 子の盤面
+        std::vector<int> scores;            // boards の評価値
+        std::vector<ull> hashes;            // boards のハッシュ値
+        std::vector<Point> cand, cand_tmp;  // getCandidates の作業領域
+    };
+    std::vector<Segment> segments(util::ThreadIndexManager::MAX_THREADS);
+
+    int indices_shift;
+    for(indices_shift = 0; (1 << indices_shift) < util::ThreadIndexManager::MAX_THREADS; ++indices_shift);
+    const uint indices_mask = (1u << indices_shift) - 1;
+
+    // (ハッシュ値, indices 内の位置) をハッシュ値の順に並べたもの (同じ盤面を隣り合わせにする)
+    std::vector<std::pair<ull, uint>> byHash;
+
+    // indices 内の位置毎の，そこに残す子の indices 内の位置 (残さなければ -1)
+    std::vector<int> keep;
+
+    // 親の盤面毎の子の出力先 (スレッド番号，segment 内の先頭) と個数
+    std::vector<std::pair<int, int>> childBegin;
+    std::vector<int> childOffset;
+    std::vector<char> finished;
 
-    bool returnCheck = false;
+    // (評価値, segment 内の位置 << indices_shift | スレッド番号) を親の順，候補の順に並べたもの
+    std::vector<std::pair<int, uint>> indices;
 
-    std::vector<std::pair<int, int>> boardIndices;
-    util::SpinMutex scoreMutex;
-    util::SpinMutex returnMutex;
+    // ハッシュ値などを除いた，盤面と解答木だけを返す
+    const auto result = [](const DolphinBoard& board){
+        AnswerTreeBoard<H, W> ret;
+        static_cast<AnswerTreeBoardBase<H, W>&>(ret) = board;
+        return ret;
+    };
 
     for(;;){
+        // 締め切りを過ぎたら，揃えきっていなくても評価値の最も良い盤面 (boards の先頭) を返す
+        if(isTimeUp() && !boards.empty()){
+            return result(boards[0]);
+        }
+
         int min = 1 << 29;
         int max = 0;
         if(verbose){
@@ -83,62 +120,148 @@ AnswerTreeBoard<H, W> DolphinSolver::compute(const std::vector<AnswerTreeBoard<H
             }
         }
 
-        //util::StopWatch::start("parallel for each");
-        tbb::parallel_for_each(begin(boards), end(boards),
-            [&returnMutex, &scoreMutex, &boardIndices, &returnCheck,
-             &returnAnswerBoard, &nextBoards, y, x, h, w]
-        (const DolphinBoard& board){
+        const int numBoards = boards.size();
+        childBegin.resize(numBoards);
+        childOffset.assign(numBoards + 1, 0);
+        finished.assign(numBoards, false);
+        for(Segment& segment : segments){
+            segment.boards.clear();
+            segment.scores.clear();
+            segment.hashes.clear();
+        }
+
+        //util::StopWatch::start("parallel for");
+        tbb::parallel_for(tbb::blocked_range<int>(0, numBoards),
+            [&boards, &segments, &childBegin, &childOffset, &finished, y, x, h, w]
+        (const tbb::blocked_range<int>& range){
+            const int thread = util::ThreadIndexManager::getLocalId();
+            Segment& segment = segments[thread];
+            std::vector<Point>& cand = segment.cand;
+            std::vector<Point>& cand_tmp = segment.cand_tmp;
 
-            std::vector<Point> cand, cand_tmp;
-            board.getCandidates(cand_tmp);
+            for(int i = range.begin(); i != range.end(); ++i){
+                const DolphinBoard& board = boards[i];
 
-            for(const Point& candidatePoint : cand_tmp){
-                if(!candidatePoint.isIn(y, x, h, w)){
-                    cand.emplace_back(candidatePoint);
+                cand.clear();
+                board.getCandidates(cand_tmp);
+
+                for(const Point& candidatePoint : cand_tmp){
+                    if(!candidatePoint.isIn(y, x, h, w)){
+                        cand.emplace_back(candidatePoint);
+                    }
                 }
-            }
 
-            // check whether finished or not
-            if(cand.empty()){
-                std::lock_guard<util::SpinMutex> lock(returnMutex);
-                if(returnAnswerBoard.swappingCount > board.swappingCount){
-                    returnCheck = true;
-                    returnAnswerBoard = board;
+                // check whether finished or not
+                if(cand.empty()){
+                    finished[i] = true;
                 }
-            }
 
-            // align piece
-            for(const Point& candidatePoint : cand){
-                DolphinBoard next = board;
-                if(next.find(next.correctId(candidatePoint)) == next.selected)
-                    continue;
-                double score = next.align(candidatePoint);
-                std::lock_guard<util::SpinMutex> lock(scoreMutex);
-                boardIndices.emplace_back(score, boardIndices.size());
-                nextBoards.push_back(std::move(next));
+                // align piece
+                childBegin[i] = std::make_pair(thread, int(segment.boards.size()));
+                for(const Point& candidatePoint : cand){
+                    DolphinBoard next = board;
+                    if(next.find(next.correctId(candidatePoint)) == next.selected)
+                        continue;
+                    segment.scores.push_back(next.align(candidatePoint));
+                    segment.hashes.push_back(next.hash());
+                    segment.boards.push_back(std::move(next));
+                }
+                childOffset[i + 1] = segment.boards.size() - childBegin[i].second;
             }
         });
         //util::StopWatch::stop_last();
 
-        if(returnCheck){
-            verbose && std::cerr << '\n' << returnAnswerBoard << std::endl;
-            return returnAnswerBoard;
+        // 終わった盤面のうち交換回数の最も少ないもの (同じなら前の盤面) を返す
+        int answer = -1;
+        rep(i, numBoards){
+            if(finished[i] && (answer == -1 || boards[answer].swappingCount > boards[i].swappingCount)){
+                answer = i;
+            }
+        }
+        if(answer != -1){
+            verbose && std::cerr << '\n' << boards[answer] << std::endl;
+            return result(boards[answer]);
         }
 
-        // boardsのupdate , 5msec程度
-        if(nextBoards.size() > beamWidth){
-            std::partial_sort(boardIndices.begin(), boardIndices.begin() + beamWidth, boardIndices.end());
-            boards.resize(beamWidth);
-            rep(i, beamWidth){
-                boards[i] = nextBoards[boardIndices[i].second];
+        // スレッド毎の出力を親の順に並べ直すので，並びはスレッド数やスケジュールによらない
+        rep(i, numBoards){
+            childOffset[i + 1] += childOffset[i];
+        }
+        indices.resize(childOffset[numBoards]);
+        rep(i, numBoards){
+            const int thread = childBegin[i].first;
+            const Segment& segment = segments[thread];
+            for(int j = childBegin[i].second, k = childOffset[i]; k < childOffset[i + 1]; ++j, ++k){
+                indices[k] = std::make_pair(segment.scores[j], (uint(j) << uint(indices_shift)) | uint(thread));
             }
         }
-        else{
-            boards.swap(nextBoards);
+
+        // 同じ盤面は交換回数の最も少ないもの (同じなら前のもの) だけを，最初に現れた位置に残す
+        // ハッシュ値の順に並べて同じ盤面を隣り合わせにし，盤面毎に残すものを並列に選ぶ
+        const int numChildren = indices.size();
+        byHash.resize(numChildren);
+        keep.assign(numChildren, -1);
+
+        tbb::parallel_for(tbb::blocked_range<int>(0, numChildren),
+            [&indices, &segments, &byHash, indices_shift, indices_mask](const tbb::blocked_range<int>& range){
+            for(int k = range.begin(); k != range.end(); ++k){
+                const uint id = indices[k].second;
+                byHash[k] = std::make_pair(segments[id & indices_mask].hashes[id >> indices_shift], uint(k));
+            }
+        });
+        tbb::parallel_sort(byHash.begin(), byHash.end());
+
+        tbb::parallel_for(tbb::blocked_range<int>(0, numChildren),
+            [&indices, &segments, &byHash, &keep, numChildren, indices_shift, indices_mask](const tbb::blocked_range<int>& range){
+            const auto swappingCount = [&indices, &segments, indices_shift, indices_mask](uint k){
+                const uint id = indices[k].second;
+                return segments[id & indices_mask].boards[id >> indices_shift].swappingCount;
+            };
+
+            // 同じハッシュ値の並びの先頭から，位置の順に見る
+            for(int i = range.begin(); i != range.end(); ++i){
+                if(i > 0 && byHash[i - 1].first == byHash[i].first){
+                    continue;
+                }
+                uint best = byHash[i].second;
+                for(int j = i + 1; j < numChildren && byHash[j].first == byHash[i].first; ++j){
+                    if(swappingCount(byHash[j].second) < swappingCount(best)){
+                        best = byHash[j].second;
+                    }
+                }
+                keep[byHash[i].second] = best;
+            }
+        });
+
+        // 残すものを indices の順に詰める (ここだけ逐次．keep[k] >= k なので前から詰めてよい)
+        int numUnique = 0;
+        rep(k, numChildren){
+            if(keep[k] != -1){
+                indices[numUnique++] = indices[keep[k]];
+            }
+        }
+        indices.resize(numUnique);
+
+        // boardsのupdate (評価値の上位 beamWidth 個を評価値の順に，同じなら親の順，候補の順に並べる)
+        if(indices.size() > beamWidth){
+            util::parallel_select(indices, beamWidth);
+            std::stable_sort(indices.begin(), indices.end(),
+                [](const std::pair<int, uint>& a, const std::pair<int, uint>& b){ return a.first < b.first; });
+        }
+        boards.resize(indices.size());
+        rep(i, indices.size()){
+            const uint id = indices[i].second;
+            boards[i] = std::move(segments[id & indices_mask].boards[id >> indices_shift]);
         }
 
-        nextBoards.clear();
-        boardIndices.clear();
+        // ビームから外れた盤面の解答木を捨てる
+        if(!boards.empty() && boards[0].tree->needsReclaim()){
+            std::vector<AnswerTreeFeature*> roots;
+            for(DolphinBoard& board : boards){
+                roots.push_back(&board);
+            }
+            boards[0].tree->reclaim(roots);
+        }
 
         verbose && std::cerr << min << '/' << max << ' ';
     }
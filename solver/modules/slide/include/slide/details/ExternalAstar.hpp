@@ -0,0 +1,427 @@
+#ifndef SLIDE_DETAILS_EXTERNAL_ASTAR_HPP_
+#define SLIDE_DETAILS_EXTERNAL_ASTAR_HPP_
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <queue>
+
+#include <unistd.h>
+
+#include <boost/assert.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include "../ExternalAstar.hpp"
+
+namespace slide
+{
+
+template<int H, int W>
+ExternalAstar<H, W>::ExternalAstar(const Solver& solver, int maxSelectionLimit, std::size_t memoryBudget, std::string directory)
+    : solver(solver), maxSelectionLimit(maxSelectionLimit), memoryBudget(memoryBudget), directory(std::move(directory)),
+      height(0), width(0), recordSize(0), fileCount(0)
+{
+    boost::filesystem::create_directories(this->directory);
+}
+
+template<int H, int W>
+std::string ExternalAstar<H, W>::newPath(const Side& side, const char* kind)
+{
+    return (boost::format("%s/hitode_%d_%d_%s_%d.bin") % directory % getpid() % side.id % kind % fileCount++).str();
+}
+
+template<int H, int W>
+void ExternalAstar<H, W>::encode(const HitodeBoard<H, W>& board, char* record) const
+{
+    Header header = Header();
+    header.hash = board.hash;
+    header.parent = board.parentHash;
+    header.cost = board.cost;
+    header.preMove = board.preMove;
+    header.selectionLimit = board.selectionLimit;
+    header.selected = board.isSelected() ? board.selected.toInt() : 0xff;
+
+    std::memcpy(record, &header, sizeof(header));
+    rep(i, height) rep(j, width){
+        record[sizeof(Header) + i * width + j] = board(i, j);
+    }
+}
+
+template<int H, int W>
+HitodeBoard<H, W> ExternalAstar<H, W>::decode(const Side& side, const char* record) const
+{
+    const Header& header = *reinterpret_cast<const Header*>(record);
+
+    PlayBoard<H, W> board(height, width);
+    rep(i, height) rep(j, width){
+        board(i, j) = record[sizeof(Header) + i * width + j];
+    }
+    if(header.selected != 0xff){
+        board.select(Point(header.selected));
+    }
+
+    // 特徴量は作り直し，経路に依存する値だけを戻す
+    HitodeBoard<H, W> ret(board, header.selectionLimit, side.table);
+    ret.cost = header.cost;
+    ret.lowerBound = ret.computeLowerBound();
+    ret.parentHash = header.parent;
+    ret.preMove = header.preMove;
+    BOOST_ASSERT(ret.hash == header.hash);
+
+    return ret;
+}
+
+template<int H, int W>
+void ExternalAstar<H, W>::push(Side& side, const HitodeBoard<H, W>& board)
+{
+    std::unique_ptr<util::SpillFile>& layer = side.open[board.lowerBound];
+    if(layer == nullptr){
+        layer.reset(new util::SpillFile(newPath(side, "open"), recordSize));
+    }
+
+    std::vector<char> record(recordSize);
+    encode(board, record.data());
+    layer->append(record.data());
+}
+
+template<int H, int W>
+ull ExternalAstar<H, W>::expandLayer(Side& side, int f)
+{
+    std::unique_ptr<util::SpillFile> layer = std::move(side.open[f]);
+    side.open.erase(f);
+
+    // 1 度に並べる節点の数 (並べ替え用の添字の分も見込む)
+    const std::size_t chunk = std::max<std::size_t>(1, memoryBudget / (recordSize + 2 * sizeof(void*)));
+
+    // 層をメモリに収まる大きさずつ並べて書き出す (探索済みの状態はここでは読まない)
+    std::vector<std::unique_ptr<util::Run>> runs;
+    layer->forEachChunk(chunk, [this, &side, &runs](const char* records, std::size_t count){
+        if(!solver.isTimeUp()){
+            runs.push_back(sortChunk(side, records, count));
+        }
+    });
+    layer.reset();
+
+    if(solver.isTimeUp()){
+        return 0ull;
+    }
+
+    const ull met = mergeLayer(side, runs);
+
+    if(side.closed.size() > MAX_RUNS){
+        compact(side);
+    }
+
+    return met;
+}
+
+template<int H, int W>
+std::unique_ptr<util::Run> ExternalAstar<H, W>::sortChunk(const Side& side, const char* records, std::size_t count)
+{
+    // ハッシュ値の昇順 (同じなら選択回数を多く残している順) に並べ，同じ状態は 1 つにする
+    std::vector<const Header*> nodes(count);
+    rep(i, count){
+        nodes[i] = reinterpret_cast<const Header*>(records + i * recordSize);
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const Header* a, const Header* b){
+        return a->hash != b->hash ? a->hash < b->hash : a->selectionLimit > b->selectionLimit;
+    });
+    nodes.erase(std::unique(nodes.begin(), nodes.end(), [](const Header* a, const Header* b){
+        return a->hash == b->hash;
+    }), nodes.end());
+
+    // レコードをそのままペイロードにする
+    std::unique_ptr<util::Run> run(new util::Run(newPath(side, "sorted"), recordSize));
+    util::RunWriter writer(*run);
+    for(const Header* node : nodes){
+        writer.write(node->hash, node);
+    }
+    writer.close();
+
+    return run;
+}
+
+template<int H, int W>
+ull ExternalAstar<H, W>::mergeLayer(Side& side, const std::vector<std::unique_ptr<util::Run>>& runs)
+{
+    // 層の Run 毎の先頭
+    const std::size_t n = runs.size();
+    std::vector<std::unique_ptr<util::RunReader>> readers;
+    std::vector<ull> keys(n);
+    std::vector<std::vector<char>> heads(n, std::vector<char>(recordSize));
+
+    using Item = std::pair<ull, std::size_t>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> Q;
+    rep(i, n){
+        readers.emplace_back(new util::RunReader(*runs[i]));
+        if(readers[i]->next(keys[i], heads[i].data())){
+            Q.emplace(keys[i], i);
+        }
+    }
+
+    // 自分と相手の探索済みの状態は，層の併合と一緒に先頭から 1 度だけ読む
+    // (この層で書き出す Run は，読み始めてから足す)
+    std::vector<std::unique_ptr<ClosedCursor>> closedCursors, otherCursors;
+    for(const std::unique_ptr<util::Run>& run : side.closed){
+        closedCursors.emplace_back(new ClosedCursor(*run));
+    }
+    for(const std::unique_ptr<util::Run>& run : sides[1 - side.id].closed){
+        otherCursors.emplace_back(new ClosedCursor(*run));
+    }
+
+    side.closed.emplace_back(new util::Run(newPath(side, "closed"), sizeof(Closed)));
+    util::RunWriter writer(*side.closed.back());
+
+    std::vector<char> best(recordSize);
+    std::size_t merged = 0;
+    ull met = 0ull;
+
+    while(!Q.empty()){
+        if(++merged % TIME_CHECK_INTERVAL == 0 && solver.isTimeUp()){
+            break;
+        }
+
+        // 同じ状態は，選択回数を最も残しているもの (同じなら先の Run のもの) だけを残す
+        // (同じキーは Run の番号順に出てくる)
+        const ull key = Q.top().first;
+        const Header& node = *reinterpret_cast<const Header*>(best.data());
+        best = heads[Q.top().second];
+
+        while(!Q.empty() && Q.top().first == key){
+            const std::size_t i = Q.top().second;
+            Q.pop();
+
+            if(reinterpret_cast<const Header*>(heads[i].data())->selectionLimit > node.selectionLimit){
+                best = heads[i];
+            }
+            if(readers[i]->next(keys[i], heads[i].data())){
+                Q.emplace(keys[i], i);
+            }
+        }
+
+        // 探索済みの状態と突き合わせる (同じ状態を同じか多い選択回数で訪れていれば捨てる)
+        bool visited = false;
+        for(const std::unique_ptr<ClosedCursor>& cursor : closedCursors){
+            const Closed* state = cursor->seek(key);
+            if(state != nullptr && state->selectionLimit >= node.selectionLimit){
+                visited = true;
+                break;
+            }
+        }
+        if(visited){
+            continue;
+        }
+
+        Closed closed = Closed();
+        closed.parent = node.parent;
+        closed.preMove = node.preMove;
+        closed.selectionLimit = node.selectionLimit;
+        writer.write(key, &closed);
+
+        // 相手側の探索済みの状態と突き合わせる
+        for(const std::unique_ptr<ClosedCursor>& cursor : otherCursors){
+            const Closed* other = cursor->seek(key);
+            if(other != nullptr && node.selectionLimit + other->selectionLimit + 1 >= maxSelectionLimit){
+                met = key;
+                break;
+            }
+        }
+        if(met != 0ull){
+            break;
+        }
+
+        expand(side, decode(side, best.data()));
+    }
+
+    // 出会った状態も解答を作るときに辿るので，書き出してから返す
+    writer.close();
+    if(side.closed.back()->size() == 0){
+        side.closed.pop_back();
+    }
+
+    return met;
+}
+
+template<int H, int W>
+void ExternalAstar<H, W>::expand(Side& side, const HitodeBoard<H, W>& board)
+{
+    // move
+    rep(k, 4){
+        const Direction dir = Direction(k);
+        if(!board.isValidMove(dir) || (!board.preMove.isSelection && board.preMove.getDirection() == dir.opposite())){
+            continue;
+        }
+
+        HitodeBoard<H, W> next = board;
+        next.move(dir);
+        if(!next.isPrunnable()){
+            push(side, next);
+        }
+    }
+
+    // select
+    if(board.selectionLimit >= 1 && !board.preMove.isSelection){
+        rep(i, board.height()) rep(j, board.width()){
+            if(board.selected == Point(i, j)){
+                continue;
+            }
+
+            HitodeBoard<H, W> next = board;
+            next.select(i, j);
+            if(!next.isPrunnable()){
+                push(side, next);
+            }
+        }
+    }
+}
+
+template<int H, int W>
+void ExternalAstar<H, W>::compact(Side& side)
+{
+    // 全ての Run を併合し，状態毎に選択回数を最も残しているものだけを残す
+    std::unique_ptr<util::Run> merged(new util::Run(newPath(side, "closed"), sizeof(Closed)));
+    {
+        util::RunWriter writer(*merged);
+
+        const std::size_t n = side.closed.size();
+        std::vector<std::unique_ptr<util::RunReader>> readers;
+        std::vector<ull> keys(n);
+        std::vector<Closed> heads(n);
+
+        using Item = std::pair<ull, std::size_t>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> Q;
+        rep(i, n){
+            readers.emplace_back(new util::RunReader(*side.closed[i]));
+            if(readers[i]->next(keys[i], &heads[i])){
+                Q.emplace(keys[i], i);
+            }
+        }
+
+        while(!Q.empty()){
+            const ull key = Q.top().first;
+            Closed best = heads[Q.top().second];
+
+            while(!Q.empty() && Q.top().first == key){
+                const std::size_t i = Q.top().second;
+                Q.pop();
+
+                if(heads[i].selectionLimit > best.selectionLimit){
+                    best = heads[i];
+                }
+                if(readers[i]->next(keys[i], &heads[i])){
+                    Q.emplace(keys[i], i);
+                }
+            }
+
+            writer.write(key, &best);
+        }
+        writer.close();
+    }
+
+    side.closed.clear();
+    side.closed.push_back(std::move(merged));
+}
+
+template<int H, int W>
+boost::optional<typename ExternalAstar<H, W>::Closed> ExternalAstar<H, W>::findClosed(const Side& side, ull hash) const
+{
+    boost::optional<Closed> ret;
+    for(const std::unique_ptr<util::Run>& run : side.closed){
+        for(const std::vector<char>& payload : run->find(hash)){
+            Closed closed;
+            std::memcpy(&closed, payload.data(), sizeof(closed));
+            if(!ret || ret->selectionLimit < closed.selectionLimit){
+                ret = closed;
+            }
+        }
+    }
+    return ret;
+}
+
+template<int H, int W>
+Answer ExternalAstar<H, W>::buildAnswer(const Side& side, ull hash) const
+{
+    Answer answer;
+
+    while(hash){
+        const boost::optional<Closed> closed = findClosed(side, hash);
+        BOOST_ASSERT(closed);
+        answer.emplace_back(closed->preMove);
+        hash = closed->parent;
+    }
+
+    answer.pop_back();
+    std::reverse(answer.begin(), answer.end());
+
+    return answer;
+}
+
+template<int H, int W>
+boost::optional<std::pair<Answer, Answer>> ExternalAstar<H, W>::search(const HitodeBoard<H, W>& start1, const HitodeBoard<H, W>& start2)
+{
+    height = start1.height();
+    width = start1.width();
+
+    // 層のファイルの中でも Header の境界を揃える
+    recordSize = (sizeof(Header) + height * width + alignof(Header) - 1) / alignof(Header) * alignof(Header);
+
+    sides[0].id = 0;
+    sides[1].id = 1;
+    sides[0].table = start1.table;
+    sides[1].table = start2.table;
+    push(sides[0], start1);
+    push(sides[1], start2);
+
+    int max = 0;
+    while(!solver.isTimeUp()){
+        // 下界の小さい方の層を進める (同じなら探索済みの少ない方)
+        int d = -1;
+        rep(i, 2){
+            if(sides[i].open.empty()){
+                continue;
+            }
+            if(d == -1 || sides[i].open.begin()->first < sides[d].open.begin()->first){
+                d = i;
+            }
+        }
+        if(d == -1){
+            break;
+        }
+        if(!sides[1 - d].open.empty() && sides[1 - d].open.begin()->first == sides[d].open.begin()->first){
+            std::size_t size[2] = {0, 0};
+            rep(i, 2) for(const std::unique_ptr<util::Run>& run : sides[i].closed){
+                size[i] += run->size();
+            }
+            d = size[0] <= size[1] ? 0 : 1;
+        }
+
+        const int f = sides[d].open.begin()->first;
+        if(max < f){
+            max = f;
+            std::cerr << f << ", ";
+        }
+
+        const ull met = expandLayer(sides[d], f);
+        if(met != 0ull){
+            return std::make_pair(buildAnswer(sides[0], met), buildAnswer(sides[1], met));
+        }
+    }
+
+    return boost::none;
+}
+
+template<int H, int W>
+ull ExternalAstar<H, W>::visitedNode() const
+{
+    ull ret = 0;
+    rep(i, 2) for(const std::unique_ptr<util::Run>& run : sides[i].closed){
+        ret += run->size();
+    }
+    return ret;
+}
+
+} // end of namespace slide
+
+#endif
@@ -8,7 +8,9 @@
 #include <utility>
 
 #include "../FixBoard.hpp"
+#include "../FixDistanceCache.hpp"
 #include "../ManhattanFeature.hpp"
+#include "../Wavefront.hpp"
 #include "util/color.hpp"
 #include "util/StopWatch.hpp"
 
@@ -23,47 +25,16 @@ inline bool FixBoard<Base>::searchMove(Point src, Point dst, char pre[arrayH][ar
     BOOST_ASSERT(!fixed(dst));
     BOOST_ASSERT(!fixed(src));
 
-    rep(i, height()) rep(j, width()){
-        pre[i][j] = -1; // not reached yet
-    }
-
-    // heuristic function
-    /*
-    auto heuristic = [](Point a, Point b){
-        return (a-b).l1norm();
-    };
-    */
-
-    bool found = false;
-    std::queue<Point> Q;
-    Q.push(src);
-    pre[src.y][src.x] = -2; // the start point
-
-    // BFS
-    while(!Q.empty()){
-        const Point p = Q.front();
-        Q.pop();
-
-        if(p == dst){
-            found = true;
-            break;
-        }
-
-        rep(k, 4){
-            const Direction dir(k);
-            const Point n = p + Point::delta(dir);
-            if(!n.isIn(height(), width()) || fixed(n) || pre[n.y][n.x] != -1){
-                continue;
-            }
-
-            pre[n.y][n.x] = k;
-            Q.push(n);
-        }
+    Wavefront<H, W> wave;
+    if(wave.search(fixed, src, dst) == -1){
+        return false;
     }
 
-    return found;
+    wave.tracePath(dst, pre);
+    return true;
 }
 
+// 同じ層のセルからも値を更新する (最短でない経路も選ぶ) ので結果がキューの順序で決まる．Wavefront にはしない．
 template<typename Base>
 inline bool FixBoard<Base>::searchMoveOptimally(Point src, Point dst, char pre[arrayH][arrayW]) const
 {
@@ -153,7 +124,7 @@ inline bool FixBoard<Base>::moveTo(Point dst)
                 moveDown();
                 return true;
             }
-            if(y<Base::H-1 && !fixed(y+1, selected.x) && !fixed(y+1, mid.x) && !fixed(y+1, dst.x)){
+            if(y<height()-1 && !fixed(y+1, selected.x) && !fixed(y+1, mid.x) && !fixed(y+1, dst.x)){
                 moveDown();
                 moveHorizontally(dst.x);
                 moveUp();
@@ -173,7 +144,7 @@ inline bool FixBoard<Base>::moveTo(Point dst)
                 moveRight();
                 return true;
             }
-            if(x<Base::W-1 && !fixed(selected.y, x+1) && !fixed(mid.y, x+1) && !fixed(dst.y, x+1)){
+            if(x<width()-1 && !fixed(selected.y, x+1) && !fixed(mid.y, x+1) && !fixed(dst.y, x+1)){
                 moveRight();
                 moveVertically(dst.y);
                 moveLeft();
@@ -946,20 +917,8 @@ inline int FixBoard<Base>::countMoveToBySearch(Point src, Point dst) const
     BOOST_ASSERT(!fixed(dst));
     BOOST_ASSERT(!fixed(src));
 
-    // 探索
-    char pre[arrayH][arrayW];
-    if(!searchMove(src, dst, pre)){
-        return -1;
-    }
-
-    // 数える
-    int ret = 0;
-    for(; dst != src; ++ret){
-        const Direction dir = Direction(pre[dst.y][dst.x]);
-        dst -= Point::delta(dir);
-    }
-
-    return ret;
+    // 同じ fixed の盤面と始点の BFS は表を使い回す
+    return FixDistanceCache<H, W>::count(fixed, src, dst);
 }
 
 /*
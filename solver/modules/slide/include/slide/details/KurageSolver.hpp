@@ -1,12 +1,17 @@
 #ifndef SLIDE_DETAILS_KURAGE_SOLVER_HPP_
 #define SLIDE_DETAILS_KURAGE_SOLVER_HPP_
 
+#include <algorithm>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
-#include <tbb/parallel_sort.h>
 #include <tbb/task_scheduler_init.h>
 
+#include "../KurageCandidates.hpp"
 #include "../KurageSolver.hpp"
-#include "util/dense_hash_set.hpp"
+#include "util/ConcurrentHashTable.hpp"
+#include "util/parallel_select.hpp"
 #include "util/SpinMutex.hpp"
 #include "util/ThreadIndexManager.hpp"
 
@@ -55,59 +60,61 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
         numThreads = tbb::task_scheduler_init::default_num_threads();
     }
     tbb::task_scheduler_init init(numThreads);
-    util::ThreadIndexManager::clear();
-
-    // テーブルの初期化
-    if(KurageHashFeature<H, W>::table == nullptr){
-        KurageHashFeature<H, W>::table.reset(new ZobristTable<H, W>(start.height(), start.width()));
-    }
 
-    const KurageBoard<H, W> kurage(start, selectionLimit);
+    // ハッシュのテーブルと解答木は探索毎に作り，探索が終われば捨てる
+    const ZobristTable<H, W> table(start.height(), start.width());
+    AnswerLinearTree tree;
+    const KurageBoard<H, W> kurage(start, selectionLimit, tree, &table);
 
     // 初めから終わってた場合
     if(kurage.isFinished()){
-        onCreatedAnswer({});
+        publishAnswer({});
         return true;
     }
 
     const int nLayer = start.isSelected() ? selectionLimit + 1 : selectionLimit;
 
-    // boards と nextBoards の初期化
-    using BoardsArray = std::vector<std::vector<std::vector<KurageBoard<H, W>>>>;
-    BoardsArray boards(numThreads);
-    BoardsArray nextBoards(numThreads);
-    rep(i, numThreads){
-        boards[i].resize(nLayer);
-        nextBoards[i].resize(nLayer);
-
-        rep(j, nLayer){
-            boards[i][j].reserve(totalBeamWidth * 4 / (numThreads * nLayer));
-            nextBoards[i][j].reserve(totalBeamWidth * 4 / (numThreads * nLayer));
-        }
+    BOOST_ASSERT(nLayer <= KurageCandidates::MAX_LAYER);
+
+    // boards は各レイヤの実体化された盤面，candidates はそこから生成された子 (スレッド番号毎)
+    // 他のソルバと同時に動いているとスレッド番号は numThreads 以上にもなりうるので，番号の上限分を用意しておく
+    std::vector<std::vector<KurageBoard<H, W>>> boards(nLayer);
+    std::vector<std::vector<KurageCandidates>> candidates(util::ThreadIndexManager::MAX_THREADS, std::vector<KurageCandidates>(nLayer));
+    std::vector<KurageBoard<H, W>> materialized;
+    std::vector<bool> expanded(nLayer, false);
+    rep(j, nLayer){
+        boards[j].reserve(totalBeamWidth / nLayer);
     }
 
+    // ハッシュ値が登場した，最も多い残選択回数
+    // ビームに残った盤面だけを登録し，子の生成時には各スレッドから参照だけする
+    // 小さい盤面では状態数も少ないので，テーブルを小さくして初期化の時間を省く (足りなければ段を足して広げる)
+    const std::size_t area = start.height() * start.width();
+    util::GrowableConcurrentHashTable& visited = util::GrowableConcurrentHashTable::local(std::min(visitedCapacity, area * area * totalBeamWidth));
+
     // 最初の選択
     if(kurage.isSelected()){
         // already selected
-        boards[0][nLayer - 1].push_back(kurage);
+        boards[nLayer - 1].push_back(kurage);
+        visited.updateMax(kurage.hash(), nLayer - 1);
     }
     else{
         // the first select
         rep(i, kurage.height()) rep(j, kurage.width()){
-            boards[0][nLayer - 1].emplace_back(kurage);
-            boards[0][nLayer - 1][boards[0][nLayer-1].size()-1].select(Point(i, j), nLayer-1);
+            boards[nLayer - 1].emplace_back(kurage);
+            boards[nLayer - 1].back().select(Point(i, j), nLayer-1);
+            visited.updateMax(boards[nLayer - 1].back().hash(), nLayer - 1);
         }
     }
 
     const int firstManhattan = kurage.manhattan;
     double remainRatio = 1.0;
 
-    // ハッシュ値が登場した，最も多い残選択回数
-    util::dense_hash_map<ull, int> visited(0ull);
-
     // 現在見つかった，最も良い解（から1回分の交換コストを引いたもの）
     int bestScore = 1 << 29;
     AnswerTreeFeature bestAnswer;
+    Move bestLastMove;
+    int publishedScore = 1 << 29;
 
     // マンハッタン距離の減少量
     std::vector<int> preManhattan(nLayer, 1 << 29);
@@ -115,10 +122,10 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
     std::vector<int> beamWidth(nLayer);
 
     // インデックス
-    std::vector<std::pair<float, int>> indices;
+    std::vector<std::pair<float, uint>> indices;
     indices.reserve(totalBeamWidth * 4);
     int indices_shift;
-    for(indices_shift = 0; (1 << indices_shift) < numThreads; ++indices_shift);
+    for(indices_shift = 0; (1 << indices_shift) < util::ThreadIndexManager::MAX_THREADS; ++indices_shift);
 
     // 用いるレイヤ番号の最小値と最大値
     int minLayer = 0;
@@ -129,6 +136,11 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
     for(int r=0;; ++r){
         int allMinManhattan = 1 << 29;
 
+        // 締め切りを過ぎたら，それまでの最良解で終える
+        if(isTimeUp()){
+            break;
+        }
+
         verbose && std::cerr << r << ": ";
 
         // レイヤ番号の最小値・最大値を更新
@@ -154,60 +166,113 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
             determineBeamWidth(remainRatio, start.height(), start.width(), reliability, beamWidth, preMinLayer, minLayer, maxLayer);
         }
 
-        for(int layer=maxLayer; layer>=minLayer; --layer){
+        // 前回生成した子のうち，ビームに残るものだけを実体化する
+        // candidates[*][layer] は boards[layer] と boards[layer+1] を参照するので，小さいレイヤから順に置き換える
+        util::StopWatch::start("materialize");
 
-            {
-                int sum = 0;
-                rep(i, numThreads){
-                    sum += boards[i][layer].size();
+        rep(layer, nLayer){
+            std::size_t total = 0;
+            rep(i, util::ThreadIndexManager::size()){
+                total += candidates[i][layer].size();
+            }
+            if(!expanded[layer] && total == 0){
+                continue;
+            }
+            expanded[layer] = false;
+
+            if(layer > maxLayer){
+                boards[layer].clear();
+                rep(i, util::ThreadIndexManager::size()){
+                    candidates[i][layer].clear();
                 }
-                if(sum == 0){
-                    rep(i, numThreads){
-                        boards[i][layer].swap(nextBoards[i][layer]);
-                    }
-                    continue;
+                continue;
+            }
+
+            indices.clear();
+            rep(i, util::ThreadIndexManager::size()){
+                rep(j, candidates[i][layer].size()){
+                    indices.push_back({candidates[i][layer].score[j], (uint(j)<<uint(indices_shift)) | uint(i)});
+                }
+            }
+
+            util::parallel_select(indices, beamWidth[layer]);
+
+            materialized.resize(indices.size());
+            tbb::parallel_for(tbb::blocked_range<std::size_t>(0, indices.size()),
+                [&boards, &candidates, &indices, &materialized, layer, indices_shift]
+            (const tbb::blocked_range<std::size_t>& range){
+                const int thread = util::ThreadIndexManager::getLocalId();
+                for(std::size_t k = range.begin(); k != range.end(); ++k){
+                    const uint id = indices[k].second;
+                    const KurageCandidates& cand = candidates[id & ((1<<indices_shift)-1)][layer];
+                    const uint j = id >> indices_shift;
+                    const uint parent = cand.parent[j];
+
+                    materialized[k] = boards[KurageCandidates::parentLayer(parent)][KurageCandidates::parentIndex(parent)];
+                    materialized[k].apply(cand.move[j], cand.score[j], thread);
+                }
+            });
+
+            boards[layer].swap(materialized);
+            rep(i, util::ThreadIndexManager::size()){
+                candidates[i][layer].clear();
+            }
+        }
+
+        util::StopWatch::stop_last();
+
+        // ビームから外れた盤面の解答木を捨てる
+        // 節点は生き残った盤面の分しか増えないが，祖先が途絶えた経路は溜まっていくので定期的に詰める
+        if(reclaimInterval > 0 ? (r + 1) % reclaimInterval == 0 : tree.needsReclaim()){
+            util::StopWatch::start("reclaim");
+            std::vector<AnswerTreeFeature*> roots;
+            for(std::vector<KurageBoard<H, W>>& layerBoards : boards){
+                for(KurageBoard<H, W>& board : layerBoards){
+                    roots.push_back(&board);
                 }
             }
+            if(bestScore != 1 << 29){
+                roots.push_back(&bestAnswer);
+            }
+            tree.reclaim(roots);
+            util::StopWatch::stop_last();
+        }
+
+        for(int layer=maxLayer; layer>=minLayer; --layer){
+
+            if(boards[layer].empty()){
+                continue;
+            }
             preMinLayer = layer;
+            expanded[layer] = true;
 
             // board 達をソート
             util::StopWatch::start("sorting");
 
             indices.clear();
-            rep(i, numThreads){
-                rep(j, boards[i][layer].size()){
-                    indices.push_back({boards[i][layer][j].score, (uint(j)<<uint(indices_shift)) | uint(i)});
-                }
+            rep(j, boards[layer].size()){
+                indices.push_back({boards[layer][j].score, uint(j)});
             }
 
-            if(indices.size() > beamWidth[layer]){
-                tbb::parallel_sort(indices.begin(), indices.end());
-                indices.erase(indices.begin() + beamWidth[layer], indices.end());
-            }
+            util::parallel_select(indices, beamWidth[layer]);
 
             util::StopWatch::stop_last();
 
             // visited フラグを追加
             util::StopWatch::start("visited");
-
-            for(const std::pair<float, uint>& id : indices){
-                const ull hash = boards[id.second & ((1<<indices_shift)-1)][layer][id.second >> indices_shift].hash();
-                util::dense_hash_map<ull, int>::iterator itr = visited.find(hash);
-                if(itr != visited.end()){
-                    itr->second = std::max(itr->second, layer);
+            tbb::parallel_for(tbb::blocked_range<std::size_t>(0, indices.size()),
+                [&boards, &indices, &visited, layer](const tbb::blocked_range<std::size_t>& range){
+                for(std::size_t k = range.begin(); k != range.end(); ++k){
+                    visited.updateMax(boards[layer][indices[k].second].hash(), layer);
                 }
-                else{
-                    visited.insert({hash, layer});
-                }
-            }
-
+            });
             util::StopWatch::stop_last();
 
             // 統計情報を計算
             int minManhattan = 1 << 29;
             int preSelectedNum = 0;
             for(const std::pair<float, uint>& id : indices){
-                const KurageBoard<H, W>&board = boards[id.second & ((1<<indices_shift)-1)][layer][id.second >> indices_shift];
+                const KurageBoard<H, W>& board = boards[layer][id.second];
                 minManhattan = std::min(minManhattan, int(board.manhattan));
                 preSelectedNum += board.preMove.isSelection;
             }
@@ -217,13 +282,15 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
             util::SpinMutex scoreMutex;
 
             // ！並列！
+            // 子は評価だけして candidates に積み，次のステップで生き残ったものだけを実体化する
             tbb::parallel_for_each(indices.begin(), indices.end(), [
                 this,
-                &boards, nLayer, layer, r, minLayer, &visited, &indices, indices_shift, // read-only
-                &nextBoards, &bestScore, &scoreMutex, &bestAnswer                       // read and write
+                &boards, nLayer, layer, r, minLayer, &visited,                                        // read-only
+                &candidates, &bestScore, &scoreMutex, &bestAnswer, &bestLastMove                     // read and write
             ]
             (std::pair<float, uint> id){
-                const KurageBoard<H, W>& board = boards[id.second & ((1<<indices_shift)-1)][layer][id.second >> indices_shift];
+                const KurageBoard<H, W>& board = boards[layer][id.second];
+                const uint parent = KurageCandidates::packParent(id.second, layer);
                 const int thread = util::ThreadIndexManager::getLocalId();
 
                 // move
@@ -233,9 +300,7 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
                         continue;
                     }
 
-                    nextBoards[thread][layer].push_back(board);
-                    KurageBoard<H, W>& next = nextBoards[thread][layer][nextBoards[thread][layer].size() - 1];
-                    next.move(dir, layer);
+                    const typename KurageBoard<H, W>::Child next = board.peekMove(dir, layer, thread);
 
                     // check whether the finished or not
                     if(next.isFinished()){
@@ -243,13 +308,14 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
                         std::lock_guard<util::SpinMutex> lock(scoreMutex);
                         if(score < bestScore){
                             bestScore = score;
-                            bestAnswer = next;
+                            bestAnswer = board;
+                            bestLastMove = Move(dir);
                         }
                     }
 
-                    const util::dense_hash_map<ull, int>::const_iterator itr = visited.find(next.hash());
-                    if(itr != visited.end() && itr->second >= layer){
-                        nextBoards[thread][layer].pop_back();
+                    // テーブルが混んでいれば重複を見逃すだけなので，候補に入れる
+                    if(visited.find(next.hash) < layer){
+                        candidates[thread][layer].push_back(next.score, parent, Move(dir));
                     }
                 }
 
@@ -257,23 +323,16 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
                 if(layer > minLayer && !board.preMove.isSelection){
                     const int maxNeighbor = board.area() <= 36 || layer == minLayer + 1 ? 1 : 0;
                     if((board.selected - Point(board(board.selected))).l1norm() <= maxNeighbor){
-                        rep(i, board.height()) rep(j, board.width()){
+                        const int height = board.height(), width = board.width();
+                        rep(i, height) rep(j, width){
                             if(board.selected == Point(i, j) || board.isAligned(i, j)){
                                 continue;
                             }
 
-                            nextBoards[thread][layer-1].push_back(board);
-                            KurageBoard<H, W>& next = nextBoards[thread][layer-1][nextBoards[thread][layer-1].size() - 1];
-                            next.select(Point(i, j), layer);
+                            const typename KurageBoard<H, W>::Child next = board.peekSelect(Point(i, j), layer, thread);
 
-                            if(next.isPrunnable(layer-1)){
-                                nextBoards[thread][layer-1].pop_back();
-                            }
-                            else{
-                                const util::dense_hash_map<ull, int>::const_iterator itr = visited.find(next.hash());
-                                if(itr != visited.end() && itr->second >= layer-1){
-                                    nextBoards[thread][layer-1].pop_back();
-                                }
+                            if(!next.isPrunnable(layer-1) && visited.find(next.hash) < layer-1){
+                                candidates[thread][layer-1].push_back(next.score, parent, Move(Point(i, j)));
                             }
                         }
                     }
@@ -281,12 +340,6 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
             });
             util::StopWatch::stop_last();
 
-            // swap and clear
-            rep(i, numThreads){
-                boards[i][layer].clear();
-                boards[i][layer].swap(nextBoards[i][layer]);
-            }
-
             // update reliability
             reliability[layer] += preManhattan[layer] <= minManhattan ? -2 : 1;
             preManhattan[layer] = minManhattan;
@@ -304,6 +357,14 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
             allMinManhattan = std::min(allMinManhattan, minManhattan);
         }
 
+        // 改善した解答はすぐに渡す
+        if(bestScore < publishedScore){
+            Answer answer = bestAnswer.buildAnswer();
+            answer.push_back(bestLastMove);
+            publishAnswer(answer);
+            publishedScore = bestScore;
+        }
+
         if(reliability[preMinLayer] < -5 * (kurage.height() + kurage.width())){
             break;
         }
@@ -313,7 +374,11 @@ bool KurageSolver::beamSearch(const PlayBoard<H, W>& start, int selectionLimit)
     }
 
     if(bestScore != 1 << 29){
-        onCreatedAnswer(bestAnswer.buildAnswer());
+        if(bestScore < publishedScore){
+            Answer answer = bestAnswer.buildAnswer();
+            answer.push_back(bestLastMove);
+            publishAnswer(answer);
+        }
         return true;
     }
 
@@ -324,19 +389,12 @@ template<int H, int W>
 inline void KurageSolver::solve(const PlayBoard<H, W>& board, int selectionLimit)
 {
     visitedNode = 0;
-    while(!beamSearch(board, selectionLimit) && retry){
+    while(!beamSearch(board, selectionLimit) && retry && !isTimeUp()){
         std::cerr << '!';
-        AnswerLinearTree::nodes.clear();
     }
     verbose && std::cerr << "visited " << visitedNode << " nodes!" << std::endl;
 }
 
-template<>
-inline void KurageSolver::solve<Flexible, Flexible>(const PlayBoard<Flexible>& board, int selectionLimit)
-{
-    branch(make_solve_caller(*this), board, selectionLimit);
-}
-
 } // end of namespace slide
 
 #endif
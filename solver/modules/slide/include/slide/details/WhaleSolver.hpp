@@ -3,13 +3,15 @@
 
 #include <utility>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
-#include <tbb/parallel_sort.h>
 #include <tbb/task_scheduler_init.h>
 
 #include "../ParityFeature.hpp"
 #include "../WhaleSolver.hpp"
-#include "util/dense_hash_set.hpp"
+#include "util/ConcurrentHashTable.hpp"
+#include "util/parallel_select.hpp"
 #include "util/SpinMutex.hpp"
 #include "util/ThreadIndexManager.hpp"
 
@@ -18,31 +20,33 @@ namespace slide
 
 template<int H, int W>
 std::vector<AnswerTreeBoard<H, W>> WhaleSolver::decreaseManhattan(
-    const PlayBoard<H, W>& start, int selectionLimit, int y, int x, int h, int w
+    const PlayBoard<H, W>& start, AnswerLinearTree& tree, int selectionLimit, int y, int x, int h, int w
 ){
     if(numThreads == -1){
         numThreads = tbb::task_scheduler_init::default_num_threads();
     }
 
-    if(KurageHashFeature<H, W>::table == nullptr){
-        KurageHashFeature<H, W>::table.reset(new ZobristTable<H, W>(start.height(), start.width()));
-    }
+    // ハッシュのテーブルは探索毎に作る (返す盤面はハッシュ値を持たないので，ここで捨ててよい)
+    const ZobristTable<H, W> table(start.height(), start.width());
+
+    // 登場したハッシュ値のリスト
+    // ビームに残った盤面だけを登録し，子の生成時には各スレッドから参照だけする (足りなければ段を足して広げる)
+    util::GrowableConcurrentHashTable& visited = util::GrowableConcurrentHashTable::local(visitedCapacity);
 
+    // スレッド番号毎の盤面 (番号は numThreads 以上にもなりうるので，上限分を用意しておく)
     using BoardsArray = std::vector<std::vector<WhaleBoard<H, W>>>;
-    BoardsArray boards(numThreads);
-    BoardsArray nextBoards(numThreads);
-    rep(i, numThreads){
-        nextBoards[i].reserve(totalBeamWidth * 4 / numThreads);
-    }
+    BoardsArray boards(util::ThreadIndexManager::MAX_THREADS);
+    BoardsArray nextBoards(util::ThreadIndexManager::MAX_THREADS);
 
     // 最初の選択
     {
-        const WhaleBoard<H, W> kurage(start);
+        const WhaleBoard<H, W> kurage(start, tree, &table, y, x, h, w);
 
         if(kurage.isSelected()){
             // already selected
             BOOST_ASSERT(Point(start(start.selected)).isIn(y, x, h, w));
             boards[0].push_back(kurage);
+            visited.insert(kurage.hash());
         }
         else{
             // the first select
@@ -57,6 +61,7 @@ std::vector<AnswerTreeBoard<H, W>> WhaleSolver::decreaseManhattan(
                     if(!p){
                         boards[0].emplace_back(kurage);
                         boards[0][boards[0].size()-1].select(Point(i, j));
+                        visited.insert(boards[0][boards[0].size()-1].hash());
                         ++cnt;
                     }
                 }
@@ -67,6 +72,7 @@ std::vector<AnswerTreeBoard<H, W>> WhaleSolver::decreaseManhattan(
                     if(Point(kurage(i, j)).isIn(y+1, x+1, h-2, w-2)){
                         boards[0].emplace_back(kurage);
                         boards[0][boards[0].size()-1].select(Point(i, j));
+                        visited.insert(boards[0][boards[0].size()-1].hash());
                     }
                 }
             }
@@ -78,14 +84,11 @@ std::vector<AnswerTreeBoard<H, W>> WhaleSolver::decreaseManhattan(
     // const int firstManhattan = kurage.manhattan;
     // double remainRatio = 1.0;
 
-    // 登場したハッシュ値のリスト
-    util::dense_hash_set<ull> visited(0ull);
-
     // インデックス
     std::vector<std::pair<float, uint>> indices;
     indices.reserve(totalBeamWidth * 4);
     int indices_shift;
-    for(indices_shift = 0; (1 << indices_shift) < numThreads; ++indices_shift);
+    for(indices_shift = 0; (1 << indices_shift) < util::ThreadIndexManager::MAX_THREADS; ++indices_shift);
 
     bool finished = false;
     int reliability = 10;
@@ -98,24 +101,24 @@ std::vector<AnswerTreeBoard<H, W>> WhaleSolver::decreaseManhattan(
         util::StopWatch::start("sorting");
         
         indices.clear();
-        rep(i, numThreads){
+        rep(i, util::ThreadIndexManager::size()){
             rep(j, boards[i].size()){
                 indices.push_back({boards[i][j].score, (uint(j)<<uint(indices_shift)) | uint(i)});
             }
         }
 
-        if(indices.size() > totalBeamWidth){
-            tbb::parallel_sort(indices.begin(), indices.end());
-            indices.erase(indices.begin() + totalBeamWidth, indices.end());
-        }
+        util::parallel_select(indices, totalBeamWidth);
         util::StopWatch::stop("sorting");
 
         // visited フラグを追加
         util::StopWatch::start("visited");
-        for(const std::pair<float, uint>& id : indices){
-            const ull hash = boards[id.second & ((1<<indices_shift)-1)][id.second >> indices_shift].hash();
-            visited.insert(hash);
-        }
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, indices.size()),
+            [&boards, &indices, &visited, indices_shift](const tbb::blocked_range<std::size_t>& range){
+            for(std::size_t k = range.begin(); k != range.end(); ++k){
+                const uint id = indices[k].second;
+                visited.insert(boards[id & ((1<<indices_shift)-1)][id >> indices_shift].hash());
+            }
+        });
         util::StopWatch::stop("visited");
 
         // 統計情報を計算
@@ -129,16 +132,16 @@ std::vector<AnswerTreeBoard<H, W>> WhaleSolver::decreaseManhattan(
         reliability = std::min(10, reliability);
         preMinManhattan = minManhattan;
 
-        if(reliability <= 0){
+        // 改善しなくなったか締め切りを過ぎたら，今のビームを返す
+        if(reliability <= 0 || isTimeUp()){
             std::vector<AnswerTreeBoard<H, W>> ret;
             ret.reserve(indices.size());
             for(const std::pair<float, uint>& id : indices){
                 const WhaleBoard<H, W>& preboard = boards[id.second & ((1<<indices_shift)-1)][id.second >> indices_shift];
-                AnswerTreeBoard<H, W> board(preboard);
+                AnswerTreeBoard<H, W> board(preboard, *preboard.tree);
                 board.selected = preboard.selected;
                 board.swappingCount = r;
-                board.index = preboard.index;
-                board.thread = preboard.thread;
+                static_cast<AnswerTreeFeature&>(board) = preboard;
                 ret.push_back(std::move(board));
             }
             std::cout << "minManhattan = " << minManhattan << std::endl;
@@ -153,16 +156,18 @@ std::vector<AnswerTreeBoard<H, W>> WhaleSolver::decreaseManhattan(
 
         tbb::parallel_for_each(indices.begin(), indices.end(), [
             this,
-            &boards, &visited, &indices, indices_shift, // read-only
-            &nextBoards, &scoreMutex, &finished         // read and write
+            &boards, &indices, indices_shift, &visited,       // read-only
+            &nextBoards, &scoreMutex, &finished               // read and write
         ]
         (std::pair<float, uint> id){
             const WhaleBoard<H, W>& board = boards[id.second & ((1<<indices_shift)-1)][id.second >> indices_shift];
             const int thread = util::ThreadIndexManager::getLocalId();
 
             // move
+            // 子は評価だけ先に行い，残すものだけを実体化する
+            typename WhaleBoard<H, W>::Child children[3];
+            Direction dirs[3];
             int added = 0;
-            const int preSize = nextBoards[thread].size();
 
             rep(k, 4){
                 const Direction dir(k);
@@ -170,54 +175,73 @@ std::vector<AnswerTreeBoard<H, W>> WhaleSolver::decreaseManhattan(
                     continue;
                 }
 
-                const int tmpIndex = preSize + added;
-                nextBoards[thread].push_back(board);
-                nextBoards[thread][tmpIndex].move(dir, thread);
+                const typename WhaleBoard<H, W>::Child child = board.peekMove(dir, thread);
 
                 // check whether the finished or not
-                if(nextBoards[thread][tmpIndex].isFinished()){
+                if(child.isFinished()){
                     std::lock_guard<util::SpinMutex> lock(scoreMutex);
                     if(!finished){
-                        Answer answer = nextBoards[thread][tmpIndex].buildAnswer();
+                        WhaleBoard<H, W> next = board;
+                        next.apply(dir, child.score, thread);
+                        Answer answer = next.buildAnswer();
                         answer.optimize();
-                        onCreatedAnswer(std::move(answer));
+                        publishAnswer(answer);
                         finished = true;
                     }
                     return;
                 }
 
-                if(visited.count(nextBoards[thread][tmpIndex].hash())){
-                    nextBoards[thread].pop_back();
-                }
-                else{
+                if(!visited.contains(child.hash)){
+                    children[added] = child;
+                    dirs[added] = dir;
                     ++added;
                 }
             }
 
             // add to next
             if(added == 3){
-                if(nextBoards[thread][preSize].score < nextBoards[thread][preSize+1].score){
-                    if(nextBoards[thread][preSize+1].score > nextBoards[thread][preSize+2].score){
+                if(children[0].score < children[1].score){
+                    if(children[1].score > children[2].score){
                         // remain 0 and 2
-                        nextBoards[thread][preSize+1] = std::move(nextBoards[thread][preSize+2]);
+                        children[1] = children[2];
+                        dirs[1] = dirs[2];
                     }
                 }
-                else if(nextBoards[thread][preSize].score > nextBoards[thread][preSize+2].score){
+                else if(children[0].score > children[2].score){
                     // remain 1 and 2
-                    nextBoards[thread][preSize] = std::move(nextBoards[thread][preSize+2]);
+                    children[0] = children[2];
+                    dirs[0] = dirs[2];
                 }
-                nextBoards[thread].pop_back();
+                --added;
+            }
+
+            rep(k, added){
+                nextBoards[thread].push_back(board);
+                nextBoards[thread].back().apply(dirs[k], children[k].score, thread);
             }
         });
 
         util::StopWatch::stop("parallel");
 
         // swap and clear
-        rep(i, numThreads){
+        rep(i, util::ThreadIndexManager::size()){
             boards[i].clear();
             boards[i].swap(nextBoards[i]);
         }
 
+        // ビームから外れた盤面の解答木を捨てる
+        if(tree.needsReclaim()){
+            util::StopWatch::start("reclaim");
+            std::vector<AnswerTreeFeature*> roots;
+            for(std::vector<WhaleBoard<H, W>>& threadBoards : boards){
+                for(WhaleBoard<H, W>& board : threadBoards){
+                    roots.push_back(&board);
+                }
+            }
+            tree.reclaim(roots);
+            util::StopWatch::stop_last();
+        }
+
         verbose && std::cerr << minManhattan << ' ';
     }
 }
@@ -9,18 +9,19 @@
 namespace slide
 {
 
+// src の [x, x+dst.width())×[y, y+dst.height()) を dst に写す (どちらも大きさを実行時に持っていてよい)
 template<int H, int W, int h, int w>
 inline void extractBoard(const PlayBoardBase<H, W>& src, PlayBoardBase<h, w>& dst, int y, int x)
 {
-    BOOST_ASSERT(y+h <= H && x+w <= W);
+    BOOST_ASSERT(y+dst.height() <= src.height() && x+dst.width() <= src.width());
 
-    rep(i, h) rep(j, w){
+    rep(i, dst.height()) rep(j, dst.width()){
         dst(i, j) = dst.correctId(Point(src(i+y, j+x)) - Point(y, x));
     }
 
     if(src.isSelected()){
         dst.selected = src.selected - Point(y, x);
-        BOOST_ASSERT(dst.selected.isIn(h, w));
+        BOOST_ASSERT(dst.selected.isIn(dst.height(), dst.width()));
     }
     else{
         dst.selected = src.selected;
@@ -1,10 +1,16 @@
-#include <tbb/task_scheduler_init.h>
 #include "AnswerLinearTree.hpp"
 
 namespace slide
 {
 
-std::vector<std::vector<AnswerLinearTreeNode>> AnswerLinearTree::nodes(tbb::task_scheduler_init::default_num_threads());
-util::SpinMutex AnswerLinearTree::mutex;
+constexpr uint AnswerLinearTree::NONE;
+constexpr int  AnswerLinearTree::CHUNK_BITS;
+constexpr uint AnswerLinearTree::CHUNK_SIZE;
+constexpr uint AnswerLinearTree::CHUNK_MASK;
+constexpr int  AnswerLinearTree::BLOCK_BITS;
+constexpr std::size_t AnswerLinearTree::BLOCK_SIZE;
+constexpr std::size_t AnswerLinearTree::BLOCK_MASK;
+constexpr std::size_t AnswerLinearTree::MAX_BLOCKS;
+constexpr std::size_t AnswerLinearTree::MIN_RECLAIM_SIZE;
 
 } // end of namespace slide
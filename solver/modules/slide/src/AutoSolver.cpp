@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+#include "AutoSolver.hpp"
+#include "util/Random.hpp"
+
+namespace slide
+{
+
+bool AutoSolver::verbose = false;
+
+void AutoSolver::solve()
+{
+    const SolverProfile profile(profilePath);
+    const SolverProfile::Features features = SolverProfile::Features::of(problem);
+
+    // 残り時間で終わらなかった記録は使わない
+    double remain = 0.0;
+    if(deadline != Clock::time_point::max()){
+        remain = std::max(1.0, std::chrono::duration<double, std::milli>(deadline - Clock::now()).count());
+    }
+
+    const boost::optional<SolverProfile::Parameters> parameters = profile.select(features, remain);
+    selected = parameters ? *parameters : fallback;
+
+    const bool explore = record && !candidates.empty() && util::Random::nextReal() < exploration;
+    if(explore){
+        selected = candidates[util::Random::nextInt(0, candidates.size() - 1)];
+    }
+
+    verbose && std::cerr << boost::format("[auto] %d records, %s %s (beam = %d, kurage area = %d)")
+        % profile.records.size() % (explore ? "explore" : "use") % selected.solver % selected.totalBeamWidth % selected.kurageMaxArea << std::endl;
+
+    std::unique_ptr<Solver> solver = create_solver(selected.solver, problem);
+    if(solver == nullptr){
+        throw std::runtime_error("unknown solver: " + selected.solver);
+    }
+    selected.apply(*solver);
+    solver->numThreads = numThreads;
+    solver->inheritDeadline(*this);
+
+    solver->onCreatedAnswer = [this](const Answer& answer){
+        publishAnswer(answer);
+    };
+
+    const Clock::time_point begin = Clock::now();
+    solver->solve();
+    const double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+    if(record && bestCost() != 1 << 29){
+        SolverProfile::append(profilePath, {features, selected, elapsed, bestCost(), !isTimeUp()});
+    }
+}
+
+} // end of namespace slide
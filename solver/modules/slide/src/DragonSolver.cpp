@@ -6,7 +6,8 @@
 #include "WhaleSolver.hpp"
 
 #include "util/StopWatch.hpp"
-#include "util/ThreadIndexManager.hpp"
+
+#include <algorithm>
 
 #include <tbb/task_scheduler_init.h>
 
@@ -25,13 +26,9 @@ void DragonSolver::solve(const PlayBoard<H, W>& start)
         numThreads = tbb::task_scheduler_init::default_num_threads();
     }
     tbb::task_scheduler_init init(numThreads);
-    util::ThreadIndexManager::clear();
 
-    AnswerLinearTree::nodes.clear();
-    AnswerLinearTree::nodes.resize(numThreads);
-    rep(i, numThreads){
-        AnswerLinearTree::nodes[i].reserve(400000 * H * W / numThreads);
-    }
+    // whale と dolphin で共有する解答木
+    AnswerLinearTree tree;
 
     //constexpr int dolphinMinSize = 5;
     constexpr int kurageMaxSize = 10;
@@ -39,43 +36,48 @@ void DragonSolver::solve(const PlayBoard<H, W>& start)
     DolphinSolver::verbose = verbose;
     KurageSolver::verbose = verbose;
 
-    if(H*W <= 100){
+    // 大きさは実行時の値を見る (branch.hpp の汎用の経路 PlayBoard<Flexible> でも同じく領域を切り出す)
+    if(start.height() * start.width() <= kurageMaxArea){
     //if((H <= kurageMaxSize && W <= kurageMaxSize) || H < dolphinMinSize || W < dolphinMinSize){
         
         // 普通に kurage
         KurageSolver kurage(problem);
         kurage.numThreads = numThreads;
+        kurage.totalBeamWidth = totalBeamWidth;
+        kurage.inheritDeadline(*this);
 
         kurage.onCreatedAnswer = [&](const Answer& answer){
             Answer tmp = answer;
             tmp.optimize();
-            onCreatedAnswer(tmp);
+            publishAnswer(tmp);
         };
 
         kurage.solve(start, problem.selectionLimit);
     }
     else{
 
-        constexpr int h = H < kurageMaxSize ? H : kurageMaxSize;
-        constexpr int w = W < kurageMaxSize ? W : kurageMaxSize;
-        constexpr int y = (H - h) / 2;
-        constexpr int x = (W - w) / 2;
+        // 中央の高々 kurageMaxSize 四方を dolphin で揃える領域にする
+        const int h = std::min(start.height(), kurageMaxSize);
+        const int w = std::min(start.width(), kurageMaxSize);
+        const int y = (start.height() - h) / 2;
+        const int x = (start.width() - w) / 2;
 
-        RestrictedSquaredManhattanFeature<H, W>::y = y;
-        RestrictedSquaredManhattanFeature<H, W>::x = x;
-        RestrictedSquaredManhattanFeature<H, W>::h = h;
-        RestrictedSquaredManhattanFeature<H, W>::w = w;
+        // 切り出した盤面の型 (汎用の経路では大きさを実行時に持つ)
+        constexpr int subH = H == Flexible || H < kurageMaxSize ? H : kurageMaxSize;
+        constexpr int subW = W == Flexible || W < kurageMaxSize ? W : kurageMaxSize;
 
         WhaleSolver whale(problem);
         whale.numThreads = numThreads;
-        whale.totalBeamWidth = 4000;
+        whale.totalBeamWidth = totalBeamWidth;
+        whale.inheritDeadline(*this);
 
         util::StopWatch::start("whale");
-        std::vector<AnswerTreeBoard<H, W>> first = whale.decreaseManhattan(start, problem.selectionLimit, y, x, h, w);
+        std::vector<AnswerTreeBoard<H, W>> first = whale.decreaseManhattan(start, tree, problem.selectionLimit, y, x, h, w);
         util::StopWatch::stop_last();
 
         // dolphin で解く
         DolphinSolver dolphin;
+        dolphin.inheritDeadline(*this);
 
         util::StopWatch::start("dolphin");
         const AnswerTreeBoard<H, W> result = dolphin.compute(first, y, x, h, w);
@@ -86,18 +88,20 @@ void DragonSolver::solve(const PlayBoard<H, W>& start)
         
         std::cout << "Dolphin = " << answer.size() << std::endl;
 
-        // PlayBoard<h, w> に変換
-        PlayBoard<h, w> board;
+        // 領域を PlayBoard<subH, subW> に変換
+        PlayBoard<subH, subW> board(h, w);
         extractBoard(result, board, y, x);
 
         // kurage で解く
         KurageSolver kurage2(problem);
         kurage2.numThreads = numThreads;
+        kurage2.totalBeamWidth = totalBeamWidth;
+        kurage2.inheritDeadline(*this);
         kurage2.onCreatedAnswer = [&](const Answer& arg){
             Answer final_answer = answer;
             appendAnswer(final_answer, arg, y, x);
             final_answer.optimize();
-            onCreatedAnswer(final_answer);
+            publishAnswer(final_answer);
         };
 
         util::StopWatch::start("second kurage");
@@ -106,15 +110,9 @@ void DragonSolver::solve(const PlayBoard<H, W>& start)
     }
 }
 
-template<>
-void DragonSolver::solve<Flexible, Flexible>(const PlayBoard<Flexible>& board)
-{
-    branch(make_solve_caller(*this), board);
-}
-
 void DragonSolver::solve()
 {
-    return solve(PlayBoard<Flexible>(problem.board));
+    branch(make_solve_caller(*this), PlayBoard<Flexible>(problem.board));
 }
 
 } // end of namespace slide
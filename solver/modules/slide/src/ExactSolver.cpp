@@ -1,57 +1,188 @@
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
 #include <utility>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_scheduler_init.h>
 
 #include "PlayBoard.hpp"
 #include "ExactSolver.hpp"
+#include "PatternDatabase.hpp"
 #include "branch.hpp"
 
 namespace slide
 {
 
+constexpr ull ExactSolver::TIME_CHECK_INTERVAL;
+constexpr double ExactSolver::NODE_RATE;
+constexpr std::size_t ExactSolver::MIN_TABLE_BYTES;
+
+ull ExactSolver::tableKey(ull hash, Move preMove)
+{
+    // 直前の操作 (選択か 4 方向の移動) 毎の乱数
+    static constexpr ull PRE_MOVE_KEYS[5] = {
+        0x9e3779b97f4a7c15ull, 0xbf58476d1ce4e5b9ull, 0x94d049bb133111ebull, 0xd6e8feb86659fd93ull, 0xa0761d6478bd642full
+    };
+    return hash ^ PRE_MOVE_KEYS[preMove.isSelection ? 4 : int(preMove.getDirection())];
+}
+
+std::size_t ExactSolver::tableBytesFor(int area) const
+{
+    if(tableBytes == 0 || deadline == Clock::time_point::max()){
+        return tableBytes;
+    }
+
+    const double seconds = std::max(0.0, std::chrono::duration<double>(deadline - Clock::now()).count());
+    const double bytes = NODE_RATE / area * numThreads * seconds * util::TranspositionTable::BUCKET_BYTES;
+    return std::min(tableBytes, std::max(MIN_TABLE_BYTES, std::size_t(std::min(bytes, double(tableBytes)))));
+}
+
+void ExactSolver::addStatistics(const Worker& worker)
+{
+    visitedNode += worker.visitedNode;
+    tableHits += worker.tableHits;
+    tableCutoffs += worker.tableCutoffs;
+}
+
+void ExactSolver::setAnswer(const Answer& prefix, const Answer& reversedSuffix)
+{
+    std::lock_guard<std::mutex> lock(answerMutex);
+    if(found.load(std::memory_order_relaxed)){
+        return;
+    }
+
+    answer = prefix;
+    answer.insert(answer.end(), reversedSuffix.rbegin(), reversedSuffix.rend());
+    found.store(true, std::memory_order_relaxed);
+}
+
 template<int H, int W>
-int ExactSolver::startDFS(const AdmissibleBoard<H, W>& board, int lb)
+int ExactSolver::parallelDFS(const ExactBoard<H, W>& board, int lb, Move preMove, int depth, const Answer& prefix)
 {
     if(board.isFinished()){
+        setAnswer(prefix, Answer());
         return -1; // -1 means the answer was found
     }
+    if(isStopped()){
+        return 1 << 29;
+    }
 
     ++visitedNode;
 
     int min = 1 << 29;
 
-    // select
-    rep(i, board.height()) rep(j, board.width()) {
+    // 子を列挙する (根では選択だけ)
+    std::vector<std::pair<ExactBoard<H, W>, Move>> children;
 
-        AdmissibleBoard<H, W> next = board;
-        next.select(i, j);
-        if(next.lowerBound > lb){
-            min = std::min(min, next.lowerBound);
-            continue;
+    // move
+    if(depth > 0){
+        rep(k, 4){
+            const Direction dir(k);
+            if(!board.isValidMove(dir) || (!preMove.isSelection && preMove.getDirection() == dir.opposite())){
+                continue;
+            }
+
+            ExactBoard<H, W> next = board;
+            next.move(dir);
+            if(next.lowerBound > lb){
+                min = std::min(min, next.lowerBound);
+                continue;
+            }
+            children.emplace_back(next, Move(dir));
         }
+    }
 
-        const int ret = DFS(next, lb, Move(Point(i, j)));
+    // select
+    if(depth == 0 || (board.selectionLimit > 0 && !preMove.isSelection)){
+        const int height = board.height(), width = board.width(); // PlayBoard<Flexible> でも毎回読み直さないように
+        rep(i, height) rep(j, width) {
+            if(depth > 0 && Point(i, j) == board.selected){
+                continue;
+            }
 
-        if(ret == -1){
-            answer.emplace_back(Point(i, j));
-            return -1;
+            ExactBoard<H, W> next = board;
+            next.select(i, j);
+            if(next.lowerBound > lb){
+                min = std::min(min, next.lowerBound);
+                continue;
+            }
+            children.emplace_back(next, Move(Point(i, j)));
         }
-
-        min = std::min(min, ret);
     }
 
-    return min;   
+    // 次の閾値は全ての子の最小値
+    std::atomic<int> childMin(min);
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, children.size(), 1),
+        [this, &children, &childMin, &prefix, lb, depth]
+    (const tbb::blocked_range<std::size_t>& range){
+        for(std::size_t k = range.begin(); k != range.end(); ++k){
+            // 部分木が小さいと DFS の中の確認間隔に届かないので，部分木の境目でも締め切りを確認する
+            checkTime();
+            if(isStopped()){
+                break;
+            }
+
+            Answer childPrefix = prefix;
+            childPrefix.push_back(children[k].second);
+
+            int ret;
+            if(depth + 1 < splitDepth){
+                ret = parallelDFS(children[k].first, lb, children[k].second, depth + 1, childPrefix);
+            }
+            else{
+                Worker worker;
+                ExactBoard<H, W> next = children[k].first;
+                ret = DFS(next, lb, children[k].second, worker);
+                addStatistics(worker);
+
+                if(ret == -1){
+                    setAnswer(childPrefix, worker.answer);
+                }
+            }
+
+            int now = childMin.load();
+            while(ret < now && !childMin.compare_exchange_weak(now, ret));
+        }
+    });
+
+    return found.load() ? -1 : childMin.load();
 }
 
 template<int H, int W>
-int ExactSolver::DFS(AdmissibleBoard<H, W>& board, int lb, Move preMove)
+int ExactSolver::DFS(ExactBoard<H, W>& board, int lb, Move preMove, Worker& worker)
 {
     if(board.isFinished()){
         return -1; // -1 means the answer was found
     }
 
-    ++visitedNode;
+    ++worker.visitedNode;
+
+    // 他のタスクが見つけたか締め切りを過ぎたら，見つからなかったことにして戻る
+    if(worker.visitedNode % TIME_CHECK_INTERVAL == 0){
+        checkTime();
+    }
+    if(isStopped()){
+        return 1 << 29;
+    }
+
+    // 以前に (同じ反復か前の反復で) 辿った状態なら，その時に分かった下界で枝刈りできるかもしれない
+    const ull key = table ? tableKey(board.hash, preMove) : 0ull;
+    if(table){
+        const int bound = table->find(key);
+        if(bound >= 0){
+            ++worker.tableHits;
+            if(board.cost + bound > lb){
+                ++worker.tableCutoffs;
+                return board.cost + bound;
+            }
+        }
+    }
 
     int min = 1 << 29;
 
@@ -62,17 +193,17 @@ int ExactSolver::DFS(AdmissibleBoard<H, W>& board, int lb, Move preMove)
             continue;
         }
 
-        AdmissibleBoard<H, W> next = board;
+        ExactBoard<H, W> next = board;
         next.move(dir);
         if(next.lowerBound > lb){
             min = std::min(min, next.lowerBound);
             continue;
         }
 
-        const int ret = DFS(next, lb, Move(dir));
+        const int ret = DFS(next, lb, Move(dir), worker);
 
         if(ret == -1){
-            answer.emplace_back(dir);
+            worker.answer.emplace_back(dir);
             return -1;
         }
 
@@ -82,9 +213,11 @@ int ExactSolver::DFS(AdmissibleBoard<H, W>& board, int lb, Move preMove)
     // select
     if(board.selectionLimit > 0 && !preMove.isSelection){
     	const CMPFeatures cmp = board;
+        const HashFeature<H, W> hashFeature = board;
         const Point preSelected = board.selected;
 
-        rep(i, board.height()) rep(j, board.width()) {
+        const int height = board.height(), width = board.width();
+        rep(i, height) rep(j, width) {
             if(Point(i, j) == preSelected){
                 continue;
             }
@@ -93,14 +226,16 @@ int ExactSolver::DFS(AdmissibleBoard<H, W>& board, int lb, Move preMove)
             if(board.lowerBound > lb){
                 min = std::min(min, board.lowerBound);
                 board.CMPFeatures::operator=(cmp);
+                board.HashFeature<H, W>::operator=(hashFeature);
                 continue;
             }
 
-            const int ret = DFS(board, lb, Move(Point(i, j)));
+            const int ret = DFS(board, lb, Move(Point(i, j)), worker);
             board.CMPFeatures::operator=(cmp);
+            board.HashFeature<H, W>::operator=(hashFeature);
 
             if(ret == -1){
-                answer.emplace_back(Point(i, j));
+                worker.answer.emplace_back(Point(i, j));
                 return -1;
             }
 
@@ -110,54 +245,89 @@ int ExactSolver::DFS(AdmissibleBoard<H, W>& board, int lb, Move preMove)
         board.selected = preSelected;
     }
 
+    // 打ち切られた探索の値は下界ではない
+    if(table && !isStopped()){
+        table->store(key, min - board.cost, lb - board.cost);
+    }
+
     return min;
 }
 
 template<int H, int W>
-void ExactSolver::IDAstar(const PlayBoard<H, W>& board)
+bool ExactSolver::IDAstar(const PlayBoard<H, W>& board)
 {
-    AdmissibleBoard<H, W> start(board, problem.selectionLimit);
+    const ZobristTable<H, W> hashTable(board.height(), board.width());
+    ExactBoard<H, W> start(board, problem.selectionLimit, &hashTable);
     int lb = start.lowerBound;
 
     for(;;){
         std::cerr << lb << " ";
-        const int next = startDFS(start, lb);
+        if(table){
+            table->nextGeneration();
+        }
+        const int next = parallelDFS(start, lb, Move(), 0, Answer());
 
         if(next == -1){
             break;
         }
+        else if(timeUp){
+            return false;
+        }
         else{
             lb = next;
         }
     }
 
-    std::reverse(answer.begin(), answer.end());
+    return true;
 }
 
 template<int H, int W>
 void ExactSolver::solve(const PlayBoard<H, W>& board)
 {
+    // 並列化数の設定
+    if(numThreads == -1){
+        numThreads = tbb::task_scheduler_init::default_num_threads();
+    }
+    tbb::task_scheduler_init init(numThreads);
+
     CostFeature::setCosts(problem.swappingCost, problem.selectionCost);
+    PatternDatabase::load(board.height(), board.width());
+    answer.clear();
     visitedNode = 0;
+    tableHits = 0;
+    tableCutoffs = 0;
+    found = false;
+    timeUp = false;
+
+    const std::size_t bytes = tableBytesFor(board.height() * board.width());
+    if(bytes > 0){
+        table.reset(new util::TranspositionTable(bytes));
+        std::cerr << boost::format("transposition table: %d MiB") % (table->bytes() >> 20) << std::endl;
+    }
+
+    const bool solved = IDAstar(board);
+    table.reset();
 
-    IDAstar(board);
     std::cerr << "visited " << visitedNode << " nodes!" << std::endl;
+    if(bytes > 0){
+        std::cerr << boost::format("transposition table: %d hits, %d cutoffs (%.1f%% of visited nodes)")
+            % tableHits.load() % tableCutoffs.load() % (100.0 * tableCutoffs / std::max<ull>(1, visitedNode)) << std::endl;
+    }
+
+    if(!solved){
+        std::cerr << "time up!" << std::endl;
+        return;
+    }
 
     answer.optimize();
     BOOST_ASSERT(problem.check(answer));
 
-    onCreatedAnswer(answer);
-}
-
-template<>
-void ExactSolver::solve<Flexible, Flexible>(const PlayBoard<Flexible>& board)
-{
-    branch(make_solve_caller(*this), board);
+    publishAnswer(answer);
 }
 
 void ExactSolver::solve()
 {
-    return solve(PlayBoard<Flexible>(problem.board));
+    branch(make_solve_caller(*this), PlayBoard<Flexible>(problem.board));
 }
 
 } // end of namespace slide
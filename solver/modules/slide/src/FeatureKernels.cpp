@@ -0,0 +1,318 @@
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#include "FeatureKernels.hpp"
+
+namespace slide
+{
+
+namespace
+{
+
+constexpr int CELLS = MAX_DIVISION_NUM * MAX_DIVISION_NUM;
+
+#if defined(__AVX2__)
+constexpr int LANES = 32;
+#elif defined(__SSE4_1__)
+constexpr int LANES = 16;
+#else
+constexpr int LANES = 1;
+#endif
+
+// 幅毎の，各位置の正しい id (行優先)
+// 盤面の外の位置はセルにも同じ値を入れておくので，揃っているとみなされて何も数えない
+struct PositionTable
+{
+    alignas(32) uchar id[MAX_DIVISION_NUM + 1][CELLS];
+
+    PositionTable()
+    {
+        std::memset(id, 0, sizeof(id));
+        reps(w, 1, MAX_DIVISION_NUM + 1) rep(i, CELLS){
+            id[w][i] = Point(i / w % MAX_DIVISION_NUM, i % w).toInt();
+        }
+    }
+};
+
+const PositionTable& positionTable()
+{
+    static const PositionTable table;
+    return table;
+}
+
+// 1 度の走査で求める値
+struct Scan
+{
+    int manhattan = 0;
+    int squaredManhattan = 0;
+    int squaredSum = 0;
+    int sumY = 0;
+    int sumX = 0;
+    int count = 0;
+    ull inRow[CELLS / 64] = {};       // 正しい行にいるセル
+    ull inColumn[CELLS / 64] = {};    // 正しい列にいるセル
+};
+
+inline int popcount(ull x)
+{
+    return __builtin_popcountll(x);
+}
+
+#if defined(__AVX2__)
+
+int horizontalSum32(__m256i v)
+{
+    alignas(32) int lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+    int sum = 0;
+    rep(i, 8) sum += lanes[i];
+    return sum;
+}
+
+int horizontalSum64(__m256i v)
+{
+    alignas(32) ull lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), v);
+    return static_cast<int>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+void scan(const uchar* cell, const uchar* position, int end, Scan& out)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    __m256i manhattan = zero, squaredManhattan = zero, squaredSum = zero, sumY = zero, sumX = zero;
+
+    for(int i = 0; i < end; i += LANES){
+        const __m256i c = _mm256_load_si256(reinterpret_cast<const __m256i*>(cell + i));
+        const __m256i p = _mm256_load_si256(reinterpret_cast<const __m256i*>(position + i));
+        const __m256i cy = _mm256_and_si256(_mm256_srli_epi16(c, 4), low);
+        const __m256i cx = _mm256_and_si256(c, low);
+        const __m256i py = _mm256_and_si256(_mm256_srli_epi16(p, 4), low);
+        const __m256i px = _mm256_and_si256(p, low);
+
+        // マンハッタン距離 (1 セル高々 30 なので 8 bit のまま足す)
+        const __m256i l1 = _mm256_add_epi8(_mm256_abs_epi8(_mm256_sub_epi8(cy, py)), _mm256_abs_epi8(_mm256_sub_epi8(cx, px)));
+        manhattan = _mm256_add_epi64(manhattan, _mm256_sad_epu8(l1, zero));
+        squaredManhattan = _mm256_add_epi32(squaredManhattan, _mm256_madd_epi16(_mm256_maddubs_epi16(l1, l1), ones));
+
+        // 揃っていないセルの位置
+        const __m256i aligned = _mm256_cmpeq_epi8(c, p);
+        const __m256i vy = _mm256_andnot_si256(aligned, py);
+        const __m256i vx = _mm256_andnot_si256(aligned, px);
+        sumY = _mm256_add_epi64(sumY, _mm256_sad_epu8(vy, zero));
+        sumX = _mm256_add_epi64(sumX, _mm256_sad_epu8(vx, zero));
+        squaredSum = _mm256_add_epi32(squaredSum,
+            _mm256_madd_epi16(_mm256_add_epi16(_mm256_maddubs_epi16(vy, vy), _mm256_maddubs_epi16(vx, vx)), ones));
+        out.count += popcount(~uint(_mm256_movemask_epi8(aligned)));
+
+        out.inRow[i / 64] |= ull(uint(_mm256_movemask_epi8(_mm256_cmpeq_epi8(cy, py)))) << (i % 64);
+        out.inColumn[i / 64] |= ull(uint(_mm256_movemask_epi8(_mm256_cmpeq_epi8(cx, px)))) << (i % 64);
+    }
+
+    out.manhattan = horizontalSum64(manhattan);
+    out.squaredManhattan = horizontalSum32(squaredManhattan);
+    out.squaredSum = horizontalSum32(squaredSum);
+    out.sumY = horizontalSum64(sumY);
+    out.sumX = horizontalSum64(sumX);
+}
+
+#elif defined(__SSE4_1__)
+
+int horizontalSum32(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+
+int horizontalSum64(__m128i v)
+{
+    return _mm_cvtsi128_si32(v) + _mm_extract_epi32(v, 2);
+}
+
+void scan(const uchar* cell, const uchar* position, int end, Scan& out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low = _mm_set1_epi8(0x0f);
+    const __m128i ones = _mm_set1_epi16(1);
+
+    __m128i manhattan = zero, squaredManhattan = zero, squaredSum = zero, sumY = zero, sumX = zero;
+
+    for(int i = 0; i < end; i += LANES){
+        const __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(cell + i));
+        const __m128i p = _mm_load_si128(reinterpret_cast<const __m128i*>(position + i));
+        const __m128i cy = _mm_and_si128(_mm_srli_epi16(c, 4), low);
+        const __m128i cx = _mm_and_si128(c, low);
+        const __m128i py = _mm_and_si128(_mm_srli_epi16(p, 4), low);
+        const __m128i px = _mm_and_si128(p, low);
+
+        // マンハッタン距離 (1 セル高々 30 なので 8 bit のまま足す)
+        const __m128i l1 = _mm_add_epi8(_mm_abs_epi8(_mm_sub_epi8(cy, py)), _mm_abs_epi8(_mm_sub_epi8(cx, px)));
+        manhattan = _mm_add_epi64(manhattan, _mm_sad_epu8(l1, zero));
+        squaredManhattan = _mm_add_epi32(squaredManhattan, _mm_madd_epi16(_mm_maddubs_epi16(l1, l1), ones));
+
+        // 揃っていないセルの位置
+        const __m128i aligned = _mm_cmpeq_epi8(c, p);
+        const __m128i vy = _mm_andnot_si128(aligned, py);
+        const __m128i vx = _mm_andnot_si128(aligned, px);
+        sumY = _mm_add_epi64(sumY, _mm_sad_epu8(vy, zero));
+        sumX = _mm_add_epi64(sumX, _mm_sad_epu8(vx, zero));
+        squaredSum = _mm_add_epi32(squaredSum,
+            _mm_madd_epi16(_mm_add_epi16(_mm_maddubs_epi16(vy, vy), _mm_maddubs_epi16(vx, vx)), ones));
+        out.count += popcount(~uint(_mm_movemask_epi8(aligned)) & 0xffff);
+
+        out.inRow[i / 64] |= ull(uint(_mm_movemask_epi8(_mm_cmpeq_epi8(cy, py)))) << (i % 64);
+        out.inColumn[i / 64] |= ull(uint(_mm_movemask_epi8(_mm_cmpeq_epi8(cx, px)))) << (i % 64);
+    }
+
+    out.manhattan = horizontalSum64(manhattan);
+    out.squaredManhattan = horizontalSum32(squaredManhattan);
+    out.squaredSum = horizontalSum32(squaredSum);
+    out.sumY = horizontalSum64(sumY);
+    out.sumX = horizontalSum64(sumX);
+}
+
+#else
+
+void scan(const uchar* cell, const uchar* position, int end, Scan& out)
+{
+    rep(i, end){
+        const int cy = cell[i] >> 4, cx = cell[i] & 0xf;
+        const int py = position[i] >> 4, px = position[i] & 0xf;
+
+        const int l1 = util::abs(cy - py) + util::abs(cx - px);
+        out.manhattan += l1;
+        out.squaredManhattan += l1 * l1;
+
+        if(cell[i] != position[i]){
+            out.squaredSum += py * py + px * px;
+            out.sumY += py;
+            out.sumX += px;
+            ++out.count;
+        }
+
+        out.inRow[i / 64] |= ull(cy == py) << (i % 64);
+        out.inColumn[i / 64] |= ull(cx == px) << (i % 64);
+    }
+}
+
+#endif
+
+// 添字の小さい順に，area より前の立っているビットの添字で f を呼ぶ
+template<typename F>
+void forEachBit(const ull (&bits)[CELLS / 64], int area, F f)
+{
+    rep(k, CELLS / 64){
+        for(ull b = bits[k]; b; b &= b - 1){
+            const int i = k * 64 + __builtin_ctzll(b);
+            if(i >= area){
+                return;
+            }
+            f(i);
+        }
+    }
+}
+
+// 同じ行 (列) の前にいる，自分より後ろへ行くべきセルの数の和
+int linearConflict(const uchar* cell, const uchar* position, int area, const Scan& scan)
+{
+    int sum = 0;
+    uint seenRow[MAX_DIVISION_NUM] = {};
+    uint seenColumn[MAX_DIVISION_NUM] = {};
+
+    forEachBit(scan.inRow, area, [&](int i){
+        const int y = position[i] >> 4, x = cell[i] & 0xf;
+        sum += popcount(seenRow[y] >> (x + 1));
+        seenRow[y] |= 1u << x;
+    });
+    forEachBit(scan.inColumn, area, [&](int i){
+        const int y = cell[i] >> 4, x = position[i] & 0xf;
+        sum += popcount(seenColumn[x] >> (y + 1));
+        seenColumn[x] |= 1u << y;
+    });
+
+    return sum;
+}
+
+// 前にある自分より大きな値の数を，見た値のビット列から数える
+bool parity(const uchar* cell, int area)
+{
+    ull seen[CELLS / 64] = {};
+    int inversions = 0;
+
+    rep(i, area){
+        const int k = cell[i] / 64, b = cell[i] % 64;
+        inversions += popcount(seen[k] >> b >> 1);
+        reps(l, k + 1, CELLS / 64){
+            inversions += popcount(seen[l]);
+        }
+        seen[k] |= 1ull << b;
+    }
+
+    return inversions & 1;
+}
+
+} // end of unnamed namespace
+
+FeatureSums computeFeatureSums(const uchar* cell, int height, int width, int selected, uint kinds)
+{
+    const int area = height * width;
+    const uchar* position = positionTable().id[width];
+
+    // 盤面の外は揃っているセルで埋める
+    alignas(32) uchar buffer[CELLS];
+    std::memcpy(buffer, cell, area);
+    std::memcpy(buffer + area, position + area, CELLS - area);
+
+    Scan s;
+    scan(buffer, position, (area + LANES - 1) / LANES * LANES, s);
+
+    // 選択中のセルの分を除く
+    if(selected >= 0){
+        const int cy = buffer[selected] >> 4, cx = buffer[selected] & 0xf;
+        const int py = position[selected] >> 4, px = position[selected] & 0xf;
+
+        const int l1 = util::abs(cy - py) + util::abs(cx - px);
+        s.manhattan -= l1;
+        s.squaredManhattan -= l1 * l1;
+
+        if(buffer[selected] != position[selected]){
+            s.squaredSum -= py * py + px * px;
+            s.sumY -= py;
+            s.sumX -= px;
+            --s.count;
+        }
+
+        s.inRow[selected / 64] &= ~(1ull << (selected % 64));
+        s.inColumn[selected / 64] &= ~(1ull << (selected % 64));
+    }
+
+    FeatureSums ret;
+    ret.manhattan = s.manhattan;
+    ret.squaredManhattan = s.squaredManhattan;
+    ret.linearConflict = kinds & FeatureSums::LINEAR_CONFLICT ? linearConflict(buffer, position, area, s) : 0;
+    ret.squaredSum = s.squaredSum;
+    ret.sumY = s.sumY;
+    ret.sumX = s.sumX;
+    ret.count = s.count;
+    ret.parity = kinds & FeatureSums::PARITY ? parity(buffer, area) : false;
+    return ret;
+}
+
+const char* featureKernelName()
+{
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE4_1__)
+    return "SSE4.1";
+#else
+    return "scalar";
+#endif
+}
+
+} // end of namespace slide
@@ -1,16 +1,21 @@
 #include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <functional>
 #include <memory>
-#include <mutex>
-#include <queue>
 #include <thread>
 #include <utility>
 #include <vector>
 
+#include <tbb/task_scheduler_init.h>
+
+#include "ExternalAstar.hpp"
 #include "HitodeSolver.hpp"
+#include "PatternDatabase.hpp"
+#include "util/BucketQueue.hpp"
+#include "util/ConcurrentHashTable.hpp"
+#include "util/MPSCQueue.hpp"
 #include "util/dense_hash_map.hpp"
-#include "util/SpinMutex.hpp"
 
 namespace slide
 {
@@ -26,32 +31,88 @@ struct Data
 };
 
 template<int H, int W>
-class AstarWorker
+class AstarWorker;
+
+// 一方向 (元の盤面か逆盤面から) の探索
+// 状態はハッシュ値で担当のワーカーに振り分け (HDA*)，担当外の子は担当の受信箱に送る．
+template<int H, int W>
+class AstarSide
 {
 public:
-    util::SpinMutex mutex;
+    std::vector<std::unique_ptr<AstarWorker<H, W>>> workers;
 
-public:
-    std::atomic_ullong metHash;
-    util::dense_hash_map<ull, Data> visited;
-    AstarWorker* other;
-    int maxSelectionLimit;
-    int threadId;
+    // 詰めた節点から盤面を作り直すときに使う
+    const ZobristTable<H, W>* table;
+
+    // 到達済みの状態と残選択回数 (相手側のワーカーからロック無しで参照される)
+    // 混んできたら段を足して広げるので，登録に失敗して重複検出が抜けることはない
+    util::GrowableConcurrentHashTable reached;
+
+    // キューと受信箱にある，まだ処理していない節点の数 (0 になったらこの方向の探索は尽きた)
+    std::atomic<long long> pending;
+
+    AstarSide(int numWorkers, const ZobristTable<H, W>* table)
+        : table(table), reached(reachedCapacity(table->height(), table->width())), pending(0)
+    {
+        rep(i, numWorkers){
+            workers.emplace_back(new AstarWorker<H, W>());
+        }
+    }
+
+    // 状態数は盤面の面積に対して急に増えるので，面積の 4 乗程度から始める
+    // (小さな盤面で毎回 128 MiB を確保して 0 で埋めないように，最初の段は 2^24 までに抑える．足りなければ段を足す)
+    static std::size_t reachedCapacity(int height, int width)
+    {
+        const std::size_t area = height * width;
+        return std::min<std::size_t>(1 << 24, 4 * area * area * area * area);
+    }
 
-    explicit AstarWorker() : metHash(0ull), visited(0ull) {}
+    void markReached(ull hash, int selectionLimit)
+    {
+        reached.updateMax(hash, selectionLimit);
+    }
+
+    // 到達済みなら残選択回数，そうでなければ -1
+    int findReached(ull hash) const
+    {
+        return reached.find(hash);
+    }
 
-    void run(const HitodeBoard<H, W>& start);
-    void operator()(const HitodeBoard<H, W>& start) {
-        run(start);
+    int ownerIndex(ull hash) const
+    {
+        return (hash >> 32) % workers.size();
+    }
+
+    AstarWorker<H, W>& owner(ull hash) const
+    {
+        return *workers[ownerIndex(hash)];
     }
 
+    // 探索の始点を入れる (ワーカーが動き出す前に呼ぶ)
+    void send(const HitodeBoard<H, W>& board)
+    {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        owner(board.hash).inbox.push(std::vector<HitodeNode<H, W>>(1, HitodeNode<H, W>(board)));
+    }
+
+    std::size_t visitedSize() const
+    {
+        std::size_t ret = 0;
+        for(const std::unique_ptr<AstarWorker<H, W>>& worker : workers){
+            ret += worker->visited.size();
+        }
+        return ret;
+    }
+
+    // 全てのワーカーが終わってから呼ぶ
     Answer buildAnswer(ull start) const
     {
         Answer answer;
 
         while(start){
-            answer.emplace_back(visited.at(start).preMove);
-            start = visited.at(start).parent;
+            const Data& data = owner(start).visited.at(start);
+            answer.emplace_back(data.preMove);
+            start = data.parent;
         }
 
         answer.pop_back();
@@ -62,93 +123,210 @@ public:
 };
 
 template<int H, int W>
-void AstarWorker<H, W>::run(const HitodeBoard<H, W>& start)
+class AstarWorker
 {
-    int max = 0;
+public:
+    // 締め切りを確認する間隔 (取り出した節点数)
+    static constexpr int TIME_CHECK_INTERVAL = 1 << 12;
+
+    // 担当外の子は送り先毎にこの数だけ溜めてから送る (受信箱の push は 1 回毎に確保するので)
+    static constexpr std::size_t BATCH_SIZE = 64;
+
+    // 溜めた子は，この数だけ節点を取り出す毎にも送る (担当のワーカーで展開が遅れすぎないように)
+    static constexpr int FLUSH_INTERVAL = 1 << 6;
+
+    // 担当する状態だけを持つ
+    util::dense_hash_map<ull, Data> visited;
+
+    // 他のワーカーから送られてきた節点 (送り元で溜めた分をまとめて受け取る)
+    // (小さな盤面では盤面を詰めて持ち，取り出すときに特徴量を作り直す)
+    util::MPSCQueue<std::vector<HitodeNode<H, W>>> inbox;
+
+    // 下界毎のバケツ (下界は小さな整数なので二分ヒープより速い)
+    util::BucketQueue<HitodeNode<H, W>> queue;
+
+    AstarSide<H, W>* side;
+    const AstarSide<H, W>* other;
+    std::atomic_ullong* metHash;
+    int maxSelectionLimit;
+    int threadId;
+    const Solver* solver;
+
+    AstarWorker() : visited(0ull), maxLowerBound(0) {}
+
+    void run();
+
+private:
+    int maxLowerBound;
+
+    // 送り先のワーカー毎の，まだ送っていない子
+    std::vector<std::vector<HitodeNode<H, W>>> outbox;
+
+    void expand(const HitodeBoard<H, W>& board);
+
+    void send(const HitodeBoard<H, W>& board)
+    {
+        side->pending.fetch_add(1, std::memory_order_relaxed);
 
-    std::priority_queue<HitodeBoard<H, W>> Q;
-    Q.push(start);
+        const int dst = side->ownerIndex(board.hash);
+        outbox[dst].emplace_back(board);
+        if(outbox[dst].size() >= BATCH_SIZE){
+            flush(dst);
+        }
+    }
 
-    while(!Q.empty()){
+    void flush(int dst)
+    {
+        if(!outbox[dst].empty()){
+            side->workers[dst]->inbox.push(std::move(outbox[dst]));
+            outbox[dst].clear();
+            outbox[dst].reserve(BATCH_SIZE);
+        }
+    }
+
+    void flushAll()
+    {
+        rep(dst, outbox.size()){
+            flush(dst);
+        }
+    }
+
+    bool isVisited(const HitodeBoard<H, W>& board) const
+    {
+        const auto itr = visited.find(board.hash);
+        return itr != visited.end() && itr->second.selectionLimit >= board.selectionLimit;
+    }
+};
+
+template<int H, int W>
+void AstarWorker<H, W>::run()
+{
+    int popped = 0;
+    std::vector<HitodeNode<H, W>> received;
+    outbox.resize(side->workers.size());
+    for(std::vector<HitodeNode<H, W>>& batch : outbox){
+        batch.reserve(BATCH_SIZE);
+    }
+
+    while(true){
 
         // check finished
-        if(other->metHash.load(std::memory_order_acquire)){
+        if(metHash->load(std::memory_order_acquire)){
             return;
         }
 
-        const HitodeBoard<H, W> board = Q.top();
-        Q.pop();
-
-        // check visited
-        {
-            if(!visited.count(board.hash)){
-                {
-                    std::lock_guard<util::SpinMutex> lock(mutex);
-
-                    visited.insert(
-                        std::pair<ull, Data>(board.hash,
-                            {
-                                board.parentHash,
-                                static_cast<uchar>(board.selectionLimit),
-                                board.preMove
-                            }
-                        )
-                    );
-                }
-            }
-            else if(visited.at(board.hash).selectionLimit >= board.selectionLimit){
-                continue;
-            }
-            else{
-                visited.at(board.hash) = {board.parentHash, static_cast<uchar>(board.selectionLimit), board.preMove};
+        // 締め切りを過ぎたら，出会わないまま終える
+        if(++popped % TIME_CHECK_INTERVAL == 0 && solver->isTimeUp()){
+            return;
+        }
+
+        if(popped % FLUSH_INTERVAL == 0){
+            flushAll();
+        }
+
+        while(inbox.pop(received)){
+            for(HitodeNode<H, W>& node : received){
+                queue.push(node.lowerBound, std::move(node));
             }
         }
 
-        if(max < board.lowerBound){
-            max = board.lowerBound;
-            std::cerr << board.lowerBound << ", ";
+        if(queue.empty()){
+            // 溜めた子を送ってから待つ (送らないと他のワーカーも待ったままになる)
+            flushAll();
+            // 他のワーカーが送ってくるのを待つ (どこにも節点が無ければ終わり)
+            if(side->pending.load(std::memory_order_acquire) == 0 || solver->isTimeUp()){
+                return;
+            }
+            std::this_thread::yield();
+            continue;
         }
 
-        // check whether finished or not
-        bool isFinished;
-        {
-            std::lock_guard<util::SpinMutex> lock(other->mutex);
-            isFinished = other->visited.count(board.hash)
-                && board.selectionLimit + other->visited.at(board.hash).selectionLimit + 1 >= maxSelectionLimit;
+        const HitodeBoard<H, W> board = unpackNode(queue.pop(), side->table);
+
+        expand(board);
+        side->pending.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+template<int H, int W>
+void AstarWorker<H, W>::expand(const HitodeBoard<H, W>& board)
+{
+    // check visited
+    {
+        const auto itr = visited.find(board.hash);
+        if(itr == visited.end()){
+            visited.insert(
+                std::pair<ull, Data>(board.hash,
+                    {
+                        board.parentHash,
+                        static_cast<uchar>(board.selectionLimit),
+                        board.preMove
+                    }
+                )
+            );
         }
+        else if(itr->second.selectionLimit >= board.selectionLimit){
+            return;
+        }
+        else{
+            itr->second = {board.parentHash, static_cast<uchar>(board.selectionLimit), board.preMove};
+        }
+
+        side->markReached(board.hash, board.selectionLimit);
+    }
+
+    if(threadId == 0 && maxLowerBound < board.lowerBound){
+        maxLowerBound = board.lowerBound;
+        std::cerr << board.lowerBound << ", ";
+    }
+
+    // check whether finished or not
+    const int otherSelectionLimit = other->findReached(board.hash);
+    if(otherSelectionLimit >= 0 && board.selectionLimit + otherSelectionLimit + 1 >= maxSelectionLimit){
+        ull expected = 0ull;
+        metHash->compare_exchange_strong(expected, board.hash, std::memory_order_acq_rel);
+        return;
+    }
 
-        if(isFinished){
-            metHash.store(board.hash, std::memory_order_release);
+    // 担当の子は自分のキューに，それ以外は担当の受信箱に入れる
+    // 選択回数が尽きてパリティが合わない盤面 (下界が無限大) は入れない
+    const auto push = [this](const HitodeBoard<H, W>& next){
+        if(next.isPrunnable()){
             return;
         }
 
-        // move
-        rep(k, 4){
-            const Direction dir = Direction(k);
-            if(!board.isValidMove(dir) || (!board.preMove.isSelection && board.preMove.getDirection() == dir.opposite())){
-                continue;
-            }
+        if(&side->owner(next.hash) != this){
+            send(next);
+        }
+        else if(!isVisited(next)){
+            side->pending.fetch_add(1, std::memory_order_relaxed);
+            queue.push(next.lowerBound, HitodeNode<H, W>(next));
+        }
+    };
 
-            HitodeBoard<H, W> next = board;
-            next.move(dir);
-            if(!visited.count(next.hash) || visited.at(next.hash).selectionLimit < next.selectionLimit){
-                Q.push(std::move(next));
-            }
+    // move
+    rep(k, 4){
+        const Direction dir = Direction(k);
+        if(!board.isValidMove(dir) || (!board.preMove.isSelection && board.preMove.getDirection() == dir.opposite())){
+            continue;
         }
 
-        // select
-        if(board.selectionLimit >= 1 && !board.preMove.isSelection){
-            rep(i, board.height()) rep(j, board.width()){
-                if(board.selected == Point(i, j)){
-                    continue;
-                }
-
-                HitodeBoard<H, W> next = board;
-                next.select(i, j);
-                if(!next.isPrunnable() && (!visited.count(next.hash) || visited.at(next.hash).selectionLimit < next.selectionLimit)){
-                    Q.push(std::move(next));
-                }
+        HitodeBoard<H, W> next = board;
+        next.move(dir);
+        push(next);
+    }
+
+    // select
+    if(board.selectionLimit >= 1 && !board.preMove.isSelection){
+        const int height = board.height(), width = board.width();
+        rep(i, height) rep(j, width){
+            if(board.selected == Point(i, j)){
+                continue;
             }
+
+            HitodeBoard<H, W> next = board;
+            next.select(i, j);
+            push(next);
         }
     }
 }
@@ -156,7 +334,58 @@ void AstarWorker<H, W>::run(const HitodeBoard<H, W>& start)
 } // end of nonamed namespace
 
 template<int H, int W>
-Answer HitodeSolver::bidirectionalAstar(const PlayBoard<H, W>& board)
+boost::optional<std::pair<Answer, Answer>> HitodeSolver::parallelAstar(const HitodeBoard<H, W>& start1, const HitodeBoard<H, W>& start2)
+{
+    // prepare workers (半分ずつ各方向に割り当てる)
+    if(numThreads == -1){
+        numThreads = tbb::task_scheduler_init::default_num_threads();
+    }
+    const int numWorkers = std::max(1, numThreads / 2);
+
+    std::atomic_ullong metHash(0ull);
+    AstarSide<H, W> forward(numWorkers, start1.table), backward(numWorkers, start2.table);
+    AstarSide<H, W>* const sides[2] = {&forward, &backward};
+    rep(d, 2) rep(i, numWorkers){
+        AstarWorker<H, W>& worker = *sides[d]->workers[i];
+        worker.side = sides[d];
+        worker.other = sides[1 - d];
+        worker.metHash = &metHash;
+        worker.maxSelectionLimit = problem.selectionLimit;
+        worker.threadId = i;
+        worker.solver = this;
+    }
+    forward.send(start1);
+    backward.send(start2);
+
+    // run threads
+    std::vector<std::thread> threads;
+    rep(d, 2) rep(i, numWorkers){
+        threads.emplace_back(&AstarWorker<H, W>::run, sides[d]->workers[i].get());
+    }
+    for(std::thread& thread : threads){
+        thread.join();
+    }
+
+    visitedNode = forward.visitedSize() + backward.visitedSize();
+
+    if(metHash == 0){
+        return boost::none;
+    }
+
+    return std::make_pair(forward.buildAnswer(metHash), backward.buildAnswer(metHash));
+}
+
+template<int H, int W>
+boost::optional<std::pair<Answer, Answer>> HitodeSolver::externalAstar(const HitodeBoard<H, W>& start1, const HitodeBoard<H, W>& start2)
+{
+    ExternalAstar<H, W> search(*this, problem.selectionLimit, memoryBudget, spillDirectory);
+    const boost::optional<std::pair<Answer, Answer>> ret = search.search(start1, start2);
+    visitedNode = search.visitedNode();
+    return ret;
+}
+
+template<int H, int W>
+boost::optional<Answer> HitodeSolver::bidirectionalAstar(const PlayBoard<H, W>& board)
 {
     // normal
     const ZobristTable<H, W> hashTable(board.height(), board.width());
@@ -168,40 +397,17 @@ Answer HitodeSolver::bidirectionalAstar(const PlayBoard<H, W>& board)
     const Board<H, W> invBoard = inverseBoard(board, table, invTable);
 
     // inverse hash table
-    ZobristTable<H, W> invHashTable = hashTable;
-    rep(i, board.height()) rep(j, board.width()){
-        const uchar id = board.correctId(i, j);
-        rep(y, board.height()) rep(x, board.width()){
-            invHashTable.look(table[id], Point(y, x)) = hashTable.look(id, Point(y, x));
-        }
-        invHashTable.lookSelected(table[id]) = hashTable.lookSelected(id);
-    }
+    const ZobristTable<H, W> invHashTable = hashTable.relabel(table);
 
     HitodeBoard<H, W> start2(invBoard, problem.selectionLimit, &invHashTable);
 
-    // prepare worker
-    AstarWorker<H, W> workers[2];
-    workers[0].maxSelectionLimit = problem.selectionLimit;
-    workers[1].maxSelectionLimit = problem.selectionLimit;
-    workers[0].other = &workers[1];
-    workers[1].other = &workers[0];
-    workers[0].threadId = 0;
-    workers[1].threadId = 1;
-
-    // run thread
-    std::thread threads[2] = {
-        std::thread(std::ref(workers[0]), start1),
-        std::thread(std::ref(workers[1]), start2)
-    };
-
-    threads[0].join();
-    threads[1].join();
-
-    const ull metHash = std::max(workers[0].metHash.load(), workers[1].metHash.load());
-    visitedNode = workers[0].visited.size() + workers[1].visited.size();
+    const boost::optional<std::pair<Answer, Answer>> halves =
+        memoryBudget > 0 ? externalAstar(start1, start2) : parallelAstar(start1, start2);
+    if(!halves){
+        return boost::none;
+    }
 
-    // construct answer
-    Answer answer[2] = {workers[0].buildAnswer(metHash), workers[1].buildAnswer(metHash)};
+    Answer answer[2] = {halves->first, halves->second};
 
     // combine answers
     {
@@ -250,25 +456,25 @@ template<int H, int W>
 void HitodeSolver::solve(const PlayBoard<H, W>& board)
 {
     CostFeature::setCosts(problem.swappingCost, problem.selectionCost);
+    PatternDatabase::load(board.height(), board.width());
     visitedNode = 0;
 
-    Answer answer = bidirectionalAstar(board);
+    boost::optional<Answer> answer = bidirectionalAstar(board);
     std::cerr << "visited " << visitedNode << " nodes!" << std::endl;
 
-    answer.optimize();
-    BOOST_ASSERT(problem.check(answer));
-    onCreatedAnswer(answer);
-}
+    if(!answer){
+        std::cerr << "time up!" << std::endl;
+        return;
+    }
 
-template<>
-void HitodeSolver::solve<Flexible, Flexible>(const PlayBoard<Flexible>& board)
-{
-    branch(make_solve_caller(*this), board);
+    answer->optimize();
+    BOOST_ASSERT(problem.check(*answer));
+    publishAnswer(*answer);
 }
 
 void HitodeSolver::solve()
 {
-    return solve(PlayBoard<Flexible>(problem.board));
+    branch(make_solve_caller(*this), PlayBoard<Flexible>(problem.board));
 }
 
 };
@@ -8,7 +8,7 @@
 #include "KurageBoard.hpp"
 #include "KurageSolver.hpp"
 
-#include "util/dense_hash_map.hpp"
+#include "util/ConcurrentHashTable.hpp"
 #include "util/Random.hpp"
 #include "util/SpinMutex.hpp"
 #include "util/StopWatch.hpp"
@@ -20,7 +20,7 @@ bool KurageSolver::verbose = false;
 
 void KurageSolver::solve()
 {
-    return solve(PlayBoard<Flexible>(problem.board), problem.selectionLimit);
+    branch(make_solve_caller(*this), PlayBoard<Flexible>(problem.board), problem.selectionLimit);
 }
 
 } // end of namespace slide
@@ -24,14 +24,17 @@ void L2Solver::solve(const PlayBoard<H, W>& board)
     DragonSolver solver(newProblem);
     DragonSolver::verbose = verbose;
     solver.numThreads = numThreads;
-    solver.onCreatedAnswer = onCreatedAnswer;
+    solver.inheritDeadline(*this);
+    solver.onCreatedAnswer = [this](const Answer& answer){
+        publishAnswer(answer);
+    };
 
     solver.solve(board);
 }
 
 void L2Solver::solve()
 {
-    return solve(PlayBoard<Flexible>(problem.board));
+    branch(make_solve_caller(*this), PlayBoard<Flexible>(problem.board));
 }
 
 } // end of namespace slide
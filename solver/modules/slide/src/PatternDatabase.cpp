@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/assert.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include "PatternDatabase.hpp"
+
+namespace slide
+{
+
+constexpr int PatternDatabase::MAX_PATTERNS;
+constexpr std::size_t PatternDatabase::MAX_TABLE_BYTES;
+constexpr uchar PatternDatabase::UNREACHABLE;
+
+bool PatternDatabase::enabled = true;
+std::string PatternDatabase::directory;
+
+namespace
+{
+
+struct Header
+{
+    char magic[8];
+    int height;
+    int width;
+    int patternSize;
+    int patternNum;
+};
+
+constexpr char MAGIC[8] = {'S', 'L', 'D', 'P', 'D', 'B', '0', '1'};
+
+std::mutex databasesMutex;
+std::map<std::pair<int, int>, std::unique_ptr<PatternDatabase>> databases;
+
+} // end of unnamed namespace
+
+PatternDatabase::PatternDatabase(int h, int w)
+    : h(h), w(w), patternSize(0), patternNum(0), tableSize(0), mapped(nullptr), mappedBytes(0)
+{
+    // 表が上限に収まる範囲で，なるべく大きな断片にする
+    const int n = h * w;
+    for(int k = 5; k >= 2; --k){
+        std::size_t size = 1;
+        rep(i, k){
+            size *= n;
+        }
+        if(size <= MAX_TABLE_BYTES && (n + k - 1) / k <= MAX_PATTERNS){
+            patternSize = k;
+            tableSize = size;
+            break;
+        }
+    }
+    if(patternSize == 0){
+        return;
+    }
+
+    // 正しい位置の行優先の順に patternSize 個ずつ区切る
+    patternNum = (n + patternSize - 1) / patternSize;
+    rep(i, n){
+        const uchar id = Point(i / w, i % w).toInt();
+        patternOf[id] = i / patternSize;
+        weightOf[id] = 1;
+        rep(j, i % patternSize){
+            weightOf[id] *= n;
+        }
+    }
+}
+
+PatternDatabase::~PatternDatabase()
+{
+    if(mapped != nullptr){
+        munmap(mapped, mappedBytes);
+    }
+}
+
+const PatternDatabase* PatternDatabase::load(int h, int w)
+{
+    if(!enabled){
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(databasesMutex);
+
+    const std::pair<int, int> key(h, w);
+    const auto itr = databases.find(key);
+    if(itr != databases.end()){
+        return itr->second.get();
+    }
+
+    std::unique_ptr<PatternDatabase> db(new PatternDatabase(h, w));
+    if(db->patternSize == 0){
+        databases[key] = nullptr;
+        return nullptr;
+    }
+
+    if(directory.empty()){
+        db->build();
+        return (databases[key] = std::move(db)).get();
+    }
+
+    const std::string path = (boost::format("%s/pdb_%dx%d_%d.bin") % directory % h % w % db->patternSize).str();
+    if(!db->map(path)){
+        std::cerr << "generating " << path << std::endl;
+        db->generate(path);
+        if(!db->map(path)){
+            throw std::runtime_error("cannot load " + path);
+        }
+    }
+
+    return (databases[key] = std::move(db)).get();
+}
+
+const PatternDatabase* PatternDatabase::find(int h, int w)
+{
+    if(!enabled){
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(databasesMutex);
+
+    const auto itr = databases.find(std::make_pair(h, w));
+    return itr != databases.end() ? itr->second.get() : nullptr;
+}
+
+bool PatternDatabase::map(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+
+    struct stat st;
+    const std::size_t expected = sizeof(Header) + tableSize * patternNum;
+    if(fstat(fd, &st) != 0 || std::size_t(st.st_size) != expected){
+        close(fd);
+        return false;
+    }
+
+    void* const addr = mmap(nullptr, expected, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(addr == MAP_FAILED){
+        return false;
+    }
+
+    const Header* header = static_cast<const Header*>(addr);
+    if(std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0
+        || header->height != h || header->width != w || header->patternSize != patternSize || header->patternNum != patternNum){
+        munmap(addr, expected);
+        return false;
+    }
+
+    mapped = addr;
+    mappedBytes = expected;
+
+    tables.clear();
+    rep(i, patternNum){
+        tables.push_back(static_cast<const uchar*>(addr) + sizeof(Header) + tableSize * i);
+    }
+    return true;
+}
+
+void PatternDatabase::build()
+{
+    memory.reset(new uchar[tableSize * patternNum]);
+
+    tables.clear();
+    rep(i, patternNum){
+        uchar* const table = memory.get() + tableSize * i;
+        generateTable(i, table);
+        tables.push_back(table);
+    }
+}
+
+void PatternDatabase::generate(const std::string& path) const
+{
+    boost::filesystem::create_directories(boost::filesystem::path(path).parent_path());
+
+    // 他のプロセスが途中まで書いたファイルを読まないように，書き終えてから置き換える
+    const std::string temporary = (boost::format("%s.%d.tmp") % path % getpid()).str();
+    std::ofstream fout(temporary.c_str(), std::ios::binary);
+    if(!fout){
+        throw std::runtime_error("cannot open " + temporary);
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.height = h;
+    header.width = w;
+    header.patternSize = patternSize;
+    header.patternNum = patternNum;
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<uchar> table(tableSize);
+    rep(i, patternNum){
+        generateTable(i, table.data());
+        fout.write(reinterpret_cast<const char*>(table.data()), table.size());
+    }
+
+    fout.close();
+    if(!fout || std::rename(temporary.c_str(), path.c_str()) != 0){
+        std::remove(temporary.c_str());
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+void PatternDatabase::generateTable(int pattern, uchar* table) const
+{
+    const int n = area();
+
+    // 断片のセルの正しい位置 (添字の桁の順)
+    std::vector<int> goals;
+    rep(i, n){
+        if(i / patternSize == pattern){
+            goals.push_back(i);
+        }
+    }
+    const int k = goals.size();
+
+    std::vector<uint> weights(k, 1);
+    rep(i, k) rep(j, i){
+        weights[i] *= n;
+    }
+
+    uint start = 0;
+    rep(i, k){
+        start += weights[i] * goals[i];
+    }
+
+    // 辺の重みは 1 (断片外のセルとの交換) か 2 (断片内のセル同士の交換) なので，距離毎のバケツで Dijkstra 法
+    std::fill(table, table + tableSize, UNREACHABLE);
+    std::vector<std::vector<uint>> buckets(1);
+    buckets[0].push_back(start);
+    table[start] = 0;
+    std::size_t pending = 1;
+
+    int pos[MAX_DIVISION_NUM];
+    for(int d = 0; pending > 0; ++d){
+        // 最長でも交換 1 回分先までしか伸びない
+        if(int(buckets.size()) < d + 3){
+            buckets.resize(d + 3);
+        }
+
+        for(std::size_t b = 0; b < buckets[d].size(); ++b){
+            const uint index = buckets[d][b];
+            --pending;
+            if(table[index] != d){
+                continue;
+            }
+
+            rep(i, k){
+                pos[i] = index / weights[i] % n;
+            }
+
+            rep(i, k) rep(dir, 4){
+                const Point p(pos[i] / w, pos[i] % w);
+                const Point q = p + Point::delta(Direction(dir));
+                if(q.y < 0 || q.y >= h || q.x < 0 || q.x >= w){
+                    continue;
+                }
+
+                const int c = q.y * w + q.x;
+                const int j = std::find(pos, pos + k, c) - pos;
+
+                uint next = index + weights[i] * c - weights[i] * pos[i];
+                int nd = d + 1;
+                if(j < k){
+                    // 断片内のセル同士の交換は 2 つとも動く
+                    next += weights[j] * pos[i] - weights[j] * c;
+                    nd = d + 2;
+                }
+
+                if(table[next] > nd){
+                    BOOST_ASSERT(nd < UNREACHABLE);
+                    table[next] = nd;
+                    buckets[nd].push_back(next);
+                    ++pending;
+                }
+            }
+        }
+
+        std::vector<uint>().swap(buckets[d]);
+    }
+}
+
+} // end of namespace slide
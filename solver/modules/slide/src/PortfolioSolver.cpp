@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+#include <tbb/task_scheduler_init.h>
+
+#include "AdmissibleBoard.hpp"
+#include "CostFeature.hpp"
+#include "PortfolioSolver.hpp"
+
+namespace slide
+{
+
+bool PortfolioSolver::verbose = false;
+
+void PortfolioSolver::solve()
+{
+    if(numThreads == -1){
+        numThreads = tbb::task_scheduler_init::default_num_threads();
+    }
+
+    // メンバは arena の中で 1 つずつタスクとして動き続けるので，スレッドはメンバの数以上要る
+    const int concurrency = std::max<int>(numThreads, entries.size());
+    tbb::task_scheduler_init init(concurrency);
+
+    double totalShare = 0.0;
+    for(const Entry& entry : entries){
+        totalShare += entry.share;
+    }
+
+    std::vector<std::unique_ptr<Solver>> solvers;
+    for(const Entry& entry : entries){
+        std::unique_ptr<Solver> solver = create_solver(entry.name, problem);
+        if(solver == nullptr){
+            throw std::runtime_error("unknown solver: " + entry.name);
+        }
+
+        solver->numThreads = totalShare > 0.0 ? std::max(1, int(numThreads * entry.share / totalShare + 0.5)) : 1;
+        solver->inheritDeadline(*this);
+        solvers.push_back(std::move(solver));
+    }
+
+    const int bound = lowerBound();
+    verbose && std::cerr << "[portfolio] lower bound = " << bound << std::endl;
+
+    std::mutex winnerMutex;
+    winner.clear();
+
+    rep(i, solvers.size()){
+        const std::string& name = entries[i].name;
+        solvers[i]->onCreatedAnswer = [this, &solvers, &winnerMutex, &name, bound](const Answer& answer){
+            if(!publishAnswer(answer)){
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(winnerMutex);
+                winner = name;
+            }
+            verbose && std::cerr << boost::format("[portfolio] %s: cost = %d") % name % cost(answer) << std::endl;
+
+            // これより良い解答は無いので，全員止める
+            if(isExact(name) || cost(answer) <= bound){
+                for(const std::unique_ptr<Solver>& solver : solvers){
+                    solver->cancel();
+                }
+            }
+        };
+    }
+
+    // メンバ毎の並列化数は，そのメンバの並列区間を実行する入れ子の arena の大きさで抑える
+    std::vector<std::unique_ptr<tbb::task_arena>> memberArenas;
+    for(const std::unique_ptr<Solver>& solver : solvers){
+        memberArenas.emplace_back(new tbb::task_arena(solver->numThreads));
+    }
+
+    // 全てのメンバを 1 つの arena で同時に走らせる (ワーカースレッドはこの arena のものを分け合う)
+    tbb::task_arena arena(concurrency);
+    arena.execute([this, &solvers, &memberArenas]{
+        tbb::task_group group;
+        rep(i, solvers.size()){
+            group.run([this, &solvers, &memberArenas, i]{
+                memberArenas[i]->execute([this, &solvers, i]{
+                    try{
+                        solvers[i]->solve();
+                    }catch(std::exception& e){
+                        std::cerr << "[portfolio] " << entries[i].name << ": " << e.what() << std::endl;
+                    }
+                });
+            });
+        }
+        group.wait();
+    });
+
+    verbose && std::cerr << "[portfolio] winner = " << winner << std::endl;
+}
+
+std::vector<PortfolioSolver::Entry> PortfolioSolver::parseEntries(const std::string& str)
+{
+    std::vector<std::string> items;
+    boost::split(items, str, boost::is_any_of(","), boost::token_compress_on);
+
+    std::vector<Entry> ret;
+    for(const std::string& item : items){
+        if(item.empty()){
+            continue;
+        }
+
+        const std::string::size_type colon = item.find(':');
+        if(colon == std::string::npos){
+            ret.push_back({item, 1.0});
+        }
+        else{
+            ret.push_back({item.substr(0, colon), boost::lexical_cast<double>(item.substr(colon + 1))});
+        }
+    }
+
+    return ret;
+}
+
+int PortfolioSolver::lowerBound() const
+{
+    // AdmissibleBoard の下界は，選択回数の上限まで選択できるとした場合のもの
+    CostFeature::setCosts(problem.swappingCost, problem.selectionCost);
+    const AdmissibleBoard<Flexible> board(PlayBoard<Flexible>(problem.board), problem.selectionLimit);
+    return board.lowerBound;
+}
+
+bool PortfolioSolver::isExact(const std::string& name)
+{
+    // hitode は双方向の探索が出会ったところで返すので，最適とは限らない
+    return name == "exact";
+}
+
+} // end of namespace slide
@@ -5,77 +5,117 @@
 
 #include <boost/format.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_scheduler_init.h>
+
 #include "OctopusBoard.hpp"
 #include "FixBoard.hpp"
 #include "branch.hpp"
 #include "Point.hpp"
 #include "SharkSolver.hpp"
 
+#include "util/ThreadIndexManager.hpp"
+
 namespace slide
 {
 
 bool SharkSolver::verbose = false;
 
-template<int H, int W>
-void SharkSolver::greedy(const PlayBoard<H, W>& board)
+namespace
 {
-    using SharkBoard = SharkUrchinBoard<H, W>;
-    //using SharkBoard = SharkOctopusBoard<H, W>;
 
-    int offset = 0;
-    int bestScore = std::numeric_limits<int>::max();
-    SharkBoard returnAnswerBoard;
+// start のセルを初めに選択し，評価の最もよい候補から貪欲に揃える
+// 候補の評価は並列に行い，scratch[スレッド番号] を作業用の盤面として使い回す．
+// 選ぶ候補は評価値を元の候補の順に走査して決めるので，スレッド数によらない．
+template<typename SharkBoard, int H, int W>
+Answer greedyFrom(const PlayBoard<H, W>& board, Point start, std::vector<SharkBoard>& scratch)
+{
+    SharkBoard sharkBoard(board);
+    sharkBoard.select(sharkBoard.find(start.toInt()));
 
-    reps(i, offset, board.height() - offset) reps(j, offset, board.width() - offset){
-        SharkBoard sharkBoard(board);
-        sharkBoard.select(sharkBoard.find(Point(i, j).toInt()));
+    std::vector<Point> cand;
+    std::vector<double> scores;
 
-        for(;;){
-            sharkBoard.getCandidates(cand);
-            verbose && std::cerr << sharkBoard << std::endl;
-            verbose && std::cerr << sharkBoard.fixed << std::endl;
-            if(cand.empty()){
-                break;
-            }
+    for(;;){
+        sharkBoard.getCandidates(cand);
+        SharkSolver::verbose && std::cerr << sharkBoard << std::endl;
+        SharkSolver::verbose && std::cerr << sharkBoard.fixed << std::endl;
+        if(cand.empty()){
+            break;
+        }
 
-            double minScore = std::numeric_limits<double>::max();
-            // std::partial_sort(cand.begin(), cand.begin() + 2, [](const Point& a, const Point& b){
-            //     const double score_a = sharkBoard.evaluate(a);
-            //     const double score_b = sharkBoard.evaluate(b);
-            //     return score_a < score_b;
-            // });
-            Point bestPoint = cand[0];
-            Point secondBestPoint = ( static_cast<int>(cand.size()) >= 2 ? cand[1] : cand[0]);
-
-            for(Point p : cand){
-                const double score = sharkBoard.evaluate(p);
-                if(score < minScore){
-                    minScore = score;
-                    secondBestPoint = bestPoint;
-                    bestPoint = p;
-                }
+        scores.resize(cand.size());
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, cand.size(), 1),
+            [&sharkBoard, &cand, &scores, &scratch]
+        (const tbb::blocked_range<std::size_t>& range){
+            SharkBoard& tmp = scratch[util::ThreadIndexManager::getLocalId()];
+            for(std::size_t k = range.begin(); k != range.end(); ++k){
+                scores[k] = sharkBoard.evaluate(cand[k], tmp);
             }
+        });
 
-            if(!sharkBoard.align(bestPoint)) {
-                if(!sharkBoard.align(secondBestPoint)){
-                    verbose && std::cerr << "align failed" << std::endl;
-                    verbose && std::cerr << sharkBoard << std::endl;
-                    break;
-                }
+        double minScore = std::numeric_limits<double>::max();
+        Point bestPoint = cand[0];
+        Point secondBestPoint = ( static_cast<int>(cand.size()) >= 2 ? cand[1] : cand[0]);
+
+        rep(k, cand.size()){
+            if(scores[k] < minScore){
+                minScore = scores[k];
+                secondBestPoint = bestPoint;
+                bestPoint = cand[k];
             }
         }
 
-        sharkBoard.answer.optimize();
-        if(bestScore > sharkBoard.answer.size()){
-            bestScore = sharkBoard.answer.size();
-            returnAnswerBoard = sharkBoard;
+        if(!sharkBoard.align(bestPoint)) {
+            if(!sharkBoard.align(secondBestPoint)){
+                SharkSolver::verbose && std::cerr << "align failed" << std::endl;
+                SharkSolver::verbose && std::cerr << sharkBoard << std::endl;
+                break;
+            }
         }
-        
     }
 
-    verbose && std::cout << "\n";
-    verbose && std::cout << returnAnswerBoard << std::endl;
-    onCreatedAnswer(returnAnswerBoard.answer); 
+    sharkBoard.answer.optimize();
+    return sharkBoard.answer;
+}
+
+} // end of unnamed namespace
+
+template<int H, int W>
+void SharkSolver::greedy(const PlayBoard<H, W>& board)
+{
+    using SharkBoard = SharkUrchinBoard<H, W>;
+    //using SharkBoard = SharkOctopusBoard<H, W>;
+
+    if(numThreads == -1){
+        numThreads = tbb::task_scheduler_init::default_num_threads();
+    }
+    tbb::task_scheduler_init init(numThreads);
+
+    // 候補の評価で使うスレッド毎の作業用の盤面
+    std::vector<SharkBoard> scratch(util::ThreadIndexManager::MAX_THREADS);
+
+    // 初めに選択するセル毎に並列に解き，それまでより短い解答が見つかる度に渡す
+    // 締め切りを過ぎたら，まだ始めていないセルは解かない
+    const int offset = 0;
+    const int h = board.height() - offset * 2, w = board.width() - offset * 2;
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, h * w, 1),
+        [this, &board, &scratch, offset, w]
+    (const tbb::blocked_range<int>& range){
+        for(int k = range.begin(); k != range.end(); ++k){
+            if(isTimeUp()){
+                return;
+            }
+
+            const Point start(offset + k / w, offset + k % w);
+            const Answer answer = greedyFrom(board, start, scratch);
+            if(publishAnswer(answer)){
+                verbose && std::cout << "start " << start << ": " << answer.size() << std::endl;
+            }
+        }
+    });
 }
 
 
@@ -108,19 +148,13 @@ void SharkSolver::solve(const PlayBoard<H, W>& board)
 	}
 
 	sharkBoard.answer.optimize();
-	onCreatedAnswer(sharkBoard.answer);
-}
-
-template<>
-void SharkSolver::solve<Flexible, Flexible>(const PlayBoard<Flexible>& board)
-{
-    branch(make_solve_caller(*this), board);
+	publishAnswer(sharkBoard.answer);
 }
 
 void SharkSolver::solve()
 {
     greedy(PlayBoard<Flexible>(problem.board));
-    //solve(PlayBoard<Flexible>(problem.board));
+    //branch(make_solve_caller(*this), PlayBoard<Flexible>(problem.board));
 }
 
 } // end of namespace slide
@@ -1,12 +1,19 @@
+#include <algorithm>
+#include <chrono>
+#include <mutex>
 #include <string>
 #include <utility>
 
 #include "Solver.hpp"
+#include "AutoSolver.hpp"
 #include "DolphinSolver.hpp"
 #include "DragonSolver.hpp"
 #include "ExactSolver.hpp"
 #include "HitodeSolver.hpp"
+#include "L2Solver.hpp"
 #include "KurageSolver.hpp"
+#include "LizardSolver.hpp"
+#include "PortfolioSolver.hpp"
 #include "SharkSolver.hpp"
 #include "StraightSolver.hpp"
 
@@ -30,9 +37,57 @@ std::unique_ptr<Solver> Solver::create_solver(const std::string& solver_name,
         return std::move(std::unique_ptr<slide::Solver>(new slide::DolphinSolver(problem)));
     }else if(solver_name == "dragon"){
         return std::move(std::unique_ptr<slide::Solver>(new slide::DragonSolver(problem)));
+    }else if(solver_name == "lizard"){
+        return std::move(std::unique_ptr<slide::Solver>(new slide::LizardSolver(problem)));
+    }else if(solver_name == "L2"){
+        return std::move(std::unique_ptr<slide::Solver>(new slide::L2Solver(problem)));
+    }else if(solver_name == "portfolio"){
+        return std::move(std::unique_ptr<slide::Solver>(new slide::PortfolioSolver(problem)));
+    }else if(solver_name == "auto"){
+        return std::move(std::unique_ptr<slide::Solver>(new slide::AutoSolver(problem)));
     }
 
     return nullptr;
 }
 
+void Solver::setTimeLimit(double seconds)
+{
+    startTime = Clock::now();
+    deadline = startTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+int Solver::cost(const Answer& answer) const
+{
+    const int numSelect = std::count_if(answer.begin(), answer.end(), [](Move move){ return move.isSelection; });
+    const int numSwap   = answer.size() - numSelect;
+    return numSelect * problem.selectionCost + numSwap * problem.swappingCost;
+}
+
+int Solver::bestCost()
+{
+    std::lock_guard<std::mutex> lock(publishMutex);
+    return publishedCost;
+}
+
+bool Solver::publishAnswer(const Answer& answer)
+{
+    const int answerCost = cost(answer);
+
+    // コールバックの中で重い処理をされても，より悪い解答が後から届かないように，呼び出しまで排他する
+    std::lock_guard<std::mutex> lock(publishMutex);
+    if(answerCost >= publishedCost){
+        return false;
+    }
+    publishedCost = answerCost;
+
+    if(onCreatedAnswer){
+        onCreatedAnswer(answer);
+    }
+    if(onImprovedAnswer){
+        const double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - startTime).count();
+        onImprovedAnswer(answer, answerCost, elapsed);
+    }
+    return true;
+}
+
 } // end of namespace slide
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include "DragonSolver.hpp"
+#include "KurageSolver.hpp"
+#include "LizardSolver.hpp"
+#include "ManhattanFeature.hpp"
+#include "PlayBoard.hpp"
+#include "SolverProfile.hpp"
+
+namespace slide
+{
+
+namespace
+{
+
+void writeRecord(std::ostream& out, const SolverProfile::Record& r)
+{
+    out << boost::format("%d %d %d %d %.4f %s %d %d %.1f %d %d\n")
+        % r.features.height % r.features.width % r.features.selectionLimit % r.features.manhattan % r.features.costRatio
+        % r.parameters.solver % r.parameters.totalBeamWidth % r.parameters.kurageMaxArea % r.time % r.cost % r.completed;
+}
+
+} // end of unnamed namespace
+
+SolverProfile::Features SolverProfile::Features::of(const Problem& problem)
+{
+    const PlayBoard<Flexible> board(problem.board);
+
+    Features ret;
+    ret.height = board.height();
+    ret.width = board.width();
+    ret.selectionLimit = problem.selectionLimit;
+    ret.manhattan = ManhattanFeature::compute(board);
+    ret.costRatio = double(problem.selectionCost + 1) / (problem.swappingCost + 1);
+    return ret;
+}
+
+double SolverProfile::Features::distance(const Features& other) const
+{
+    // 各成分をおおよそ [0, 1] に揃える
+    // マンハッタン距離は，ランダムな盤面での期待値 (面積 * (H+W) / 3) との比で比べる
+    const auto disorder = [](const Features& f){
+        return 3.0 * f.manhattan / (f.height * f.width * (f.height + f.width));
+    };
+
+    const double dh = (height - other.height) / double(MAX_DIVISION_NUM);
+    const double dw = (width - other.width) / double(MAX_DIVISION_NUM);
+    const double dl = (selectionLimit - other.selectionLimit) / double(MAX_SELECTION_LIMIT);
+    const double dr = std::log(costRatio / other.costRatio) / std::log(double(MAX_SELECTION_LIMIT));
+    const double dm = disorder(*this) - disorder(other);
+
+    return std::sqrt(dh*dh + dw*dw + dl*dl + dr*dr + dm*dm);
+}
+
+void SolverProfile::Parameters::apply(Solver& target) const
+{
+    if(KurageSolver* kurage = dynamic_cast<KurageSolver*>(&target)){
+        kurage->totalBeamWidth = totalBeamWidth;
+    }
+    else if(DragonSolver* dragon = dynamic_cast<DragonSolver*>(&target)){
+        dragon->totalBeamWidth = totalBeamWidth;
+        dragon->kurageMaxArea = kurageMaxArea;
+    }
+    else if(LizardSolver* lizard = dynamic_cast<LizardSolver*>(&target)){
+        lizard->totalBeamWidth = totalBeamWidth;
+    }
+}
+
+SolverProfile::Parameters SolverProfile::Parameters::of(const std::string& solver, const Solver& target)
+{
+    Parameters ret = {solver, 0, 0};
+
+    if(const KurageSolver* kurage = dynamic_cast<const KurageSolver*>(&target)){
+        ret.totalBeamWidth = kurage->totalBeamWidth;
+    }
+    else if(const DragonSolver* dragon = dynamic_cast<const DragonSolver*>(&target)){
+        ret.totalBeamWidth = dragon->totalBeamWidth;
+        ret.kurageMaxArea = dragon->kurageMaxArea;
+    }
+    else if(const LizardSolver* lizard = dynamic_cast<const LizardSolver*>(&target)){
+        ret.totalBeamWidth = lizard->totalBeamWidth;
+    }
+
+    return ret;
+}
+
+void SolverProfile::load(const boost::filesystem::path& path)
+{
+    records.clear();
+
+    std::ifstream fin(path.c_str());
+    if(!fin){
+        return;
+    }
+
+    std::string line;
+    while(std::getline(fin, line)){
+        std::istringstream in(line);
+        Record r;
+        if(!(in >> r.features.height >> r.features.width >> r.features.selectionLimit >> r.features.manhattan >> r.features.costRatio
+               >> r.parameters.solver >> r.parameters.totalBeamWidth >> r.parameters.kurageMaxArea >> r.time >> r.cost)){
+            continue;
+        }
+        if(!(in >> r.completed)){
+            r.completed = true;
+        }
+        records.push_back(r);
+    }
+}
+
+void SolverProfile::save(const boost::filesystem::path& path) const
+{
+    std::ofstream fout(path.c_str());
+    if(!fout){
+        throw std::runtime_error((boost::format("cannot open %s") % path.string()).str());
+    }
+
+    for(const Record& r : records){
+        writeRecord(fout, r);
+    }
+}
+
+void SolverProfile::append(const boost::filesystem::path& path, const Record& record)
+{
+    std::ofstream fout(path.c_str(), std::ios::app);
+    if(!fout){
+        throw std::runtime_error((boost::format("cannot open %s") % path.string()).str());
+    }
+
+    writeRecord(fout, record);
+}
+
+boost::optional<SolverProfile::Parameters> SolverProfile::select(const Features& features, double timeLimit) const
+{
+    // 打ち切られずに時間内に終わった記録を近い順に並べる
+    std::vector<std::pair<double, const Record*>> near;
+    for(const Record& r : records){
+        if(r.completed && (timeLimit <= 0.0 || r.time <= timeLimit)){
+            near.emplace_back(features.distance(r.features), &r);
+        }
+    }
+    if(near.empty()){
+        return boost::none;
+    }
+
+    const std::size_t k = std::min<std::size_t>(neighbors, near.size());
+    std::partial_sort(near.begin(), near.begin() + k, near.end(),
+        [](const std::pair<double, const Record*>& a, const std::pair<double, const Record*>& b){
+            return a.first < b.first;
+        });
+
+    // パラメータ毎に，マンハッタン距離あたりのコストを距離の逆数で重み付けして平均する
+    std::vector<std::pair<Parameters, std::pair<double, double>>> scores;
+    rep(i, k){
+        const Record& r = *near[i].second;
+        const double weight = 1.0 / (near[i].first + 1e-3);
+        const double normalized = double(r.cost) / std::max(1, r.features.manhattan);
+
+        auto itr = std::find_if(scores.begin(), scores.end(),
+            [&r](const std::pair<Parameters, std::pair<double, double>>& s){ return s.first == r.parameters; });
+        if(itr == scores.end()){
+            scores.push_back({r.parameters, {0.0, 0.0}});
+            itr = scores.end() - 1;
+        }
+        itr->second.first += weight * normalized;
+        itr->second.second += weight;
+    }
+
+    const auto best = std::min_element(scores.begin(), scores.end(),
+        [](const std::pair<Parameters, std::pair<double, double>>& a, const std::pair<Parameters, std::pair<double, double>>& b){
+            return a.second.first / a.second.second < b.second.first / b.second.second;
+        });
+    return best->first;
+}
+
+} // end of namespace slide
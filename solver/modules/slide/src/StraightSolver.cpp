@@ -399,6 +399,11 @@ void StraightSolver::solve()
 	int remW = board.width();
 
 	while(remH > 2 || remW > 2){
+		// 揃えきるまでは解答にならないので，締め切りを過ぎたら何も渡さずに終える
+		if(isTimeUp()){
+			return;
+		}
+
 		const bool isRow = remH >= remW;
 
 		if(isRow){
@@ -418,7 +423,7 @@ void StraightSolver::solve()
 	align2x2(board);
 
 	board.answer.optimize();
-	onCreatedAnswer(board.answer);
+	publishAnswer(board.answer);
 	std::cout << "move_count = " << board.answer.size() << std::endl;
 }
 
@@ -0,0 +1,120 @@
+#ifndef UTIL_BUCKET_QUEUE_HPP_
+#define UTIL_BUCKET_QUEUE_HPP_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+#include "define.hpp"
+
+namespace util
+{
+
+// 優先度が小さな整数のときの優先度付きキュー
+// 優先度毎の FIFO のバケツと，最小の空でないバケツを指すカーソルで，push も pop も O(1) (ならし)．
+// 要素はプールに置き，バケツには添字だけを入れる (大きな要素を何度も動かさない)．
+template<typename T>
+class BucketQueue
+{
+private:
+    struct Bucket
+    {
+        std::vector<uint> handles;
+        std::size_t head = 0;
+
+        bool empty() const {
+            return head == handles.size();
+        }
+    };
+
+    std::vector<T> pool;
+    std::vector<uint> freeHandles;
+
+    std::vector<Bucket> buckets;    // buckets[i] の優先度は base + i
+    int base = 0;
+    std::size_t cursor = 0;         // これより前のバケツは空
+    std::size_t count = 0;
+
+    void seek()
+    {
+        while(buckets[cursor].empty()){
+            ++cursor;
+        }
+    }
+
+public:
+    bool empty() const {
+        return count == 0;
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    void push(int priority, T value)
+    {
+        if(buckets.empty()){
+            base = priority;
+        }
+        else if(priority < base){
+            // まれにしか起きないので，前に詰め直す
+            buckets.insert(buckets.begin(), base - priority, Bucket());
+            cursor += base - priority;
+            base = priority;
+        }
+
+        const std::size_t index = priority - base;
+        if(index >= buckets.size()){
+            buckets.resize(index + 1);
+        }
+        if(index < cursor){
+            cursor = index;
+        }
+
+        uint handle;
+        if(freeHandles.empty()){
+            handle = pool.size();
+            pool.push_back(std::move(value));
+        }
+        else{
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+            pool[handle] = std::move(value);
+        }
+
+        buckets[index].handles.push_back(handle);
+        ++count;
+    }
+
+    // 最小の優先度
+    int topPriority()
+    {
+        BOOST_ASSERT(!empty());
+        seek();
+        return base + cursor;
+    }
+
+    // 最小の優先度の要素のうち，最も先に入れたものを取り出す
+    T pop()
+    {
+        BOOST_ASSERT(!empty());
+        seek();
+
+        Bucket& bucket = buckets[cursor];
+        const uint handle = bucket.handles[bucket.head++];
+        if(bucket.empty()){
+            bucket.handles.clear();
+            bucket.head = 0;
+        }
+
+        freeHandles.push_back(handle);
+        --count;
+        return std::move(pool[handle]);
+    }
+};
+
+} // end of namespace util
+
+#endif
@@ -0,0 +1,289 @@
+#ifndef UTIL_CONCURRENT_HASH_TABLE_HPP_
+#define UTIL_CONCURRENT_HASH_TABLE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include <boost/assert.hpp>
+
+#include "define.hpp"
+
+namespace util
+{
+
+// 固定容量・オープンアドレス法のロックフリーなハッシュテーブル
+// キー (Zobrist ハッシュ) の上位ビットと小さな値を 1 ワードに詰め，CAS で更新する．
+// 探索する範囲のスロットが全て埋まっていると登録できず FULL を返す．どう扱うか (登録したとみなす，別の表に退避する等) は呼び出し側で決める．
+class ConcurrentHashTable
+{
+public:
+    static constexpr int PAYLOAD_BITS = 8;
+    static constexpr int MAX_PAYLOAD  = (1 << PAYLOAD_BITS) - 1;
+    static constexpr int MAX_PROBE    = 64;
+
+    enum Result
+    {
+        UPDATED,    // 新規登録した，または値を大きくした
+        REJECTED,   // value 以上の値が既に登録されている
+        FULL        // テーブルが混んでいて登録できなかった
+    };
+
+private:
+    static constexpr ull PAYLOAD_MASK = ull(MAX_PAYLOAD);
+
+    std::unique_ptr<std::atomic<ull>[]> slots;
+    std::size_t mask;
+
+    static ull tagOf(ull key)
+    {
+        const ull tag = key & ~PAYLOAD_MASK;
+        return tag != 0ull ? tag : PAYLOAD_MASK + 1;
+    }
+
+public:
+    // capacity は 2 の冪に切り上げられる
+    explicit ConcurrentHashTable(std::size_t capacity)
+    {
+        std::size_t size = 1;
+        while(size < capacity){
+            size <<= 1;
+        }
+
+        slots.reset(new std::atomic<ull>[size]);
+        mask = size - 1;
+        clear();
+    }
+
+    ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+    ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+
+    std::size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+    // 並列に呼んではならない
+    void clear()
+    {
+        for(std::size_t i = 0; i <= mask; ++i){
+            slots[i].store(0ull, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    // key に value 以上の値が既に登録されていれば REJECTED を返す．
+    // そうでなければ key の値を value に更新 (または新規登録) して UPDATED を返す．
+    // 探索する範囲のスロットが他の鍵で埋まっていれば何もせずに FULL を返す．
+    Result updateMax(ull key, int value)
+    {
+        BOOST_ASSERT(0 <= value && value <= MAX_PAYLOAD);
+
+        const ull tag = tagOf(key);
+        const ull desired = tag | ull(value);
+        std::size_t index = key & mask;
+
+        rep(probe, MAX_PROBE){
+            std::atomic<ull>& slot = slots[index];
+            ull current = slot.load(std::memory_order_acquire);
+
+            while(true){
+                if(current == 0ull){
+                    if(slot.compare_exchange_weak(current, desired, std::memory_order_acq_rel, std::memory_order_acquire)){
+                        return UPDATED;
+                    }
+                    continue;
+                }
+
+                if((current & ~PAYLOAD_MASK) != tag){
+                    break;
+                }
+
+                if(int(current & PAYLOAD_MASK) >= value){
+                    return REJECTED;
+                }
+
+                if(slot.compare_exchange_weak(current, desired, std::memory_order_acq_rel, std::memory_order_acquire)){
+                    return UPDATED;
+                }
+            }
+
+            index = (index + 1) & mask;
+        }
+
+        return FULL;
+    }
+
+    // 登録されている値を返す (無ければ -1．FULL で登録できなかった鍵も -1)
+    int find(ull key) const
+    {
+        const ull tag = tagOf(key);
+        std::size_t index = key & mask;
+
+        rep(probe, MAX_PROBE){
+            const ull current = slots[index].load(std::memory_order_acquire);
+            if(current == 0ull){
+                return -1;
+            }
+            if((current & ~PAYLOAD_MASK) == tag){
+                return int(current & PAYLOAD_MASK);
+            }
+            index = (index + 1) & mask;
+        }
+
+        return -1;
+    }
+
+    Result insert(ull key)
+    {
+        return updateMax(key, 0);
+    }
+
+    bool contains(ull key) const
+    {
+        return find(key) >= 0;
+    }
+
+    // 呼び出したスレッド毎に使い回す，空のテーブルを返す．
+    // 同じ容量で何度も探索する場合に，確保とページフォルトの時間を省く．
+    static ConcurrentHashTable& local(std::size_t capacity)
+    {
+        static thread_local std::unique_ptr<ConcurrentHashTable> table;
+
+        if(table == nullptr || table->capacity() < capacity || table->capacity() >= capacity * 2){
+            table.reset(new ConcurrentHashTable(capacity));
+        }
+        else{
+            table->clear();
+        }
+
+        return *table;
+    }
+};
+
+// ConcurrentHashTable を段 (level) として積み重ね，溢れたら容量が倍の段を足していくテーブル
+// 鍵はどれか 1 つの段にだけ登録される (削除はしないので，ある段で FULL になった鍵はその段に二度と入らない)．
+// 登録と参照はロックを取らない．段を足すときだけ，全ての段で FULL になったスレッドがロックを取る．
+class GrowableConcurrentHashTable
+{
+public:
+    static constexpr int MAX_LEVELS = 24;
+
+    using Result = ConcurrentHashTable::Result;
+
+private:
+    std::unique_ptr<ConcurrentHashTable> levels[MAX_LEVELS];
+    std::atomic<int> numLevels;
+    std::mutex growMutex;
+
+    // 全ての段で FULL だったとき (段の数が expected のまま) に段を足す
+    void grow(int expected)
+    {
+        std::lock_guard<std::mutex> lock(growMutex);
+        const int n = numLevels.load(std::memory_order_relaxed);
+        if(n != expected){
+            return;
+        }
+        if(n == MAX_LEVELS){
+            throw std::length_error("GrowableConcurrentHashTable: too many levels");
+        }
+        levels[n].reset(new ConcurrentHashTable(levels[n-1]->capacity() * 2));
+        numLevels.store(n + 1, std::memory_order_release);
+    }
+
+public:
+    explicit GrowableConcurrentHashTable(std::size_t capacity)
+        : numLevels(1)
+    {
+        levels[0].reset(new ConcurrentHashTable(capacity));
+    }
+
+    GrowableConcurrentHashTable(const GrowableConcurrentHashTable&) = delete;
+    GrowableConcurrentHashTable& operator=(const GrowableConcurrentHashTable&) = delete;
+
+    // 全ての段の容量の和
+    std::size_t capacity() const
+    {
+        std::size_t ret = 0;
+        rep(i, numLevels.load(std::memory_order_acquire)){
+            ret += levels[i]->capacity();
+        }
+        return ret;
+    }
+
+    int levelCount() const
+    {
+        return numLevels.load(std::memory_order_acquire);
+    }
+
+    // 最初の段だけを残して空にする．並列に呼んではならない
+    void clear()
+    {
+        const int n = numLevels.load(std::memory_order_relaxed);
+        for(int i = 1; i < n; ++i){
+            levels[i].reset();
+        }
+        levels[0]->clear();
+        numLevels.store(1, std::memory_order_release);
+    }
+
+    // ConcurrentHashTable::updateMax と同じだが，FULL は返さない (段を足して登録する)
+    Result updateMax(ull key, int value)
+    {
+        int i = 0;
+        while(true){
+            const int n = numLevels.load(std::memory_order_acquire);
+            for(; i < n; ++i){
+                const Result result = levels[i]->updateMax(key, value);
+                if(result != ConcurrentHashTable::FULL){
+                    return result;
+                }
+            }
+            grow(n);
+        }
+    }
+
+    // 登録されている値を返す (無ければ -1)
+    int find(ull key) const
+    {
+        const int n = numLevels.load(std::memory_order_acquire);
+        rep(i, n){
+            const int ret = levels[i]->find(key);
+            if(ret >= 0){
+                return ret;
+            }
+        }
+        return -1;
+    }
+
+    Result insert(ull key)
+    {
+        return updateMax(key, 0);
+    }
+
+    bool contains(ull key) const
+    {
+        return find(key) >= 0;
+    }
+
+    // ConcurrentHashTable::local と同じく，呼び出したスレッド毎に使い回す空のテーブルを返す
+    static GrowableConcurrentHashTable& local(std::size_t capacity)
+    {
+        static thread_local std::unique_ptr<GrowableConcurrentHashTable> table;
+
+        if(table == nullptr || table->levels[0]->capacity() < capacity || table->levels[0]->capacity() >= capacity * 2){
+            table.reset(new GrowableConcurrentHashTable(capacity));
+        }
+        else{
+            table->clear();
+        }
+
+        return *table;
+    }
+};
+
+} // end of namespace util
+
+#endif
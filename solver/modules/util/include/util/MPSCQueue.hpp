@@ -0,0 +1,75 @@
+#ifndef UTIL_MPSC_QUEUE_HPP_
+#define UTIL_MPSC_QUEUE_HPP_
+
+#include <atomic>
+#include <utility>
+
+namespace util
+{
+
+// 複数のスレッドから push し，1 つのスレッドだけが pop するロックフリーなキュー
+// (Vyukov の MPSC キュー) push は exchange 1 回で済む．
+// push したスレッドが next を繋ぐ前の要素は，まだ無いものとして扱う (後で取り出せる)．
+// push 毎に節点を 1 つ確保するので，細かい要素は送り元でまとめてから push する．
+template<typename T>
+class MPSCQueue
+{
+private:
+    struct Node
+    {
+        std::atomic<Node*> next;
+        T value;
+
+        Node() : next(nullptr) {}
+        explicit Node(T&& value) : next(nullptr), value(std::move(value)) {}
+    };
+
+    std::atomic<Node*> head;    // 最後に push された要素
+    Node* tail;                 // 取り出し済みの番兵
+
+public:
+    MPSCQueue()
+    {
+        Node* stub = new Node();
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    ~MPSCQueue()
+    {
+        while(tail != nullptr){
+            Node* next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    // どのスレッドからも呼べる
+    void push(T value)
+    {
+        Node* node = new Node(std::move(value));
+        Node* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 取り出すスレッドだけが呼べる．空なら false
+    bool pop(T& value)
+    {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if(next == nullptr){
+            return false;
+        }
+
+        value = std::move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+};
+
+} // end of namespace util
+
+#endif
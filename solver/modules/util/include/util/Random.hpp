@@ -6,7 +6,6 @@
 
 #include <boost/assert.hpp>
 
-#include "SpinMutex.hpp"
 #include "ThreadIndexManager.hpp"
 
 namespace util
@@ -16,7 +15,6 @@ class Random
 {
 private:
 	static std::vector<Random> random;
-	static util::SpinMutex mutex;
 
 public:
 	Random() : engine(std::random_device{}()) {}
@@ -48,15 +46,10 @@ public:
 		return dist(getEngine(thread));
 	}
 
+	// スレッド番号の上限分を初めに作っておくので，並列に呼んでも再確保されない
 	static std::default_random_engine& getEngine(int thread = util::ThreadIndexManager::getLocalId())
 	{
-		if(random.size() <= thread){
-            std::lock_guard<util::SpinMutex> lock(mutex);
-			if(random.size() <= thread){
-                random.resize(thread + 1);
-            }
-        }
-
+		BOOST_ASSERT(thread < random.size());
 		return random[thread].engine;
 	}
 };
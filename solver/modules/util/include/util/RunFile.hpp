@@ -0,0 +1,161 @@
+#ifndef UTIL_RUN_FILE_HPP_
+#define UTIL_RUN_FILE_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "util/define.hpp"
+
+namespace util
+{
+
+// キーの昇順に並んだ (キー, 固定長のペイロード) の列をディスクに置くファイル (外部記憶の探索用)
+//
+// BLOCK_RECORDS 個ずつのブロックに分け，ブロックの先頭のキーはそのまま，以降は直前のキーとの差を可変長で書く．
+// ブロック毎の先頭のキーとファイル内の位置はメモリに持ち，find はブロック 1 つだけを読む．
+class Run
+{
+public:
+    static constexpr std::size_t BLOCK_RECORDS = 1 << 10;
+
+    struct BlockIndex
+    {
+        ull firstKey;
+        ull offset;
+        uint bytes;
+        uint count;
+    };
+
+private:
+    std::string path_;
+    std::size_t payloadSize_;
+    std::size_t size_;
+    std::vector<BlockIndex> blocks;
+
+    friend class RunWriter;
+
+public:
+    Run(std::string path, std::size_t payloadSize) : path_(std::move(path)), payloadSize_(payloadSize), size_(0) {}
+
+    Run(const Run&) = delete;
+    Run& operator=(const Run&) = delete;
+
+    // ファイルも消す
+    ~Run();
+
+    const std::string& path() const { return path_; }
+    std::size_t payloadSize() const { return payloadSize_; }
+    std::size_t size() const { return size_; }
+    const std::vector<BlockIndex>& index() const { return blocks; }
+
+    // key を持つ全てのレコードのペイロードを返す
+    std::vector<std::vector<char>> find(ull key) const;
+};
+
+// Run を先頭から書く (キーは昇順に渡すこと)
+class RunWriter
+{
+private:
+    Run& run;
+    std::ofstream out;
+    std::vector<char> block;
+    ull firstKey;
+    ull lastKey;
+    uint count;
+    ull offset;
+
+    void flush();
+
+public:
+    explicit RunWriter(Run& run);
+    ~RunWriter();
+
+    void write(ull key, const void* payload);
+
+    // 書き終えたら呼ぶ (書けなければ例外を投げる．デストラクタでも呼ばれるが，そこでは投げない)
+    void close();
+};
+
+// Run を先頭から読む
+class RunReader
+{
+private:
+    const Run& run;
+    std::ifstream in;
+    std::size_t block;
+    std::vector<char> buffer;
+    std::size_t position;
+    uint remaining;
+    ull lastKey;
+
+    bool loadBlock();
+
+public:
+    explicit RunReader(const Run& run);
+
+    // 次のレコードを読む (無ければ false)
+    bool next(ull& key, void* payload);
+};
+
+// 固定長のレコードを書き足し，先頭から読み直すだけのファイル (並んでいない)
+class SpillFile
+{
+private:
+    std::string path_;
+    std::size_t recordSize_;
+    std::size_t size_;
+    std::ofstream out;
+
+public:
+    SpillFile(std::string path, std::size_t recordSize);
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    // ファイルも消す
+    ~SpillFile();
+
+    std::size_t size() const { return size_; }
+
+    void append(const void* record);
+
+    // 書き込みを終えて，最大 maxRecords 個ずつ読み出す関数を呼ぶ (読み書きできなければ例外を投げる)
+    // f(const char* records, std::size_t count)
+    template<typename F>
+    void forEachChunk(std::size_t maxRecords, F f);
+};
+
+template<typename F>
+void SpillFile::forEachChunk(std::size_t maxRecords, F f)
+{
+    out.close();
+    if(!out){
+        throw std::runtime_error("cannot write " + path_);
+    }
+
+    std::ifstream in(path_.c_str(), std::ios::binary);
+    if(!in){
+        throw std::runtime_error("cannot open " + path_);
+    }
+    std::vector<char> buffer(std::max<std::size_t>(maxRecords, 1) * recordSize_);
+    std::size_t left = size_;
+
+    while(left > 0){
+        const std::size_t count = std::min(left, buffer.size() / recordSize_);
+        in.read(buffer.data(), count * recordSize_);
+        if(!in){
+            throw std::runtime_error("cannot read " + path_);
+        }
+        f(static_cast<const char*>(buffer.data()), count);
+        left -= count;
+    }
+}
+
+} // end of namespace util
+
+#endif
@@ -5,6 +5,7 @@
 #include <array>
 #include <chrono>
 #include <iostream>
+#include <mutex>
 #include <ratio>
 #include <stack>
 #include <string>
@@ -97,9 +98,11 @@ private:
 	using tag_type = std::pair<std::string, int>;
 	using hash_map = dense_hash_map<tag_type, std::size_t, hash<tag_type>>;
 
+	// 複数のスレッド (同時に動くソルバ) から使えるように，表は mutex で守り，入れ子の状態はスレッド毎に持つ
 	static hash_map orders;
 	static std::vector<std::tuple<StopWatch, int>> table;
-	static std::stack<int> trace;
+	static thread_local std::stack<int> trace;
+	static std::mutex mutex;
 
 	static int get_parent()
 	{
@@ -132,6 +135,7 @@ private:
 public:
 	static void start(const std::string& tag)
 	{
+		std::lock_guard<std::mutex> lock(mutex);
 		const int id = get_or_create_order(tag);
 		std::get<0>(table[id]).start();
 		trace.push(id);
@@ -139,12 +143,14 @@ public:
 
 	static void stop(const std::string& tag)
 	{
+		std::lock_guard<std::mutex> lock(mutex);
 		trace.pop();
 		std::get<0>(table[get_order(tag)]).stop();
 	}
 
 	static void stop_last()
 	{
+		std::lock_guard<std::mutex> lock(mutex);
 		BOOST_ASSERT(!trace.empty());
 		std::get<0>(table[trace.top()]).stop();
 		trace.pop();
@@ -152,27 +158,32 @@ public:
 
 	static void reset(const std::string& tag)
 	{
+		std::lock_guard<std::mutex> lock(mutex);
 		getStopWatch(tag).reset();
 	}
 
 	static Duration elapsed(const std::string& tag)
 	{
+		std::lock_guard<std::mutex> lock(mutex);
 		return getStopWatch(tag).elapsed();
 	}
 
 	static double elapsed_ms(const std::string& tag)
 	{
+		std::lock_guard<std::mutex> lock(mutex);
 		return getStopWatch(tag).elapsed_ms();
 	}
 
 	static void clear()
 	{
+		std::lock_guard<std::mutex> lock(mutex);
 		orders.clear();
 		table.clear();
 	}
 
 	static void show(std::ostream& out = std::cerr)
 	{
+		std::lock_guard<std::mutex> lock(mutex);
 		using list_row       = std::array<std::string, 2>;
 		std::vector<list_row> listing(orders.size());
 
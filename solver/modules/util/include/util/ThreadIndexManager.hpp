@@ -1,9 +1,9 @@
 #ifndef UTIL_THREAD_INDEX_MANAGER_HPP_
 #define UTIL_THREAD_INDEX_MANAGER_HPP_
 
+#include <atomic>
 #include <mutex>
-
-#include <tbb/enumerable_thread_specific.h>
+#include <stdexcept>
 
 #include "util/define.hpp"
 #include "util/SpinMutex.hpp"
@@ -11,35 +11,86 @@
 namespace util
 {
 
+// スレッド毎に 0 から MAX_THREADS-1 までの番号を振る
+// 番号はスレッドが終わるまで変わらず，終わったスレッドの番号は次に来たスレッドが使う．
+// 複数のソルバが同時に動いていても番号は重ならないので，スレッド毎の配列は size() (最大 MAX_THREADS) 個確保すればよい．
 class ThreadIndexManager
 {
+public:
+    static constexpr int MAX_THREADS = 1 << 8;
+
 private:
-    using Storage = tbb::enumerable_thread_specific<uchar, tbb::cache_aligned_allocator<uchar>, tbb::ets_key_per_instance>;
+    struct LocalId
+    {
+        int id = -1;
+
+        ~LocalId()
+        {
+            if(id != -1){
+                release(id);
+            }
+        }
+    };
 
-    static Storage storage;
-    static int size;
+    static thread_local LocalId local;
+    static bool used[MAX_THREADS];
+    static std::atomic<int> size_;
     static SpinMutex mutex;
 
     ThreadIndexManager() = delete;
     ThreadIndexManager(const ThreadIndexManager&) = delete;
 
+    static int acquire()
+    {
+        std::lock_guard<SpinMutex> lock(mutex);
+        int id = 0;
+        while(id < MAX_THREADS && used[id]){
+            ++id;
+        }
+        // 番号を使い切ったら，そのスレッドにはスレッド毎の領域が無いので先へ進ませない
+        if(id == MAX_THREADS){
+            throw std::runtime_error("ThreadIndexManager: more than MAX_THREADS threads are alive");
+        }
+
+        used[id] = true;
+        if(size_.load(std::memory_order_relaxed) <= id){
+            size_.store(id + 1, std::memory_order_release);
+        }
+        return id;
+    }
+
+    static void release(int id)
+    {
+        std::lock_guard<SpinMutex> lock(mutex);
+        used[id] = false;
+    }
+
 public:
     static int getLocalId()
     {
-        bool exist;
-        uchar& ref = storage.local(exist);
-        if(!exist){
-            std::lock_guard<SpinMutex> lock(mutex);
-            ref = size;
-            ++size;
+        LocalId& ref = local;
+        if(ref.id == -1){
+            ref.id = acquire();
         }
-        return ref;
+        return ref.id;
     }
 
+    // これまでに振った番号の最大値 + 1
+    // 並列区間の外で読めば，その区間で使われた番号は全て size() 未満
+    static int size()
+    {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    // 終わったスレッドの番号を size() から外す (使われている番号は変わらないので，他のソルバが動いていても呼んでよい)
     static void clear()
     {
-        storage.clear();
-        size = 0;
+        std::lock_guard<SpinMutex> lock(mutex);
+        int n = MAX_THREADS;
+        while(n > 0 && !used[n - 1]){
+            --n;
+        }
+        size_.store(n, std::memory_order_release);
     }
 };
 
@@ -0,0 +1,130 @@
+#ifndef UTIL_TRANSPOSITION_TABLE_HPP_
+#define UTIL_TRANSPOSITION_TABLE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include <boost/assert.hpp>
+
+#include "define.hpp"
+
+namespace util
+{
+
+// 反復深化探索のための，固定容量・ロックフリーな置換表
+// 1 バケットは 16 バイト (検査語と値) で，値には下界・探索した深さ・世代を詰める．
+// 検査語にはキーと値の xor を入れておき，書き込み途中のバケットを読んだ場合は見つからなかったことにする．
+// 衝突した場合は，同じ状態か，より深く探索した値か，古い世代の値だけを置き換える (深さ優先の置換)．
+class TranspositionTable
+{
+public:
+    static constexpr std::size_t BUCKET_BYTES = 16;
+    static constexpr int MAX_DEPTH = (1 << 16) - 1;
+
+private:
+    struct Bucket
+    {
+        std::atomic<ull> check;
+        std::atomic<ull> data;
+    };
+
+    std::unique_ptr<Bucket[]> buckets;
+    std::size_t mask;
+    uint generation;
+
+    static ull pack(int bound, int depth, uint generation)
+    {
+        return ull(uint(bound)) << 32 | ull(depth) << 16 | ull(generation & 0xffff);
+    }
+
+    static int boundOf(ull data)      { return int(data >> 32); }
+    static int depthOf(ull data)      { return int((data >> 16) & 0xffff); }
+    static uint generationOf(ull data) { return uint(data & 0xffff); }
+
+public:
+    // bytes 以下で最大の 2 の冪個のバケットを確保する
+    explicit TranspositionTable(std::size_t bytes)
+    {
+        std::size_t size = 1;
+        while(size * 2 * BUCKET_BYTES <= bytes){
+            size <<= 1;
+        }
+
+        buckets.reset(new Bucket[size]);
+        mask = size - 1;
+        clear();
+    }
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    std::size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+    std::size_t bytes() const
+    {
+        return capacity() * BUCKET_BYTES;
+    }
+
+    // 並列に呼んではならない
+    void clear()
+    {
+        for(std::size_t i = 0; i <= mask; ++i){
+            buckets[i].check.store(0ull, std::memory_order_relaxed);
+            buckets[i].data.store(0ull, std::memory_order_relaxed);
+        }
+        generation = 1;
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    // 反復の度に呼ぶ (以前の反復の値は優先して置き換えられる)
+    // 並列に呼んではならない
+    void nextGeneration()
+    {
+        generation = (generation + 1) & 0xffff;
+        if(generation == 0){
+            generation = 1;
+        }
+    }
+
+    // key に登録されている下界を返す (無ければ -1)
+    int find(ull key) const
+    {
+        const Bucket& bucket = buckets[key & mask];
+        const ull data = bucket.data.load(std::memory_order_relaxed);
+        const ull check = bucket.check.load(std::memory_order_relaxed);
+
+        if(data == 0ull || (check ^ data) != key){
+            return -1;
+        }
+        return boundOf(data);
+    }
+
+    // depth はこの下界を得るのに探索した深さ (置換の優先度)
+    // 置き換えた (または新規に登録した) 場合に true を返す
+    bool store(ull key, int bound, int depth)
+    {
+        BOOST_ASSERT(0 <= bound);
+
+        Bucket& bucket = buckets[key & mask];
+        const ull old = bucket.data.load(std::memory_order_relaxed);
+        const ull oldKey = bucket.check.load(std::memory_order_relaxed) ^ old;
+
+        if(old != 0ull && oldKey != key && generationOf(old) == generation && depthOf(old) > depth){
+            return false;
+        }
+
+        const ull data = pack(bound, std::min(std::max(depth, 0), MAX_DEPTH), generation);
+        bucket.data.store(data, std::memory_order_relaxed);
+        bucket.check.store(key ^ data, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+} // end of namespace util
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef UTIL_PARALLEL_SELECT_HPP_
+#define UTIL_PARALLEL_SELECT_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "define.hpp"
+
+namespace util
+{
+
+// 大小関係を保ったまま uint に変換する
+inline uint ordered_bits(float value)
+{
+    uint u;
+    std::memcpy(&u, &value, sizeof(u));
+    return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+inline uint ordered_bits(int value)
+{
+    return uint(value) ^ 0x80000000u;
+}
+
+namespace details
+{
+
+template<typename T>
+struct first_key
+{
+    uint operator()(const T& value) const
+    {
+        return ordered_bits(value.first);
+    }
+};
+
+} // end of namespace details
+
+// v の中から key の小さいものを k 個選び，v をそれら (順不同) だけにする．
+// key の値を上位ビットから基数選択するので，全体をソートするより速い．
+// 同じ key の要素の中では元の並びで前にあるものが選ばれるので，結果はスレッド数に依らない．
+template<typename T, typename KeyFunc>
+void parallel_select(std::vector<T>& v, std::size_t k, KeyFunc key)
+{
+    if(v.size() <= k){
+        return;
+    }
+    if(k == 0){
+        v.clear();
+        return;
+    }
+
+    constexpr std::size_t GRAIN = 1 << 14;
+    constexpr int NUM_PASSES = 3;
+    constexpr int SHIFTS[NUM_PASSES] = {21, 10, 0};
+    constexpr int BITS[NUM_PASSES]   = {11, 11, 10};
+    constexpr int MAX_BUCKETS = 1 << 11;
+
+    const std::size_t n = v.size();
+    const std::size_t numChunks = (n + GRAIN - 1) / GRAIN;
+
+    // k 番目の値 threshold を上位ビットから決めていく
+    std::vector<std::array<uint, MAX_BUCKETS>> histograms(numChunks);
+    uint threshold = 0u;
+    uint thresholdMask = 0u;
+    std::size_t rank = k;
+
+    rep(pass, NUM_PASSES){
+        const int shift = SHIFTS[pass];
+        const uint bucketMask = (1u << BITS[pass]) - 1;
+
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, numChunks, 1),
+            [&v, &histograms, &key, n, shift, bucketMask, threshold, thresholdMask]
+        (const tbb::blocked_range<std::size_t>& range){
+            for(std::size_t c = range.begin(); c != range.end(); ++c){
+                std::array<uint, MAX_BUCKETS>& histogram = histograms[c];
+                std::fill(histogram.begin(), histogram.end(), 0u);
+
+                const std::size_t last = std::min(n, (c + 1) * GRAIN);
+                for(std::size_t i = c * GRAIN; i < last; ++i){
+                    const uint bits = key(v[i]);
+                    if((bits & thresholdMask) == threshold){
+                        ++histogram[(bits >> shift) & bucketMask];
+                    }
+                }
+            }
+        });
+
+        uint bucket = 0u;
+        for(;; ++bucket){
+            std::size_t count = 0;
+            for(const std::array<uint, MAX_BUCKETS>& histogram : histograms){
+                count += histogram[bucket];
+            }
+            if(rank <= count){
+                break;
+            }
+            rank -= count;
+        }
+
+        threshold |= bucket << shift;
+        thresholdMask |= bucketMask << shift;
+    }
+
+    // threshold より小さいものは全て，等しいものは前から rank 個を残す
+    std::vector<std::pair<std::size_t, std::size_t>> counts(numChunks);
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, numChunks, 1),
+        [&v, &counts, &key, n, threshold]
+    (const tbb::blocked_range<std::size_t>& range){
+        for(std::size_t c = range.begin(); c != range.end(); ++c){
+            std::size_t less = 0, equal = 0;
+            const std::size_t last = std::min(n, (c + 1) * GRAIN);
+            for(std::size_t i = c * GRAIN; i < last; ++i){
+                const uint bits = key(v[i]);
+                less += bits < threshold;
+                equal += bits == threshold;
+            }
+            counts[c] = {less, equal};
+        }
+    });
+
+    // counts[c] を (書き込み位置, 残す等値要素の数) に置き換える
+    std::size_t offset = 0;
+    for(std::pair<std::size_t, std::size_t>& count : counts){
+        const std::size_t equal = std::min(count.second, rank);
+        rank -= equal;
+        const std::size_t size = count.first + equal;
+        count = {offset, equal};
+        offset += size;
+    }
+
+    std::vector<T> selected(k);
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, numChunks, 1),
+        [&v, &counts, &selected, &key, n, threshold]
+    (const tbb::blocked_range<std::size_t>& range){
+        for(std::size_t c = range.begin(); c != range.end(); ++c){
+            std::size_t out = counts[c].first;
+            std::size_t equal = counts[c].second;
+            const std::size_t last = std::min(n, (c + 1) * GRAIN);
+            for(std::size_t i = c * GRAIN; i < last; ++i){
+                const uint bits = key(v[i]);
+                if(bits < threshold){
+                    selected[out++] = std::move(v[i]);
+                }
+                else if(bits == threshold && equal > 0){
+                    selected[out++] = std::move(v[i]);
+                    --equal;
+                }
+            }
+        }
+    });
+
+    // 呼び出し側で確保した v の容量を保つため，swap ではなく書き戻す
+    std::move(selected.begin(), selected.end(), v.begin());
+    v.resize(k);
+}
+
+// (score, index) の組を score で選ぶ
+template<typename T>
+void parallel_select(std::vector<T>& v, std::size_t k)
+{
+    parallel_select(v, k, details::first_key<T>());
+}
+
+} // end of namespace util
+
+#endif
@@ -1,10 +1,8 @@
-#include <tbb/task_scheduler_init.h>
 #include "Random.hpp"
 
 namespace util
 {
 
-std::vector<Random> Random::random(tbb::task_scheduler_init::default_num_threads());
-util::SpinMutex Random::mutex;
+std::vector<Random> Random::random(ThreadIndexManager::MAX_THREADS);
 
 } // end of namespace util
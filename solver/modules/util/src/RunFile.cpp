@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "RunFile.hpp"
+
+namespace util
+{
+
+namespace
+{
+
+void putVarint(std::vector<char>& out, ull value)
+{
+    while(value >= 0x80){
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+ull getVarint(const std::vector<char>& in, std::size_t& position)
+{
+    ull value = 0;
+    for(int shift = 0; ; shift += 7){
+        const uchar byte = static_cast<uchar>(in[position++]);
+        value |= ull(byte & 0x7f) << shift;
+        if(!(byte & 0x80)){
+            return value;
+        }
+    }
+}
+
+// ブロックを読みながら 1 レコードずつ取り出す
+// (先頭はキーそのまま，以降は直前のキーとの差)
+void decode(const std::vector<char>& buffer, std::size_t& position, bool first, ull& key, void* payload, std::size_t payloadSize)
+{
+    if(first){
+        std::memcpy(&key, buffer.data() + position, sizeof(key));
+        position += sizeof(key);
+    }
+    else{
+        key += getVarint(buffer, position);
+    }
+
+    std::memcpy(payload, buffer.data() + position, payloadSize);
+    position += payloadSize;
+}
+
+} // end of unnamed namespace
+
+/******************************************************************************
+ * Run
+ *****************************************************************************/
+
+Run::~Run()
+{
+    std::remove(path_.c_str());
+}
+
+std::vector<std::vector<char>> Run::find(ull key) const
+{
+    std::vector<std::vector<char>> ret;
+
+    // key を含みうる最初のブロック (先頭のキーが key 以上の最初のものの 1 つ前) から読む
+    auto itr = std::lower_bound(blocks.begin(), blocks.end(), key,
+        [](const BlockIndex& b, ull k){ return b.firstKey < k; });
+    if(itr != blocks.begin()){
+        --itr;
+    }
+
+    std::ifstream in(path_.c_str(), std::ios::binary);
+    if(!in){
+        throw std::runtime_error("cannot open " + path_);
+    }
+    std::vector<char> buffer;
+    std::vector<char> payload(payloadSize_);
+
+    for(; itr != blocks.end() && itr->firstKey <= key; ++itr){
+        buffer.resize(itr->bytes);
+        in.seekg(itr->offset);
+        in.read(buffer.data(), itr->bytes);
+        if(!in){
+            throw std::runtime_error("cannot read " + path_);
+        }
+
+        std::size_t position = 0;
+        ull k = 0;
+        rep(i, itr->count){
+            decode(buffer, position, i == 0, k, payload.data(), payloadSize_);
+            if(k == key){
+                ret.push_back(payload);
+            }
+            else if(k > key){
+                return ret;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/******************************************************************************
+ * RunWriter
+ *****************************************************************************/
+
+RunWriter::RunWriter(Run& run)
+    : run(run), out(run.path().c_str(), std::ios::binary | std::ios::trunc), firstKey(0), lastKey(0), count(0), offset(0)
+{
+    if(!out){
+        throw std::runtime_error("cannot open " + run.path());
+    }
+    run.blocks.clear();
+    run.size_ = 0;
+}
+
+RunWriter::~RunWriter()
+{
+    // デストラクタからは投げない (書けたかを知りたければ先に close を呼ぶ)
+    try{
+        close();
+    }catch(std::exception&){
+    }
+}
+
+void RunWriter::write(ull key, const void* payload)
+{
+    if(count == 0){
+        firstKey = key;
+        block.resize(sizeof(key));
+        std::memcpy(block.data(), &key, sizeof(key));
+    }
+    else{
+        putVarint(block, key - lastKey);
+    }
+
+    const char* bytes = static_cast<const char*>(payload);
+    block.insert(block.end(), bytes, bytes + run.payloadSize());
+
+    lastKey = key;
+    ++run.size_;
+    if(++count == Run::BLOCK_RECORDS){
+        flush();
+    }
+}
+
+void RunWriter::flush()
+{
+    if(count == 0){
+        return;
+    }
+
+    out.write(block.data(), block.size());
+    if(!out){
+        throw std::runtime_error("cannot write " + run.path());
+    }
+    run.blocks.push_back({firstKey, offset, static_cast<uint>(block.size()), count});
+    offset += block.size();
+
+    block.clear();
+    count = 0;
+}
+
+void RunWriter::close()
+{
+    if(!out.is_open()){
+        return;
+    }
+
+    flush();
+    out.close();
+    if(!out){
+        throw std::runtime_error("cannot write " + run.path());
+    }
+}
+
+/******************************************************************************
+ * RunReader
+ *****************************************************************************/
+
+RunReader::RunReader(const Run& run)
+    : run(run), in(run.path().c_str(), std::ios::binary), block(0), position(0), remaining(0), lastKey(0)
+{
+    if(!in){
+        throw std::runtime_error("cannot open " + run.path());
+    }
+}
+
+bool RunReader::loadBlock()
+{
+    if(block == run.index().size()){
+        return false;
+    }
+
+    const Run::BlockIndex& b = run.index()[block++];
+    buffer.resize(b.bytes);
+    in.read(buffer.data(), b.bytes);
+    if(!in){
+        throw std::runtime_error("cannot read " + run.path());
+    }
+    position = 0;
+    remaining = b.count;
+    return true;
+}
+
+bool RunReader::next(ull& key, void* payload)
+{
+    const bool first = remaining == 0;
+    if(first && !loadBlock()){
+        return false;
+    }
+
+    key = lastKey;
+    decode(buffer, position, first, key, payload, run.payloadSize());
+    lastKey = key;
+    --remaining;
+    return true;
+}
+
+/******************************************************************************
+ * SpillFile
+ *****************************************************************************/
+
+SpillFile::SpillFile(std::string path, std::size_t recordSize)
+    : path_(std::move(path)), recordSize_(recordSize), size_(0), out(path_.c_str(), std::ios::binary | std::ios::trunc)
+{
+    if(!out){
+        throw std::runtime_error("cannot open " + path_);
+    }
+}
+
+SpillFile::~SpillFile()
+{
+    out.close();
+    std::remove(path_.c_str());
+}
+
+void SpillFile::append(const void* record)
+{
+    out.write(static_cast<const char*>(record), recordSize_);
+    if(!out){
+        throw std::runtime_error("cannot write " + path_);
+    }
+    ++size_;
+}
+
+} // end of namespace util
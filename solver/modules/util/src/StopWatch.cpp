@@ -5,6 +5,7 @@ namespace util
 
 StopWatch::hash_map StopWatch::orders({"", 0});
 std::vector<std::tuple<StopWatch, int>> StopWatch::table;
-std::stack<int> StopWatch::trace;
+thread_local std::stack<int> StopWatch::trace;
+std::mutex StopWatch::mutex;
 
 } // end of namespace util
@@ -3,8 +3,9 @@
 namespace util
 {
 
-ThreadIndexManager::Storage ThreadIndexManager::storage;
-int ThreadIndexManager::size(0);
+thread_local ThreadIndexManager::LocalId ThreadIndexManager::local;
+bool ThreadIndexManager::used[ThreadIndexManager::MAX_THREADS];
+std::atomic<int> ThreadIndexManager::size_(0);
 SpinMutex ThreadIndexManager::mutex;
 
 } // end of namespace util
@@ -0,0 +1,9 @@
+#include "TranspositionTable.hpp"
+
+namespace util
+{
+
+constexpr std::size_t TranspositionTable::BUCKET_BYTES;
+constexpr int TranspositionTable::MAX_DEPTH;
+
+} // end of namespace util